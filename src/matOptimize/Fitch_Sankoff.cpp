@@ -17,15 +17,15 @@
 #endif
 namespace MAT = Mutation_Annotated_Tree;
 //get state of ancestor at position
-nuc_one_hot get_this_state(MAT::Node* ancestor,int position) {
-    auto iter = ancestor->mutations.find(position);
+nuc_one_hot get_this_state(MAT::Node* ancestor,uint8_t chrom_idx,int position) {
+    auto iter = ancestor->mutations.find(chrom_idx,position);
     if (iter == ancestor->mutations.end()) {
         ancestor = ancestor->parent;
     } else {
         return iter->get_mut_one_hot();
     }
     while (ancestor) {
-        auto iter = ancestor->mutations.find(position);
+        auto iter = ancestor->mutations.find(chrom_idx,position);
         if (iter == ancestor->mutations.end()) {
             ancestor = ancestor->parent;
         } else {
@@ -225,7 +225,7 @@ static nuc_one_hot set_state(const forward_pass_range & this_range,uint8_t bound
         this_state=this_state.choose_first();
 #ifdef CHECK_STATE_REASSIGN
         if(try_similar) {
-            nuc_one_hot ori_state=get_this_state(try_similar->get_node(this_node->identifier), base.get_position());
+            nuc_one_hot ori_state=get_this_state(try_similar->get_node(this_node->identifier), base.get_chromIdx(), base.get_position());
             if (ori_state&this_state) {
                 this_state=ori_state;
             }
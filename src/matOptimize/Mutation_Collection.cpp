@@ -12,9 +12,9 @@ void Mutations_Collection::merge_out(const Mutations_Collection &other,
 // used for checking whether the two vectors are sorted while merging
 #ifdef DETAIL_DEBUG_MUTATION_SORTED
 #define mutation_vector_check_order(newly_inserted)                            \
-    assert(last_pos_inserted < (newly_inserted));                              \
-    last_pos_inserted = (newly_inserted);
-    int last_pos_inserted = -1;
+    assert(last_key_inserted < (newly_inserted));                              \
+    last_key_inserted = (newly_inserted);
+    uint64_t last_key_inserted = 0;
 #else
 #define mutation_vector_check_order(newly_inserted)
 #endif
@@ -25,8 +25,8 @@ void Mutations_Collection::merge_out(const Mutations_Collection &other,
             other_iter++;
         }
         while (other_iter != other.mutations.end() &&
-                other_iter->get_position() < this_mutation.get_position()) {
-            mutation_vector_check_order(other_iter->get_position());
+                other_iter->get_sort_key() < this_mutation.get_sort_key()) {
+            mutation_vector_check_order(other_iter->get_sort_key());
             out.mutations.push_back(*other_iter);
             if (keep_self == INVERT_MERGE) {
                 auto temp = out.mutations.back().get_mut_one_hot();
@@ -38,13 +38,13 @@ void Mutations_Collection::merge_out(const Mutations_Collection &other,
             other_iter++;
         }
         if (other_iter == other.mutations.end() ||
-                this_mutation.get_position() < other_iter->get_position()) {
-            mutation_vector_check_order(this_mutation.get_position());
+                this_mutation.get_sort_key() < other_iter->get_sort_key()) {
+            mutation_vector_check_order(this_mutation.get_sort_key());
             out.mutations.push_back(this_mutation);
         } else {
-            mutation_vector_check_order(this_mutation.get_position());
+            mutation_vector_check_order(this_mutation.get_sort_key());
 
-            //assert(this_mutation.get_position() == other_iter->get_position());
+            //assert(this_mutation.get_sort_key() == other_iter->get_sort_key());
             switch (keep_self) {
             case NO_DUPLICATE:
                 assert(false);
@@ -84,7 +84,7 @@ void Mutations_Collection::merge_out(const Mutations_Collection &other,
         if (other_iter==other.mutations.end()) {
             break;
         }
-        mutation_vector_check_order(other_iter->get_position());
+        mutation_vector_check_order(other_iter->get_sort_key());
         out.mutations.push_back(*other_iter);
         if (keep_self == INVERT_MERGE) {
             auto temp = out.mutations.back().get_mut_one_hot();
@@ -108,23 +108,23 @@ void Mutations_Collection::set_difference(const Mutations_Collection &other,
         std::min(mutations.size(), other.mutations.size()));
     auto other_iter = other.mutations.begin();
 #ifdef DETAIL_DEBUG_MUTATION_SORTED
-    int last_pos_inserted = -1;
+    uint64_t last_key_inserted = 0;
 #endif
     // merge sort again
     for (auto this_mutation : mutations) {
         while (other_iter != other.mutations.end() &&
-                other_iter->get_position() < this_mutation.get_position()) {
-            mutation_vector_check_order(other_iter->get_position());
+                other_iter->get_sort_key() < this_mutation.get_sort_key()) {
+            mutation_vector_check_order(other_iter->get_sort_key());
             other_unique.mutations.push_back(*other_iter);
             other_iter++;
         }
         if (other_iter == other.mutations.end() ||
-                this_mutation.get_position() < other_iter->get_position()) {
-            mutation_vector_check_order(this_mutation.get_position());
+                this_mutation.get_sort_key() < other_iter->get_sort_key()) {
+            mutation_vector_check_order(this_mutation.get_sort_key());
             this_unique.mutations.push_back(this_mutation);
         } else {
-            mutation_vector_check_order(this_mutation.get_position());
-            assert(this_mutation.get_position() == other_iter->get_position());
+            mutation_vector_check_order(this_mutation.get_sort_key());
+            assert(this_mutation.get_sort_key() == other_iter->get_sort_key());
 
             if (other_iter->get_mut_one_hot() == this_mutation.get_mut_one_hot()) {
                 assert(other_iter->get_par_one_hot() == this_mutation.get_par_one_hot());
@@ -137,30 +137,30 @@ void Mutations_Collection::set_difference(const Mutations_Collection &other,
         }
     }
     while (other_iter < other.mutations.end()) {
-        mutation_vector_check_order(other_iter->get_position());
+        mutation_vector_check_order(other_iter->get_sort_key());
         other_unique.mutations.push_back(*other_iter);
         other_iter++;
     }
     assert(this_unique.size() + other_unique.size() + 2 * common.size() ==
            mutations.size() + other.mutations.size());
 }
-Mutations_Collection::iterator Mutations_Collection::find_next(int pos) {
+Mutations_Collection::iterator Mutations_Collection::find_next(uint64_t key) {
 #ifdef DETAIL_DEBUG_MUTATION_SORTED
-    int lastPos = 0;
+    uint64_t last_key = 0;
 #endif
     auto iter = mutations.begin();
     for (; iter < mutations.end(); iter++) {
 // check sorting in debug mode
 #ifdef DETAIL_DEBUG_MUTATION_SORTED
-        assert(lastPos < iter->get_position());
-        lastPos = iter->get_position();
+        assert(iter == mutations.begin() || last_key < iter->get_sort_key());
+        last_key = iter->get_sort_key();
 #endif
-        if (iter->get_position() >= pos) {
+        if (iter->get_sort_key() >= key) {
             break;
         }
     }
-    assert(iter == mutations.begin() || (iter - 1)->get_position() < pos);
-    assert(iter == mutations.end() || (iter)->get_position() >= pos);
+    assert(iter == mutations.begin() || (iter - 1)->get_sort_key() < key);
+    assert(iter == mutations.end() || (iter)->get_sort_key() >= key);
     return iter;
 }
 
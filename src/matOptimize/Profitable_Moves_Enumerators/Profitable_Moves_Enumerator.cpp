@@ -33,7 +33,7 @@ merge_mutation_LCA_to_dst(MAT::Node *child,
             child_mutation_iter++;
         }
         if (child_mutation_iter != child_mutation_end &&
-                child_mutation_iter->get_position() == m.get_position()) {
+                child_mutation_iter->get_sort_key() == m.get_sort_key()) {
             //match, the state of src (incremented allele in m) dosen't change,
             //but need to update  par_nuc as moving under another node
             nuc_one_hot new_par_allele = child_mutation_iter->get_mut_one_hot();
@@ -68,12 +68,12 @@ merge_mutation_src_to_LCA(const MAT::Node *root,
         if (!m.is_valid()) {
             continue;
         }
-        while (iter != end && iter->get_position() < m.get_position()) {
+        while (iter != end && iter->get_sort_key() < m.get_sort_key()) {
             //copy over input mutations
             merged_mutations.push_back(*iter);
             iter++;
         }
-        if (iter != end && iter->get_position() == m.get_position()) {
+        if (iter != end && iter->get_sort_key() == m.get_sort_key()) {
             nuc_one_hot new_par_nuc = m.get_par_one_hot();
             //match, only append if it is actually a state change
             if (new_par_nuc != iter->get_incremented()) {
@@ -102,8 +102,8 @@ static void init_mutation_change(MAT::Node* src, Mutation_Count_Change_Collectio
     }
 }
 struct Profitable_Move_Comparator {
-    bool operator()(const Profitable_Moves_ptr_t& lhs,const Profitable_Moves_ptr_t& rhs)const {
-        return lhs->radius_left>rhs->radius_left;
+    bool operator()(const Profitable_Moves& lhs,const Profitable_Moves& rhs)const {
+        return lhs.radius_left>rhs.radius_left;
     }
 };
 int individual_move(MAT::Node* src,MAT::Node* dst,MAT::Node* LCA,output_t& out,bool do_drift
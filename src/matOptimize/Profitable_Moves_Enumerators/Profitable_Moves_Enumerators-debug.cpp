@@ -14,11 +14,14 @@ extern std::unordered_map<MAT::Mutation,
        mutated_positions;
 
 struct Mutation_Count {
-    int position;
+    uint64_t sort_key;
     int count;
     std::unordered_map<std::string, std::vector<MAT::Node *>> mut_count;
     Mutation_Count() {}
-    Mutation_Count(int position) : position(position), count(0) {}
+    Mutation_Count(uint64_t sort_key) : sort_key(sort_key), count(0) {}
+    uint64_t get_sort_key() const {
+        return sort_key;
+    }
     // Mutation_Count(const MAT::Mutation& mut,int
     // count):position(mut.get_position()),count(count){}
 };
@@ -28,11 +31,11 @@ static void count_mutations(MAT::Node *start,
     size_t mut_idx = 0;
     for (const MAT::Mutation &m : start->mutations) {
         while (mut_idx != mutations_count.size() &&
-                mutations_count[mut_idx].position < m.get_position()) {
+                mutations_count[mut_idx].get_sort_key() < m.get_sort_key()) {
             mut_idx++;
         }
         if (mut_idx != mutations_count.size() &&
-                mutations_count[mut_idx].position == m.get_position() &&
+                mutations_count[mut_idx].get_sort_key() == m.get_sort_key() &&
                 m.is_valid()) {
             mutations_count[mut_idx].count++;
             auto res = mutations_count[mut_idx].mut_count.emplace(
@@ -113,7 +116,7 @@ int get_parsimmony_score_only(MAT::Node *src, MAT::Node *dst, MAT::Node *LCA,con
     std::vector<Mutation_Count> original_mutation_count;
     original_mutation_count.reserve(mutations.size());
     for (const auto &mut : mutations) {
-        original_mutation_count.emplace_back(mut.get_position());
+        original_mutation_count.emplace_back(mut.get_sort_key());
     }
     count_mutations(LCA, original_mutation_count);
     // MAT::Node *new_LCA = new_tree.get_node(LCA->identifier);
@@ -146,7 +149,7 @@ int get_parsimmony_score_only(MAT::Node *src, MAT::Node *dst, MAT::Node *LCA,con
     int parsimony_score_change = 0;
     for (size_t idx = 0; idx < mutations.size(); idx++) {
         int position = mutations[idx].get_position();
-        nuc_one_hot LCA_parent_state = get_parent_state(LCA, position);
+        nuc_one_hot LCA_parent_state = get_parent_state(LCA, mutations[idx].get_chromIdx(), position);
         std::vector<uint8_t> boundary1_major_allele(
             new_bfs_ordered_nodes.size() + 8);
         MAT::Mutation mut(position);
@@ -59,6 +59,9 @@ class Mutation_Count_Change {
     int get_position() const {
         return position;
     }
+    uint64_t get_sort_key() const {
+        return MAT::mutation_sort_key(chromIdx, position);
+    }
     nuc_one_hot get_decremented() const { //assert(decremented_allele!=0xff);
         return decremented_allele;
     }
@@ -102,7 +105,7 @@ class Mutation_Count_Change {
         return 0;
     }
     bool operator<(const Mutation_Count_Change &rhs) const {
-        return position < rhs.position;
+        return get_sort_key() < rhs.get_sort_key();
     }
     void set_par_nuc(nuc_one_hot par_nuc) {
         par_state=par_nuc;
@@ -110,7 +113,7 @@ class Mutation_Count_Change {
 };
 
 static bool operator<(const MAT::Mutation &lhs, const Mutation_Count_Change &rhs) {
-    return lhs.get_position() < rhs.get_position();
+    return lhs.get_sort_key() < rhs.get_sort_key();
 }
 typedef std::vector<Mutation_Count_Change,stack_allocator<Mutation_Count_Change>> Mutation_Count_Change_Collection_FIFO;
 
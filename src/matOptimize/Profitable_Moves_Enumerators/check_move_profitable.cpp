@@ -25,21 +25,16 @@ bool output_result(MAT::Node *src, MAT::Node *dst, MAT::Node *LCA,
             output.score_change = parsimony_score_change;
             output.moves->clear();
         }
-        Profitable_Moves_ptr_t new_move = Profitable_Moves_ptr_t(new Profitable_Moves);
-        new_move->score_change = parsimony_score_change;
-        new_move->src = src;
-        new_move->dst=dst;
-        new_move->LCA = LCA;
-        new_move->radius_left=radius_left;
+        Profitable_Moves new_move{parsimony_score_change,src,dst,LCA,radius_left};
         //assert(dst == LCA || new_move->dst_to_LCA.back()->parent == LCA);
         //assert(src->parent == LCA ||new_move->src_to_LCA.back()->parent == LCA);
 #ifdef DEBUG_PARSIMONY_SCORE_CHANGE_CORRECT
         std::unordered_set<int> node_idx_set;
         node_idx_set.insert(src->bfs_index);
-        for (auto node : new_move->src_to_LCA) {
+        for (auto node : new_move.src_to_LCA) {
             assert(node_idx_set.insert(node->bfs_index).second);
         }
-        for (auto node : new_move->dst_to_LCA) {
+        for (auto node : new_move.dst_to_LCA) {
             assert(node_idx_set.insert(node->bfs_index).second);
         }
 #endif
@@ -55,7 +55,7 @@ bool LCA_place_mezzanine(
         // it is not because the mutation at src_branch_node, so still the same
         //parsimony score as inserting here or its descendant, so cannot be the sole reason of trying here.
         while (added_iter < added_end &&
-                added_iter->get_position() < m.get_position()) {
+                added_iter->get_sort_key() < m.get_sort_key()) {
             added_no_match(*added_iter, out, parsimony_score_change);
             //assert(added_iter < added_end );
             added_iter++;
@@ -66,13 +66,13 @@ bool LCA_place_mezzanine(
         int score_change = 0;
         //Override the Fitch set of src_branch_node if modified
         if (src_branch_node_change_iter != src_branch_node_change_end &&
-                src_branch_node_change_iter->get_position() == m.get_position()) {
+                src_branch_node_change_iter->get_sort_key() == m.get_sort_key()) {
             major_allele = get_new_state_from_change(m, *src_branch_node_change_iter);
             src_branch_node_change_iter++;
         }
         //Coincide
         if (added_iter < added_end &&
-                m.get_position() == added_iter->get_position()) {
+                m.get_sort_key() == added_iter->get_sort_key()) {
             if (added_iter->get_incremented()&major_allele) {
                 new_major_allele=added_iter->get_incremented()&major_allele;
             } else {
@@ -187,7 +187,7 @@ static void checker(int par_score_from_split,int par_score_from_split_TEST,const
     assert(split_allele_cnt_change_TEST.empty()||split_allele_cnt_change_TEST.back().get_incremented()==split_allele_cnt_change.back().get_incremented());
     assert(split_allele_cnt_change_TEST.empty()||split_allele_cnt_change_TEST.back().get_decremented()==split_allele_cnt_change.back().get_decremented());
     assert(split_allele_cnt_change_TEST.empty()||split_allele_cnt_change_TEST.back().get_par_state()==split_allele_cnt_change.back().get_par_state());
-    assert(split_allele_cnt_change_TEST.empty()||split_allele_cnt_change_TEST.back().get_position()==split_allele_cnt_change.back().get_position());
+    assert(split_allele_cnt_change_TEST.empty()||split_allele_cnt_change_TEST.back().get_sort_key()==split_allele_cnt_change.back().get_sort_key());
 }
 #endif
 template<typename go_descendant, typename S>
@@ -228,7 +228,7 @@ int downward_integrated(MAT::Node *node, int radius_left,
         if (ignore_iter(mut.get_position())) {
             continue;
         }
-        while (iter->get_position() < mut.get_position()) {
+        while (iter->get_sort_key() < mut.get_sort_key()) {
 #ifdef CHECK_BRANCH_REIMPLEMENT
             add_node_split(
                 *iter, split_allele_cnt_change_TEST, par_score_from_split_TEST);
@@ -243,7 +243,7 @@ int downward_integrated(MAT::Node *node, int radius_left,
 #endif
             iter++;
         }
-        if (iter->get_position() == mut.get_position()) {
+        if (iter->get_sort_key() == mut.get_sort_key()) {
 #ifdef CHECK_BRANCH_REIMPLEMENT
             add_node_split(
                 mut, mut.get_all_major_allele(), iter->get_incremented(),
@@ -38,7 +38,7 @@ struct initer {
 initer init;
 
 struct Sensitive_Alleles {
-    int postion;
+    uint64_t sort_key;
     uint16_t decrement_effect;
     uint16_t increment_effect;
     std::array<node_info*, 4> last_addable_idxes;
@@ -131,7 +131,7 @@ static void filter_output(const MAT::Mutation &mut,
     if (effect.first != default_decrement_effect[mut_idx] ||
             effect.second != default_increment_effect[mut_idx]) {
         out.push_back(
-            Sensitive_Alleles{mut.get_position(), effect.first, effect.second,last_addable_idx});
+            Sensitive_Alleles{mut.get_sort_key(), effect.first, effect.second,last_addable_idx});
     }
 }
 
@@ -173,11 +173,11 @@ struct Walker : public tbb::task {
         auto iter = sensitive_locus.begin();
         std::pair<uint16_t, uint16_t> effect;
         for (auto &mut : to_set->mutations) {
-            while (iter->postion < mut.get_position()) {
+            while (iter->sort_key < mut.get_sort_key()) {
                 iter++;
             }
             std::array<node_info*, 4> last_addable_idxes;
-            if (mut.get_position() == iter->postion) {
+            if (mut.get_sort_key() == iter->sort_key) {
                 effect = update_sensitve_allele(*iter, mut);
                 register_change(effect.second,*iter,mut,to_set,last_addable_idxes);
             } else {
@@ -189,7 +189,7 @@ struct Walker : public tbb::task {
             }
         }
         if (output) {
-            output->push_back(Sensitive_Alleles{INT_MAX});
+            output->push_back(Sensitive_Alleles{UINT64_MAX});
         }
     }
     tbb::task *execute() override {
@@ -238,18 +238,20 @@ void adjust_all(MAT::Tree &tree) {
         std::array<node_info*, 4> last_addable_idx{nullptr,nullptr,nullptr,nullptr};
         filter_output(mut, effect, task_root->sensitive_locus,last_addable_idx);
     }
-    task_root->sensitive_locus.push_back(Sensitive_Alleles{INT_MAX});
+    task_root->sensitive_locus.push_back(Sensitive_Alleles{UINT64_MAX});
     tbb::task::spawn_root_and_wait(*task_root);
-    auto dfs_ordered_nodes=tree.depth_first_expansion();
+    const auto& dfs_ordered_nodes=tree.get_dfs_order();
     output_addable_idxes(pos_tree,dfs_ordered_nodes);
     size_t max_change=0;
     size_t total=0;
+    size_t total_bytes=0;
     for (const auto& pos_nuc : addable_idxes) {
         auto this_size=pos_nuc.end_idxes.size();
         max_change=std::max(max_change,this_size);
         total+=this_size;
+        total_bytes+=pos_nuc.end_idxes.capacity()*sizeof(uint32_t)+pos_nuc.nodes.capacity()*sizeof(range_tree_node);
     }
-    fprintf(stderr, "Total %zu,max %zu \n",total,max_change);
+    fprintf(stderr, "Total %zu,max %zu, range trees take %zu MB \n",total,max_change,total_bytes>>20);
     fprintf(stderr, "Updating sensitive alleles take %ld sec",
             std::chrono::duration_cast<std::chrono::seconds>(
                 std::chrono::steady_clock::now() - start)
@@ -268,7 +270,7 @@ static void check(MAT::Node *start_node, nuc_one_hot incremented,
     int change_so_far = 0;
     int expected_change = mut.get_sensitive_increment() & incremented ? -1 : 0;
     while (start_node) {
-        auto iter = start_node->mutations.find(mut.get_position());
+        auto iter = start_node->mutations.find(mut);
         if (iter == start_node->mutations.end()) {
             auto change = mut_count_change.get_default_change_internal();
             log.emplace_back(change_log{nullptr, change, start_node});
@@ -102,9 +102,9 @@ template <typename Functor> class process_LCA {
     // Sensitive loci at LCA node, but have no explicit change in src or dst,
     // only useful for removing src, when the mut_nuc (a major allele) is
     // decremented
-    void LCA_no_match(int end_pos, range<MAT::Mutation> &LCA_mut,
+    void LCA_no_match(uint64_t end_key, range<MAT::Mutation> &LCA_mut,
                       Functor &functor) {
-        while (LCA_mut && LCA_mut->get_position() < end_pos) {
+        while (LCA_mut && LCA_mut->get_sort_key() < end_key) {
             functor.LCA_no_match(*LCA_mut);
             LCA_mut++;
         }
@@ -124,13 +124,13 @@ template <typename Functor> class process_LCA {
     // encountered
     void LCA_dst(range<MAT::Mutation> &LCA_mut,
                  range<Mutation_Count_Change> &dst_add_count_iter,
-                 int end_pos, Functor &functor) {
+                 uint64_t end_key, Functor &functor) {
 
         while (dst_add_count_iter &&
-                dst_add_count_iter->get_position() < end_pos) {
-            LCA_no_match(dst_add_count_iter->get_position(), LCA_mut, functor);
+                dst_add_count_iter->get_sort_key() < end_key) {
+            LCA_no_match(dst_add_count_iter->get_sort_key(), LCA_mut, functor);
             if (LCA_mut &&
-                    LCA_mut->get_position() == dst_add_count_iter->get_position()) {
+                    LCA_mut->get_sort_key() == dst_add_count_iter->get_sort_key()) {
                 functor.LCA_dst_match(*LCA_mut, *dst_add_count_iter);
                 LCA_mut++;
             } else {
@@ -146,8 +146,8 @@ template <typename Functor> class process_LCA {
     LCA_src_match(range<Mutation_Count_Change> &dst_add_count_iter,
                   const Mutation_Count_Change &src_count_change,
                   const MAT::Mutation &LCA_mutation, Functor &functor) {
-        if (dst_add_count_iter && dst_add_count_iter->get_position() ==
-                src_count_change.get_position()) {
+        if (dst_add_count_iter && dst_add_count_iter->get_sort_key() ==
+                src_count_change.get_sort_key()) {
             functor.LCA_src_dst_match(LCA_mutation, src_count_change,
                                       *dst_add_count_iter);
             dst_add_count_iter++;
@@ -176,12 +176,12 @@ template <typename Functor> class process_LCA {
                   Functor &functor, Tag_t tag) {
         // process fitch set change on dst branch node before this changed
         // allele from src branch node
-        LCA_dst(LCA_mut, dst_add_count_iter, src_count_change.get_position(),
+        LCA_dst(LCA_mut, dst_add_count_iter, src_count_change.get_sort_key(),
                 functor);
         // same for smaller LCA sensitive loci
-        LCA_no_match(src_count_change.get_position(), LCA_mut, functor);
+        LCA_no_match(src_count_change.get_sort_key(), LCA_mut, functor);
         if (LCA_mut &&
-                LCA_mut->get_position() == src_count_change.get_position()) {
+                LCA_mut->get_sort_key() == src_count_change.get_sort_key()) {
             LCA_src_match(dst_add_count_iter, src_count_change, *LCA_mut,
                           functor);
             LCA_mut++;
@@ -190,8 +190,8 @@ template <typename Functor> class process_LCA {
             // also a mismatch for dst if src is mismatch, and they won't
             // interact to change the major allele, as the allele change tend
             // toward cancelling
-            if (dst_add_count_iter && dst_add_count_iter->get_position() ==
-                    src_count_change.get_position()) {
+            if (dst_add_count_iter && dst_add_count_iter->get_sort_key() ==
+                    src_count_change.get_sort_key()) {
                 functor.parsimony_score_change +=
                     dst_add_count_iter->get_default_change_internal();
                 dst_add_count_iter++;
@@ -239,7 +239,7 @@ template <typename Functor> class process_LCA {
             from_dst_add);
         iter_src(from_src_remove, LCA_mut, dst_add_count_iter, functor,
                  typename Functor::remaining_LCA_useful());
-        LCA_dst(LCA_mut, dst_add_count_iter, INT_MAX, functor);
+        LCA_dst(LCA_mut, dst_add_count_iter, UINT64_MAX, functor);
         LCA_no_match_remaining(LCA_mut, functor,
                                typename Functor::remaining_LCA_useful());
     }
@@ -19,12 +19,12 @@ template <typename Functor> class merge_func {
 
     void process_arg1(const typename T1::value_type& ele,range<typename T2::value_type>& T2_iter, Functor &functor) {
         //consume arg2 element smaller than arg1
-        while (T2_iter && T2_iter->get_position() < ele.get_position()) {
+        while (T2_iter && T2_iter->get_sort_key() < ele.get_sort_key()) {
             functor.T2_only(*T2_iter);
             T2_iter++;
         }
         //equal
-        if (T2_iter && T2_iter->get_position() == ele.get_position()) {
+        if (T2_iter && T2_iter->get_sort_key() == ele.get_sort_key()) {
             functor.T1_T2_match(ele, *T2_iter);
             T2_iter++;
         } else {
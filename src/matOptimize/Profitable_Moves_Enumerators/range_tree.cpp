@@ -13,14 +13,24 @@
 #include <utility>
 #include <iterator>
 #include <vector>
-#include <memory>
+#include <deque>
 #define MAX_DIST 16
 std::vector<range_tree> addable_idxes;
+struct range_tree_temp;
+//Temporary nodes of the range tree of one position. Nodes dropped while building (merged into another node)
+//are put on a free list and reused, so the temporary tree only holds about the nodes still reachable
+struct range_tree_arena {
+    std::deque<range_tree_temp> nodes;
+    std::vector<range_tree_temp*> free_nodes;
+    template<typename... args_t>
+    range_tree_temp* make(args_t&&... args);
+    void drop(range_tree_temp* node);
+};
 struct range_tree_temp {
     uint32_t dfs_start_idx;
     uint32_t dfs_end_idx;
     std::array<LEVEL_T, 4> min_level;
-    std::vector<std::shared_ptr<range_tree_temp>> children;
+    std::vector<range_tree_temp*> children;
     LEVEL_T level;
     LEVEL_T secondary_level;
     bool is_ori_node;
@@ -73,9 +83,9 @@ struct range_tree_temp {
         process_child(node);
         is_ori_node=false;
     }
-    range_tree_temp(std::vector<std::shared_ptr<range_tree_temp>>& new_children,int node_size,const MAT::Node* node) {
+    range_tree_temp(std::vector<range_tree_temp*>& new_children,int node_size,const MAT::Node* node,range_tree_arena& arena) {
         struct idx_cmp {
-            bool operator()(const std::shared_ptr<range_tree_temp>& a, const std::shared_ptr<range_tree_temp>& b) const {
+            bool operator()(const range_tree_temp* a, const range_tree_temp* b) const {
                 return a->dfs_start_idx<b->dfs_start_idx;
             }
         };
@@ -89,13 +99,14 @@ struct range_tree_temp {
                     children.push_back(*iter);
                 } else {
                     children.insert(children.end(),(*iter)->children.begin(),(*iter)->children.end());
+                    arena.drop(*iter);
                 }
             }
             assert((int)children.size()<=node_size);
         } else if (new_children.size()<=MAX_DIST) {
             children.reserve(MAX_DIST);
             struct size_cmp {
-                bool operator()(const std::shared_ptr<range_tree_temp>a, const std::shared_ptr<range_tree_temp> b) const {
+                bool operator()(const range_tree_temp*a, const range_tree_temp* b) const {
                     return a->children.size()>b->children.size();
                 }
             };
@@ -111,6 +122,7 @@ struct range_tree_temp {
                         children.push_back(child);
                     } else {
                         children.insert(children.end(),child->children.begin(),child->children.end());
+                        arena.drop(child);
                     }
                 }
             }
@@ -122,11 +134,11 @@ struct range_tree_temp {
                 auto iter=new_children.begin();
                 auto end=new_children.end();
                 while (end-iter>MAX_DIST) {
-                    children.emplace_back(new range_tree_temp(iter,iter+MAX_DIST,node));
+                    children.push_back(arena.make(iter,iter+MAX_DIST,node));
                     iter+=MAX_DIST;
                 }
                 if (iter!=end) {
-                    children.emplace_back(new range_tree_temp(iter,end,node));
+                    children.push_back(arena.make(iter,end,node));
                 }
                 if (children.size()>MAX_DIST) {
                     children.swap(new_children);
@@ -143,12 +155,12 @@ struct range_tree_temp {
         is_ori_node=false;
     }
 
-    void update_level(const std::shared_ptr<range_tree_temp>& other) {
+    void update_level(const range_tree_temp* other) {
         for (int i=0; i<4; i++) {
             min_level[i]=std::min(min_level[i],other->min_level[i]);
         }
     }
-    void cover(const std::shared_ptr<range_tree_temp>& other) {
+    void cover(range_tree_temp* other) {
         update_level(other);
         if (children.empty()) {
             if (other->is_ori_node) {
@@ -163,7 +175,7 @@ struct range_tree_temp {
             return;
         }
         //Merge
-        std::vector<std::shared_ptr<range_tree_temp>> new_children;
+        std::vector<range_tree_temp*> new_children;
         new_children.reserve(children.size()+other->children.size());
         auto iter=children.begin();
         auto other_start_idx=other->dfs_start_idx;
@@ -182,7 +194,7 @@ struct range_tree_temp {
         children.swap(new_children);
 
     }
-    bool can_cover(const std::shared_ptr<range_tree_temp>& other) const {
+    bool can_cover(const range_tree_temp* other) const {
         return dfs_start_idx<other->dfs_start_idx&&dfs_end_idx>=other->dfs_end_idx;
     }
 
@@ -191,8 +203,24 @@ struct range_tree_temp {
     }
 };
 
+template<typename... args_t>
+range_tree_temp* range_tree_arena::make(args_t&&... args) {
+    if (free_nodes.empty()) {
+        nodes.emplace_back(std::forward<args_t>(args)...);
+        return &nodes.back();
+    }
+    auto out=free_nodes.back();
+    free_nodes.pop_back();
+    *out=range_tree_temp(std::forward<args_t>(args)...);
+    return out;
+}
+void range_tree_arena::drop(range_tree_temp* node) {
+    std::vector<range_tree_temp*>().swap(node->children);
+    free_nodes.push_back(node);
+}
+
 struct bfs_queue_content {
-    std::shared_ptr<range_tree_temp> child_to_push;
+    range_tree_temp* child_to_push;
     size_t par_idx;
 };
 struct priority_bfs_queue_comp {
@@ -207,7 +235,7 @@ struct priority_bfs_queue_comp {
         return false;
     }
 };
-/*static void set_secondary_level(std::shared_ptr<range_tree_temp>& node,uint8_t par_level,uint8_t par_secondary_level){
+/*static void set_secondary_level(range_tree_temp*& node,uint8_t par_level,uint8_t par_secondary_level){
     if (node->level==par_level) {
         node->secondary_level=par_secondary_level+1;
     }else{
@@ -218,7 +246,7 @@ struct priority_bfs_queue_comp {
     }
 }*/
 typedef std::priority_queue<bfs_queue_content,std::vector<bfs_queue_content>,priority_bfs_queue_comp> priority_bfs_queue;
-static void flatten(std::shared_ptr<range_tree_temp> top, std::vector<range_tree_node>& out,size_t node_count) {
+static void flatten(range_tree_temp* top, std::vector<range_tree_node>& out,size_t node_count) {
     out.reserve(node_count*2);
     //set_secondary_level(top, -1, -1);
     std::vector<bfs_queue_content> container;
@@ -253,7 +281,7 @@ static void flatten(std::shared_ptr<range_tree_temp> top, std::vector<range_tree
     }
 }
 struct temp_tree_build_comp {
-    bool operator()(const std::shared_ptr<range_tree_temp>& a,const std::shared_ptr<range_tree_temp>& b)const {
+    bool operator()(const range_tree_temp* a,const range_tree_temp* b)const {
         auto a_idx=a->covering_node->dfs_index;
         auto b_idx=b->covering_node->dfs_index;
         if (a_idx<b_idx) {
@@ -264,7 +292,7 @@ struct temp_tree_build_comp {
         return false;
     }
 };
-typedef std::priority_queue<std::shared_ptr<range_tree_temp>,std::vector<std::shared_ptr<range_tree_temp>>,temp_tree_build_comp> tree_build_heap_t;
+typedef std::priority_queue<range_tree_temp*,std::vector<range_tree_temp*>,temp_tree_build_comp> tree_build_heap_t;
 void make_range_tree(const std::vector<MAT::Node*>& dfs_ordered_nodes,tbb::concurrent_vector<node_info>& in,range_tree& out,size_t idx) {
     if (in.empty()) {
         return;
@@ -272,17 +300,20 @@ void make_range_tree(const std::vector<MAT::Node*>& dfs_ordered_nodes,tbb::concu
     out.nodes.clear();
     out.end_idxes.clear();
     size_t node_count=0;
-    std::vector<std::shared_ptr<range_tree_temp>> content;
+    range_tree_arena arena;
+    std::vector<range_tree_temp*> content;
     content.reserve(in.size());
     for (const auto& node : in) {
-        content.emplace_back(new range_tree_temp(node,dfs_ordered_nodes));
+        content.push_back(arena.make(node,dfs_ordered_nodes));
     }
+    //not needed after the leaves are made, release it before the temporary tree grows
+    tbb::concurrent_vector<node_info>().swap(in);
 
     tree_build_heap_t heap(temp_tree_build_comp(),std::move(content));
-    std::shared_ptr<range_tree_temp> top;
+    range_tree_temp* top;
     while (true) {
         top=heap.top();
-        std::vector<std::shared_ptr<range_tree_temp>> child_nodes({top});
+        std::vector<range_tree_temp*> child_nodes({top});
         heap.pop();
         int node_count=std::max(top->children.size(),(size_t)1);
         /*if (top->covering_node->dfs_index==73050&&idx==241) {
@@ -292,12 +323,17 @@ void make_range_tree(const std::vector<MAT::Node*>& dfs_ordered_nodes,tbb::concu
             if (heap.top()->dfs_start_idx==top->dfs_start_idx) {
                 assert(heap.top()->dfs_end_idx==top->dfs_end_idx);
                 top->update_level(heap.top());
+                arena.drop(heap.top());
             } else if (top->can_cover(heap.top())) {
                 node_count+=std::max(heap.top()->children.size(),(size_t)1);
                 if (top->children.empty()) {
                     node_count--;
                 }
                 top->cover(heap.top());
+                //its children are moved to top
+                if (!heap.top()->is_ori_node) {
+                    arena.drop(heap.top());
+                }
             } else if(heap.top()->can_cover(top)) {
                 assert(false);
             } else {
@@ -308,7 +344,9 @@ void make_range_tree(const std::vector<MAT::Node*>& dfs_ordered_nodes,tbb::concu
         }
 
         if (child_nodes.size()!=1)  {
-            top=std::shared_ptr<range_tree_temp>(new range_tree_temp(child_nodes,node_count,top->covering_node));
+            //its constructor adds intermediate nodes to the arena and drops merged children, so cannot be constructed in place
+            range_tree_temp merged(child_nodes,node_count,top->covering_node,arena);
+            top=arena.make(std::move(merged));
         }
 
         if(!top->covering_node->parent) {
@@ -324,6 +362,8 @@ void make_range_tree(const std::vector<MAT::Node*>& dfs_ordered_nodes,tbb::concu
     }*/
     flatten(top, out.nodes,node_count);
     out.nodes.push_back(range_tree_node{UINT32_MAX,UINT32_MAX});
+    //flatten reserved for the worst case, these are kept for the whole round
+    out.nodes.shrink_to_fit();
     out.end_idxes.reserve(out.nodes.size());
     for(const auto& node: out.nodes) {
         assert(out.end_idxes.empty()||out.end_idxes.back()==UINT32_MAX||out.end_idxes.back()<=node.dfs_end_idx);
@@ -95,12 +95,12 @@ static nuc_one_hot allele_cnt_change_middle(
     Mutation_Count_Change_Collection &allele_change_out,
     int &next_src_par_score,int&) {
     nuc_one_hot major_allele = mut.get_all_major_allele();
-    while (src_allele_cnt_change_iter->get_position() < mut.get_position()) {
+    while (src_allele_cnt_change_iter->get_sort_key() < mut.get_sort_key()) {
         auto change = src_allele_cnt_change_iter->get_default_change_internal();
         next_src_par_score += change;
         src_allele_cnt_change_iter++;
     }
-    if (src_allele_cnt_change_iter->get_position() == mut.get_position()) {
+    if (src_allele_cnt_change_iter->get_sort_key() == mut.get_sort_key()) {
         int score_change = 0;
         major_allele = decrement_increment_mutation_count(
                            mut, (Mutation_Count_Change)*src_allele_cnt_change_iter,
@@ -130,14 +130,14 @@ static nuc_one_hot allele_cnt_change_middle(
     Mutation_Count_Change_Collection &allele_change_out,
     int &next_src_par_score, int &src_side_lower_bound) {
     nuc_one_hot major_allele = mut.get_all_major_allele();
-    while (src_allele_cnt_change_iter!=src_allele_cnt_change_end&&src_allele_cnt_change_iter->get_position() < mut.get_position()) {
+    while (src_allele_cnt_change_iter!=src_allele_cnt_change_end&&src_allele_cnt_change_iter->get_sort_key() < mut.get_sort_key()) {
         if (src_allele_cnt_change_iter->is_valid()) {
             next_src_par_score--;
             src_side_lower_bound--;
         }
         src_allele_cnt_change_iter++;
     }
-    if (src_allele_cnt_change_iter!=src_allele_cnt_change_end&&src_allele_cnt_change_iter->get_position() == mut.get_position()) {
+    if (src_allele_cnt_change_iter!=src_allele_cnt_change_end&&src_allele_cnt_change_iter->get_sort_key() == mut.get_sort_key()) {
         assert(src_allele_cnt_change_iter->get_all_major_allele()!=0xf);
         int score_change = -1;
         major_allele = decrement_mutation_count(
@@ -192,25 +192,25 @@ parent
     /
     src
 */
-MAT::Mutation* find_mut(MAT::Mutations_Collection& muts, int pos) {
-    auto iter=muts.find(pos);
+MAT::Mutation* find_mut(MAT::Mutations_Collection& muts, uint8_t chrom_idx, int pos) {
+    auto iter=muts.find(chrom_idx,pos);
     if (iter==muts.end()) {
         return nullptr;
     } else {
         return &(*iter);
     }
 }
-Mutation_Count_Change* find_mut(Mutation_Count_Change_Collection& muts, int pos) {
+Mutation_Count_Change* find_mut(Mutation_Count_Change_Collection& muts, uint8_t chrom_idx, int pos) {
     for (auto &m:muts ) {
-        if (m.get_position()==pos) {
+        if (m.get_sort_key()==MAT::mutation_sort_key(chrom_idx, pos)) {
             return &m;
         }
     }
     return nullptr;
 }
-Mutation_Count_Change_W_Lower_Bound_Downward* find_mut(Bounded_Mut_Change_Collection& muts, int pos) {
+Mutation_Count_Change_W_Lower_Bound_Downward* find_mut(Bounded_Mut_Change_Collection& muts, uint8_t chrom_idx, int pos) {
     for (auto &m:muts ) {
-        if (m.get_position()==pos) {
+        if (m.get_sort_key()==MAT::mutation_sort_key(chrom_idx, pos)) {
             return &m;
         }
     }
@@ -276,11 +276,11 @@ upward_integrated(src_side_info &src_side,
                                        src_side.src_par_score_lower_bound);
         // Get mutations if placed as children of parent node, and whether it is
         // profitable to place between parent node and parent of parent node
-        while (src_mut_iter->get_position() < mut.get_position()) {
+        while (src_mut_iter->get_sort_key() < mut.get_sort_key()) {
             src_mut_no_match(*src_mut_iter, node, mut_out, par_score_change_split_LCA, split_allele_count_change_out,sibling_muts);
             src_mut_iter++;
         }
-        if (src_mut_iter->get_position() == mut.get_position()) {
+        if (src_mut_iter->get_sort_key() == mut.get_sort_key()) {
             // accumulate mutation for placement
             if ( mut.get_par_one_hot() != src_mut_iter->get_incremented()) {
                 mut_out.emplace_back(*src_mut_iter,node,mut,sibling_muts);
@@ -1,23 +1,41 @@
+#pragma once
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <sys/mman.h>
 //See whether a valus appeared twice
 class Twice_Bloom_Filter {
     uint16_t* filter;
-    int hash(int pos) {
-        //This works for coronavirus whose length is 29903<32767, it basically does nothing
-        return pos&0x7FFF;
+    //number of positions tracked, power of 2
+    size_t slot_count;
+    size_t mmap_size;
+    size_t hash(int pos) {
+        //Exact for genomes no longer than slot_count, longer positions wrap around
+        return pos&(slot_count-1);
     }
   public:
-    Twice_Bloom_Filter() {
-        filter=(uint16_t*) mmap(0,4096*2,PROT_READ|PROT_WRITE,MAP_SHARED | MAP_ANONYMOUS,-1,0);
-        //perror("");
+    //genome_length is usually MAT::Mutation::refs.size()
+    Twice_Bloom_Filter(size_t genome_length=32768) {
+        //each uint16_t hold once and twice bits of 8 positions, so the filter takes slot_count/4 bytes,
+        //e.g. a 5 Mb genome rounds up to 2^23 slots and takes 2 MB
+        slot_count=8;
+        while (slot_count<genome_length) {
+            slot_count<<=1;
+        }
+        mmap_size=slot_count/8*sizeof(uint16_t);
+        filter=(uint16_t*) mmap(0,mmap_size,PROT_READ|PROT_WRITE,MAP_SHARED | MAP_ANONYMOUS,-1,0);
+        if (filter==MAP_FAILED) {
+            perror("Failed to allocate bloom filter");
+            exit(EXIT_FAILURE);
+        }
     }
     ~Twice_Bloom_Filter() {
-        munmap(filter, 4096);
+        munmap(filter, mmap_size);
     }
     void insert(int pos) {
-        int hash_code=hash(pos);
+        auto hash_code=hash(pos);
         //MSB is twice mask, LSB is once mask
         uint16_t* value_ptr=filter+(hash_code>>3);
         uint16_t value=*value_ptr;
@@ -30,8 +48,8 @@ class Twice_Bloom_Filter {
     }
 
     bool query(int pos) {
-        int hash_code=hash(pos);
+        auto hash_code=hash(pos);
         uint16_t value=filter[hash_code>>3];
         return value&(1<<((hash_code&7)+8));
     }
-};
\ No newline at end of file
+};
@@ -104,8 +104,8 @@ static void clean_up_internal_nodes_single_child_or_no_mutation(
         tree.erase_node(node_id);
     }
 }
-char get_major_allele(MAT::Node* node, int position) {
-    auto iter=node->mutations.find(position);
+char get_major_allele(MAT::Node* node, uint8_t chrom_idx, int position) {
+    auto iter=node->mutations.find(chrom_idx,position);
     if (iter==node->mutations.end()) {
         return 0;
     } else {
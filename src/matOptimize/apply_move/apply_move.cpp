@@ -11,9 +11,10 @@
 std::vector<size_t> changed_nodes;
 //Fix state of src node when its parent state changes to make it consistent with parent state
 //, and if a state change is needed, add to altered nodes list
-void clean_up_src_states(MAT::Node *src,
-                         std::vector<Altered_Node_t> &out) {
+int clean_up_src_states(MAT::Node *src,
+                        std::vector<Altered_Node_t> &out) {
     MAT::Mutations_Collection &in = src->mutations;
+    int valid_before = in.count_valid_mutations();
     //bool have_change = false;
     State_Change_Collection changed_state({state_change(NEW_SRC_MARK)});
     for (auto &mut : in) {
@@ -41,6 +42,7 @@ void clean_up_src_states(MAT::Node *src,
         out.emplace_back(src);
         out.back().changed_states = std::move(changed_state);
     }
+    return in.count_valid_mutations() - valid_before;
 }
 #ifdef CHECK_STATE_REASSIGN
 void compare_mutations(MAT::Node *old_nodes, MAT::Node *new_nodes) {
@@ -80,14 +82,63 @@ void compare_mutation_tree(MAT::Tree &t,MAT::Tree &new_tree) {
     new_tree.delete_nodes();
 }
 #endif
+//nodes a group of moves applied sequentially have altered, to be merged after all groups are applied
+struct Move_Group_Output {
+    std::vector<MAT::Node *> altered_node;
+    std::unordered_set<size_t> deleted_node_ptrs;
+    std::vector<MAT::Node *> nodes_to_clean;
+    int score_change=0;
+};
+/**
+ * @brief Group moves that may touch the same nodes. A move only changes nodes in the subtree of its LCA,
+    and the children of the parent of LCA (when LCA is left with one child and removed), so moves whose
+    subtrees rooted at the parent of LCA do not overlap can be applied concurrently.
+ * @param all_moves moves to group, their nodes need to have valid dfs index
+ * @return indices of moves in each group, in their original order
+ */
+static std::vector<std::vector<size_t>> group_independent_moves(const std::vector<Profitable_Moves_ptr_t> &all_moves) {
+    std::vector<std::pair<MAT::Node *, size_t>> region_roots;
+    region_roots.reserve(all_moves.size());
+    for (size_t move_idx = 0; move_idx < all_moves.size(); move_idx++) {
+        MAT::Node *region_root = all_moves[move_idx]->LCA;
+        if (region_root->parent) {
+            region_root = region_root->parent;
+        }
+        region_roots.emplace_back(region_root, move_idx);
+    }
+    std::sort(region_roots.begin(), region_roots.end(),
+              [](const std::pair<MAT::Node *, size_t> &first,
+    const std::pair<MAT::Node *, size_t> &second) {
+        if (first.first->dfs_index != second.first->dfs_index) {
+            return first.first->dfs_index < second.first->dfs_index;
+        }
+        return first.second < second.second;
+    });
+    //subtrees are either nested or disjoint, so a group ends when the next subtree starts after all subtrees in the group
+    std::vector<std::vector<size_t>> groups;
+    size_t group_end = 0;
+    for (const auto &region_root : region_roots) {
+        if (groups.empty() || region_root.first->dfs_index > group_end) {
+            groups.emplace_back();
+            group_end = region_root.first->dfs_end_index;
+        }
+        group_end = std::max(group_end, region_root.first->dfs_end_index);
+        groups.back().push_back(region_root.second);
+    }
+    for (auto &group : groups) {
+        std::sort(group.begin(), group.end());
+    }
+    return groups;
+}
 /**
  * @brief Apply all the non-conflicting moves
  * @param all_moves all non-conflicting moves to apply
  * @param t Tree where the nodes are
  * @param bfs_ordered_nodes all nodes in bfs order
  * @param to_filter nodes to search in the next round, with removed nodes filtered out
+ * @return change in parsimony score of t, which is also added to its running parsimony score
  */
-void apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
+int apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
 #ifdef CHECK_STATE_REASSIGN
                  ,
                  const Original_State_t &original_state
@@ -106,29 +157,47 @@ void apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
     FILE* log=fopen("moves", "w");
 #endif
 #endif
-    for (const auto &move : all_moves) {
-        //skip moves whose end points have been deleted
-        if (deleted_node_ptrs.count((size_t)move->src) ||
-                deleted_node_ptrs.count((size_t)move->get_dst())||move->src->parent==move->get_dst()) {
-            continue;
-        }
+    auto groups = group_independent_moves(all_moves);
+    //each applied move creates one internal node, reserve their ids so groups can create them concurrently
+    size_t first_new_node_id = t.reserve_node_ids(all_moves.size());
+    std::vector<Move_Group_Output> group_outputs(groups.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, groups.size(), 1),
+    [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t group_idx = r.begin(); group_idx < r.end(); group_idx++) {
+            auto &group_out = group_outputs[group_idx];
+            for (auto move_idx : groups[group_idx]) {
+                const auto &move = all_moves[move_idx];
+                //skip moves whose end points have been deleted, only moves in the same group can delete them
+                if (group_out.deleted_node_ptrs.count((size_t)move->src) ||
+                        group_out.deleted_node_ptrs.count((size_t)move->get_dst())||move->src->parent==move->get_dst()) {
+                    continue;
+                }
 #ifdef CHECK_STATE_REASSIGN
 #ifdef SINGLE_THREAD_TEST
-        fprintf(stderr, "%s\tto\t%s\n",move->src->identifier.c_str(),move->get_dst()->identifier.c_str());
+                fprintf(stderr, "%s\tto\t%s\n",move->src->identifier.c_str(),move->get_dst()->identifier.c_str());
 #else
-        fprintf(log, "%s\tto\t%s\n",move->src->identifier.c_str(),move->get_dst()->identifier.c_str());
-        fflush(log);
+                fprintf(log, "%s\tto\t%s\n",move->src->identifier.c_str(),move->get_dst()->identifier.c_str());
+                fflush(log);
 #endif
 #endif
-        //fprintf(stderr, "applying move %zu to %zu \n",move->src->dfs_index,move->dst->dfs_index);
-        //Prelimary move perserving state of all nodes
-        move_node(move->src, move->get_dst(), altered_node, t,
-                  deleted_node_ptrs, nodes_to_clean);
-        /*std::unordered_set<std::string> to_check(samples);
-        for(auto node:dfs){
-            to_check.erase(node->identifier);
+                //fprintf(stderr, "applying move %zu to %zu \n",move->src->dfs_index,move->dst->dfs_index);
+                //Prelimary move perserving state of all nodes
+                group_out.score_change+=move_node(move->src, move->get_dst(), group_out.altered_node, t,
+                                                  group_out.deleted_node_ptrs, group_out.nodes_to_clean,
+                                                  first_new_node_id + move_idx);
+            }
         }
-        assert(to_check.empty());*/
+    });
+    int score_change=0;
+    for (auto &group_out : group_outputs) {
+        score_change+=group_out.score_change;
+        altered_node.insert(altered_node.end(), group_out.altered_node.begin(), group_out.altered_node.end());
+        nodes_to_clean.insert(nodes_to_clean.end(), group_out.nodes_to_clean.begin(), group_out.nodes_to_clean.end());
+        deleted_node_ptrs.insert(group_out.deleted_node_ptrs.begin(), group_out.deleted_node_ptrs.end());
+    }
+    //removed nodes are already detached, unregister them before the dfs so it is still valid afterwards
+    for(auto node:deleted_node_ptrs) {
+        t.erase_node(((MAT::Node*) node)->node_id);
     }
     //need to redo dfs, as the Fitch sankoff patching need to process nodes in dfs order to have the
     // major allele set of children of a node fully updated before assigning major allele to this node
@@ -152,24 +221,24 @@ void apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
 #endif
     //backward pass, patch major allele set
     if (!altered_node.empty()) {
-        reassign_backward_pass(altered_node, forward_pass_altered_nodes
+        score_change+=reassign_backward_pass(altered_node, forward_pass_altered_nodes
 #ifdef CHECK_STATE_REASSIGN
-                               ,
-                               new_tree
+                                             ,
+                                             new_tree
 #endif
-                              );
+                                            );
     }
     for (const auto node : nodes_to_clean) {
-        clean_up_src_states(node, forward_pass_altered_nodes);
+        score_change+=clean_up_src_states(node, forward_pass_altered_nodes);
     }
     //forward pass patch state from parent state and calibrated major allele set
     if (!forward_pass_altered_nodes.empty()) {
-        forward_pass(forward_pass_altered_nodes
+        score_change+=forward_pass(forward_pass_altered_nodes
 #ifdef CHECK_STATE_REASSIGN
-                     ,
-                     new_tree
+                                   ,
+                                   new_tree
 #endif
-                    );
+                                  );
     }
 #ifdef CHECK_STATE_REASSIGN
     compare_mutation_tree(t, new_tree);
@@ -177,7 +246,6 @@ void apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
     //filter out deleted nodes from nodes to search in the next round
     //delayed deletion of removed nodes (these are identified by there memory location, if freed to early, it can be reused)
     for(auto node:deleted_node_ptrs) {
-        t.erase_node(((MAT::Node*) node)->node_id);
         delete ((MAT::Node*) node);
     }
 #ifdef CHECK_STATE_REASSIGN
@@ -185,4 +253,6 @@ void apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
     fclose(log);
 #endif
 #endif
+    t.adjust_parsimony_score(score_change);
+    return score_change;
 }
\ No newline at end of file
@@ -9,14 +9,17 @@ struct state_change {
     uint8_t chr_idx;
     uint8_t old_state;
     uint8_t new_state;
-    state_change() : position(NEW_MARK) {}
-    state_change(int pos) : position(pos) {}
+    state_change() : position(NEW_MARK), chr_idx(0) {}
+    state_change(int pos) : position(pos), chr_idx(0) {}
     state_change(const MAT::Mutation &in, uint8_t old_state)
         : old_state(old_state) {
         position = in.get_position();
         chr_idx = in.get_chromIdx();
         new_state = in.get_mut_one_hot();
     }
+    uint64_t get_sort_key() const {
+        return MAT::mutation_sort_key(chr_idx, position);
+    }
 };
 typedef std::vector<state_change> State_Change_Collection;
 //used in backward pass to record nodes need to do backward pass, and their mut_nuc change
@@ -54,9 +57,9 @@ char merge_new_node_mutations(
     MAT::Mutations_Collection &shared_node_mutations_out,
     MAT::Mutations_Collection &sibling_node_mutations_out,
     MAT::Mutations_Collection &new_node_mutations_out);
-//insert a node between to_replace and its parent, then return it
+//insert a node with id new_node_id (reserved by Tree::reserve_node_ids) between to_replace and its parent, then return it
 MAT::Node *replace_with_internal_node(MAT::Node *to_replace,
-                                      MAT::Tree &tree);
+                                      MAT::Tree &tree, size_t new_node_id);
 /**
  * @brief Move src to dst, while perserving the state of all nodes
  * @param src
@@ -65,11 +68,14 @@ MAT::Node *replace_with_internal_node(MAT::Node *to_replace,
  * @param tree
  * @param deleted internal node lost all their children, or nodes with only one children left, so delete
  * @param nodes_to_clean src node or src_branch_node, or dst node that have their parent state changed due to branch splitting
+ * @param new_node_id reserved id for the internal node created by splitting the branch above dst
+ * @return change in parsimony score from moving src and removing nodes, before state reassignment
  */
-void move_node(MAT::Node *src, MAT::Node *dst,
+int move_node(MAT::Node *src, MAT::Node *dst,
                std::vector<MAT::Node *> &altered_node, MAT::Tree &tree,
                std::unordered_set<size_t> &deleted,
-               std::vector<MAT::Node *> &nodes_to_clean
+               std::vector<MAT::Node *> &nodes_to_clean,
+               size_t new_node_id
               );
 
 #ifdef CHECK_STATE_REASSIGN
@@ -77,7 +83,8 @@ MAT::Tree reassign_state_full(MAT::Tree &tree_in);
 void compare_mutation_tree(MAT::Tree &t,MAT::Tree &new_tree);
 #endif
 //update major allele set and boundary allele set of altered_nodes_in, output change in mut_nuc in nodes_with_changed_states_out(such changes are done with the assumption that the state of parent node is unchanged, but this assumption will be fixed in forward pass)
-void reassign_backward_pass(
+//return change in parsimony score
+int reassign_backward_pass(
     const std::vector<MAT::Node *> &altered_nodes_in,
     std::vector<Altered_Node_t> &nodes_with_changed_states_out
 #ifdef CHECK_STATE_REASSIGN
@@ -85,13 +92,14 @@ void reassign_backward_pass(
     MAT::Tree &new_tree
 #endif
 ) ;
-//reassign state of nodes in in to match with parent state if possible
-void forward_pass(std::vector<Altered_Node_t> &in
+//reassign state of nodes in in to match with parent state if possible, return change in parsimony score
+int forward_pass(std::vector<Altered_Node_t> &in
 #ifdef CHECK_STATE_REASSIGN
-                  ,
-                  MAT::Tree &new_tree
+                 ,
+                 MAT::Tree &new_tree
 #endif
-                 );
+                );
 //merge mutation vector of nodes with their parent node deleted because it only have 1 child left
 bool merge_mutation_single_child(MAT::Node *node,const MAT::Mutations_Collection &merge_with);
-void clean_up_src_states(MAT::Node *src,std::vector<Altered_Node_t> &out);
+//return change in parsimony score
+int clean_up_src_states(MAT::Node *src,std::vector<Altered_Node_t> &out);
@@ -104,28 +104,28 @@ static void check_changed(const MAT::Mutations_Collection &ori,
     auto end = ori.end();
     bool checked = false;
     for (const auto &mut : changed_mut) {
-        while (iter != end && iter->get_position() < mut.get_position()) {
+        while (iter != end && iter->get_sort_key() < mut.get_sort_key()) {
             if (iter->get_all_major_allele() != iter->get_par_one_hot()) {
                 assert(changed||no_check);
                 checked = true;
                 return;
             }
             if (iter->get_par_one_hot() != iter->get_mut_one_hot()) {
-                assert(state_change_iter->position == iter->get_position());
+                assert(state_change_iter->get_sort_key() == iter->get_sort_key());
                 assert(state_change_iter->new_state == iter->get_par_one_hot());
                 assert(state_change_iter->old_state == iter->get_mut_one_hot());
                 state_change_iter++;
             }
             iter++;
         }
-        if (iter != end && iter->get_position() == mut.get_position()) {
+        if (iter != end && iter->get_sort_key() == mut.get_sort_key()) {
             if (iter->get_all_major_allele() != mut.get_all_major_allele()) {
                 assert(changed||no_check);
                 checked = true;
                 return;
             }
             if (iter->get_mut_one_hot() != mut.get_mut_one_hot()) {
-                assert(state_change_iter->position == iter->get_position());
+                assert(state_change_iter->get_sort_key() == iter->get_sort_key());
                 assert(state_change_iter->new_state == mut.get_mut_one_hot());
                 assert(state_change_iter->old_state == iter->get_mut_one_hot());
                 state_change_iter++;
@@ -138,7 +138,7 @@ static void check_changed(const MAT::Mutations_Collection &ori,
                 return;
             }
             if (mut.get_mut_one_hot() != mut.get_par_one_hot()) {
-                assert(state_change_iter->position == mut.get_position());
+                assert(state_change_iter->get_sort_key() == mut.get_sort_key());
                 assert(state_change_iter->new_state == mut.get_mut_one_hot());
                 assert(state_change_iter->old_state == mut.get_par_one_hot());
                 state_change_iter++;
@@ -152,7 +152,7 @@ static void check_changed(const MAT::Mutations_Collection &ori,
             return;
         }
         if (iter->get_par_one_hot() != iter->get_mut_one_hot()) {
-            assert(state_change_iter->position == iter->get_position());
+            assert(state_change_iter->get_sort_key() == iter->get_sort_key());
             assert(state_change_iter->new_state == iter->get_par_one_hot());
             assert(state_change_iter->old_state == iter->get_mut_one_hot());
             state_change_iter++;
@@ -168,17 +168,17 @@ void check_major_state(MAT::Node *node, const MAT::Tree &new_tree) {
     auto ref_mut_end = ref_node->mutations.end();
     for (const auto &mut : node->mutations) {
         while (ref_mut_iter != ref_mut_end &&
-                ref_mut_iter->get_position() < mut.get_position()) {
+                ref_mut_iter->get_sort_key() < mut.get_sort_key()) {
             assert(ref_mut_iter->get_mut_one_hot() ==
                    ref_mut_iter->get_all_major_allele() &&
                    (!ref_mut_iter->get_boundary1_one_hot()||node->children.size()<=1));
             assert(
                 ref_mut_iter->get_mut_one_hot() ==
-                get_parent_state(node, ref_mut_iter->get_position()));
+                get_parent_state(node, ref_mut_iter->get_chromIdx(), ref_mut_iter->get_position()));
             ref_mut_iter++;
         }
         if (ref_mut_iter != ref_mut_end &&
-                ref_mut_iter->get_position() == mut.get_position()) {
+                ref_mut_iter->get_sort_key() == mut.get_sort_key()) {
             assert(ref_mut_iter->get_all_major_allele() ==
                    mut.get_all_major_allele());
             assert(ref_mut_iter->get_boundary1_one_hot() ==
@@ -195,7 +195,7 @@ void check_major_state(MAT::Node *node, const MAT::Tree &new_tree) {
                 mut.get_mut_one_hot() == mut.get_all_major_allele() &&
                 (!mut.get_boundary1_one_hot() || node->children.size() <= 1));
             assert(mut.get_mut_one_hot() ==
-                   get_parent_state(ref_node, mut.get_position()));
+                   get_parent_state(ref_node, mut.get_chromIdx(), mut.get_position()));
         }
     }
     while (ref_mut_iter != ref_mut_end) {
@@ -203,7 +203,7 @@ void check_major_state(MAT::Node *node, const MAT::Tree &new_tree) {
                ref_mut_iter->get_all_major_allele() &&
                (!ref_mut_iter->get_boundary1_one_hot()));
         assert(ref_mut_iter->get_mut_one_hot() ==
-               get_parent_state(node, ref_mut_iter->get_position()));
+               get_parent_state(node, ref_mut_iter->get_chromIdx(), ref_mut_iter->get_position()));
         ref_mut_iter++;
     }
 }
@@ -218,7 +218,7 @@ static bool adjust_single_child_node(MAT::Node *node,
     auto child_mut_end = child_mut.end();
     for (const auto &ori_mut : node->mutations) {
         while (child_mut_iter != child_mut_end &&
-                (child_mut_iter->get_position() < ori_mut.get_position())) {
+                (child_mut_iter->get_sort_key() < ori_mut.get_sort_key())) {
             // mutation unique to its only children (shouldn't happen), pull it
             // up to this node
             if (child_mut_iter->get_par_one_hot() !=
@@ -239,7 +239,7 @@ static bool adjust_single_child_node(MAT::Node *node,
         if ((child_mut_iter != child_mut_end) &&
                 (child_mut_iter->get_par_one_hot() !=
                  child_mut_iter->get_all_major_allele()) &&
-                (child_mut_iter->get_position() == ori_mut.get_position())) {
+                (child_mut_iter->get_sort_key() == ori_mut.get_sort_key())) {
             //the child mutated again at a mutated loci of this node
             new_mut.push_back(ori_mut);
             changed = true;
@@ -277,7 +277,7 @@ static bool adjust_single_child_node(MAT::Node *node,
             }
         }
         if ((child_mut_iter != child_mut_end) &&
-                (child_mut_iter->get_position() == ori_mut.get_position())) {
+                (child_mut_iter->get_sort_key() == ori_mut.get_sort_key())) {
             child_mut_iter++;
         }
     }
@@ -328,7 +328,7 @@ static bool adjust_node(MAT::Node *node,
     return changed;
 }
 
-void reassign_backward_pass(
+int reassign_backward_pass(
     const std::vector<MAT::Node *> &altered_nodes_in,
     std::vector<Altered_Node_t> &nodes_with_changed_states_out
 #ifdef CHECK_STATE_REASSIGN
@@ -341,20 +341,24 @@ void reassign_backward_pass(
     size_t last_idx = 0xffffffff;
 #endif
     bool changed;
+    int score_change=0;
     //iterate over nodes in leaf to root order to assign major allele set
     do {
 #ifdef CHECK_STATE_REASSIGN
         assert(heap->altered_node->dfs_index < last_idx);
         last_idx = heap->altered_node->dfs_index;
 #endif
+        int valid_before = heap->altered_node->mutations.count_valid_mutations();
         changed = adjust_node(heap->altered_node, heap->changed_states
 #ifdef CHECK_STATE_REASSIGN
                               ,
                               new_tree
 #endif
                              );
+        score_change += heap->altered_node->mutations.count_valid_mutations() - valid_before;
         if (changed) {
             heap->altered_node->set_self_changed();
         }
     } while (heap.next(changed));
+    return score_change;
 }
\ No newline at end of file
@@ -35,12 +35,12 @@ State_Change_Collection merge(const State_Change_Collection &in1,
             continue;
         }
         while (in1_iter != in1_end &&
-                in1_iter->position < in2_change.position) {
+                in1_iter->get_sort_key() < in2_change.get_sort_key()) {
             out.push_back(*in1_iter);
             in1_iter++;
         }
         out.push_back(in2_change);
-        if (in1_iter != in1_end && in1_iter->position == in2_change.position) {
+        if (in1_iter != in1_end && in1_iter->get_sort_key() == in2_change.get_sort_key()) {
             //The one from forward pass of ancestral nodes have accurate current parent state,
             if (in1_new) {
                 out.back().new_state = in1_iter->new_state;
@@ -199,7 +199,7 @@ void set_state_from_parent(MAT::Node *node,
     MAT::Mutations_Collection::const_iterator ref_end = ref_node->mutations.end();
 #endif
     for (auto &node_mut : node->mutations) {
-        while (iter != end && iter->position < node_mut.get_position()) {
+        while (iter != end && iter->get_sort_key() < node_mut.get_sort_key()) {
             //parental state change, but no old mutation at this loci
             unmatched_parent_state_change(node, new_mut, *iter
 #ifdef CHECK_STATE_REASSIGN
@@ -208,7 +208,7 @@ void set_state_from_parent(MAT::Node *node,
                                          );
             iter++;
         }
-        if (iter != end && iter->position == node_mut.get_position()) {
+        if (iter != end && iter->get_sort_key() == node_mut.get_sort_key()) {
             //match
             nuc_one_hot par_state = iter->new_state;
             nuc_one_hot new_state = node_mut.get_all_major_allele() & par_state;
@@ -259,16 +259,17 @@ void set_state_from_parent(MAT::Node *node,
     node->mutations.swap(new_mut);
 }
 
-void forward_pass(std::vector<Altered_Node_t> &in
+int forward_pass(std::vector<Altered_Node_t> &in
 #ifdef CHECK_STATE_REASSIGN
-                  ,
-                  MAT::Tree &new_tree
+                 ,
+                 MAT::Tree &new_tree
 #endif
-                 ) {
+                ) {
 #ifdef CHECK_STATE_REASSIGN
     int last_dfs_idx=0;
 #endif
     Forward_Pass_Heap heap(in);
+    int score_change=0;
     do {
         //set state of nodes in root to leaf order, maintained by the heap
         Altered_Node_t altered = *heap;
@@ -281,6 +282,7 @@ void forward_pass(std::vector<Altered_Node_t> &in
         for (auto child : altered.altered_node->children) {
             Altered_Node_t out(child);
             out.changed_states.emplace_back();
+            int valid_before = child->mutations.count_valid_mutations();
             set_state_from_parent(child, altered.changed_states,
                                   out.changed_states
 #ifdef CHECK_STATE_REASSIGN
@@ -288,10 +290,12 @@ void forward_pass(std::vector<Altered_Node_t> &in
                                   new_tree
 #endif
                                  );
+            score_change += child->mutations.count_valid_mutations() - valid_before;
             if (out.changed_states.size() > 1) {
                 //out have state change, so its children may have to have their state reset.
                 heap.push_back(out);
             }
         }
     } while (heap.next());
+    return score_change;
 }
\ No newline at end of file
@@ -61,7 +61,7 @@ bool merge_mutation_single_child(MAT::Node *node,
     auto end = merge_with.end();
     MAT::Mutations_Collection mutations;
     for (const auto &mut : node->mutations) {
-        while (iter != end && iter->get_position() < mut.get_position()) {
+        while (iter != end && iter->get_sort_key() < mut.get_sort_key()) {
             //mutation in parent of node, need to be merged to mutation of node to remove the parent of node
             if (iter->is_valid()) {
                 mutations.push_back(*iter);
@@ -72,7 +72,7 @@ bool merge_mutation_single_child(MAT::Node *node,
         }
         mutations.push_back(mut);
         auto &new_mut = mutations.back();
-        if (iter != end && iter->get_position() == mut.get_position()) {
+        if (iter != end && iter->get_sort_key() == mut.get_sort_key()) {
             //match, adjust parent state
             new_mut.set_par_one_hot(iter->get_par_one_hot());
             have_inconsistent_mut |= (mut.is_valid() ^ new_mut.is_valid());
@@ -101,11 +101,12 @@ bool merge_mutation_single_child(MAT::Node *node,
  * @param[out] nodes_to_clean add sibling of src , if any,
     a forward pass on them is needed, as their parent state have changed
  * @param[out] tree to remove removed node from all_nodes hashmap
+ * @param[out] score_change add change in number of valid mutations from removing nodes
  * @return the last surviving parent of src, need to do backward pass on it as its children set have changed
  */
 static MAT::Node *
 clean_up_after_remove(MAT::Node *node, std::unordered_set<size_t> &deleted,
-                      std::vector<MAT::Node *> &nodes_to_clean,MAT::Tree& tree) {
+                      std::vector<MAT::Node *> &nodes_to_clean,MAT::Tree& tree,int &score_change) {
     MAT::Node *parent_node = node->parent;
     //root node, cannot remove
     if (!parent_node) {
@@ -118,10 +119,11 @@ clean_up_after_remove(MAT::Node *node, std::unordered_set<size_t> &deleted,
             std::find(parent_children.begin(), parent_children.end(), node);
         parent_children.erase(iter);
         deleted.insert((size_t)node);
+        score_change -= node->mutations.count_valid_mutations();
         //tree.all_nodes.erase(node->identifier);
         //delete node;
         //this node is removed, its parental node may have similar situation
-        return clean_up_after_remove(parent_node, deleted, nodes_to_clean,tree);
+        return clean_up_after_remove(parent_node, deleted, nodes_to_clean,tree,score_change);
     } else if (node->children.size() == 1) {
         //node with one child left
         auto &parent_children = parent_node->children;
@@ -129,6 +131,7 @@ clean_up_after_remove(MAT::Node *node, std::unordered_set<size_t> &deleted,
         auto iter =
             std::find(parent_children.begin(), parent_children.end(), node);
         MAT::Node *child = node->children[0];
+        score_change -= node->mutations.count_valid_mutations() + child->mutations.count_valid_mutations();
         //child may have its parental state changed
         if (merge_mutation_single_child(child, node->mutations)) {
             nodes_to_clean.push_back(child);
@@ -148,6 +151,7 @@ clean_up_after_remove(MAT::Node *node, std::unordered_set<size_t> &deleted,
             }),
             child_mut.end());
         }
+        score_change += child->mutations.count_valid_mutations();
         //reattach , this replace node with child in parent_children vector
         *iter = child;
         child->parent = parent_node;
@@ -164,8 +168,8 @@ clean_up_after_remove(MAT::Node *node, std::unordered_set<size_t> &deleted,
     return node;
 }
 MAT::Node *replace_with_internal_node(MAT::Node *to_replace,
-                                      MAT::Tree &tree) {
-    MAT::Node *new_node = tree.create_node();
+                                      MAT::Tree &tree, size_t new_node_id) {
+    MAT::Node *new_node = tree.create_node_with_id(new_node_id);
     //new_node->identifier = std::to_string(++tree.curr_internal_node);
     new_node->parent = to_replace->parent;
     auto &to_replace_parent_children = to_replace->parent->children;
@@ -242,7 +246,7 @@ char merge_new_node_mutations(
     auto sibling_end = sibling_node_mutations.end();
     for (const auto &mut : new_node_mutations) {
         while (sibling_iter != sibling_end &&
-                sibling_iter->get_position() < mut.get_position()) {
+                sibling_iter->get_sort_key() < mut.get_sort_key()) {
             //unique to sibling node
             flags |= (new_internal_single_node(shared_node_mutations_out,
                                                *sibling_iter, true)
@@ -251,7 +255,7 @@ char merge_new_node_mutations(
             sibling_iter++;
         }
         if (sibling_iter != sibling_end &&
-                sibling_iter->get_position() == mut.get_position()) {
+                sibling_iter->get_sort_key() == mut.get_sort_key()) {
             //sibling node and new node have mutation at the same loci
             shared_node_mutations_out.push_back(mut);
             auto &shared_node_output_mut = shared_node_mutations_out.back();
@@ -318,9 +322,10 @@ void update_src_mutation(MAT::Node *src,
 MAT::Node *add_as_sibling(MAT::Node *&src, MAT::Node *&dst,
                           MAT::Mutations_Collection &other_unique,
                           MAT::Mutations_Collection &common, MAT::Tree &tree,
-                          char flag, std::vector<MAT::Node *> &nodes_to_clean) {
+                          char flag, std::vector<MAT::Node *> &nodes_to_clean,
+                          size_t new_node_id) {
     //split branch
-    MAT::Node *new_node = replace_with_internal_node(dst, tree);
+    MAT::Node *new_node = replace_with_internal_node(dst, tree, new_node_id);
     //set mutations
     new_node->mutations.swap(common);
     if (dst->is_leaf()) {
@@ -340,39 +345,48 @@ static MAT::Node *place_node_LCA(MAT::Node *&src, MAT::Node *parent,
                                  MAT::Tree &tree,
                                  MAT::Mutations_Collection &mutations,
                                  MAT::Node *sibling,
-                                 std::vector<MAT::Node *> &nodes_to_clean) {
+                                 std::vector<MAT::Node *> &nodes_to_clean,
+                                 size_t new_node_id, int &score_change) {
     MAT::Mutations_Collection this_unique;
     MAT::Mutations_Collection other_unique;
     MAT::Mutations_Collection common;
     auto flags = merge_new_node_mutations(mutations, sibling->mutations, common,
                                           other_unique, this_unique);
+    score_change -= src->mutations.count_valid_mutations() + sibling->mutations.count_valid_mutations();
     //otherwise, they have shared mutation, split the branch
     update_src_mutation(src, this_unique);
     MAT::Node *new_node = add_as_sibling(src, sibling, other_unique, common,
-                                         tree, flags, nodes_to_clean);
+                                         tree, flags, nodes_to_clean, new_node_id);
+    score_change += src->mutations.count_valid_mutations() + sibling->mutations.count_valid_mutations() +
+                    new_node->mutations.count_valid_mutations();
     new_node->set_self_changed();
     return new_node->parent;
 }
 
 static MAT::Node *place_node(MAT::Node *&src, MAT::Node *dst, MAT::Tree &tree,
                              MAT::Mutations_Collection &mutations,
-                             std::vector<MAT::Node *> &nodes_to_clean) {
+                             std::vector<MAT::Node *> &nodes_to_clean,
+                             size_t new_node_id, int &score_change) {
     MAT::Mutations_Collection this_unique;
     MAT::Mutations_Collection other_unique;
     MAT::Mutations_Collection common;
     auto flags = merge_new_node_mutations(mutations, dst->mutations, common,
                                           other_unique, this_unique);
+    score_change -= src->mutations.count_valid_mutations() + dst->mutations.count_valid_mutations();
     update_src_mutation(src, this_unique);
     //split branch
     MAT::Node *new_node = add_as_sibling(src, dst, other_unique, common,
-                                         tree, flags, nodes_to_clean);
+                                         tree, flags, nodes_to_clean, new_node_id);
+    score_change += src->mutations.count_valid_mutations() + dst->mutations.count_valid_mutations() +
+                    new_node->mutations.count_valid_mutations();
     return new_node->parent;
 }
 
-void move_node(MAT::Node *src, MAT::Node *dst,
+int move_node(MAT::Node *src, MAT::Node *dst,
                std::vector<MAT::Node *> &altered_node, MAT::Tree &tree,
                std::unordered_set<size_t> &deleted,
-               std::vector<MAT::Node *> &nodes_to_clean
+               std::vector<MAT::Node *> &nodes_to_clean,
+               size_t new_node_id
 #ifdef CHECK_PRIMARY_MOVE
                //,
                //Original_State_t original_state
@@ -383,7 +397,7 @@ void move_node(MAT::Node *src, MAT::Node *dst,
     std::vector<MAT::Node *> src_to_root_path;
     //find the path from src to dst again, and make sure dst didn't got moved under src by some previous moves
     if(!find_path_no_dfs(dst_to_root_path, src_to_root_path, src, dst)) {
-        return;
+        return 0;
     }
     //perserve ambiguous/boundary mutations of src
     for (const auto &mut : src->mutations) {
@@ -426,17 +440,18 @@ void move_node(MAT::Node *src, MAT::Node *dst,
     dst->set_self_changed();
     dst->set_self_moved();
     MAT::Node *dst_altered = dst;
+    int score_change = 0;
     //actually placing the node
     if (dst_to_root_path.empty()) {
         dst_altered = place_node_LCA(src, dst, tree, mutations,
-                                     src_to_root_path.back(), nodes_to_clean);
+                                     src_to_root_path.back(), nodes_to_clean, new_node_id, score_change);
         src_to_root_path.back()->set_self_changed();
     } else {
-        dst_altered = place_node(src, dst, tree, mutations, nodes_to_clean);
+        dst_altered = place_node(src, dst, tree, mutations, nodes_to_clean, new_node_id, score_change);
     }
     //push nodes with altered children for backward pass
     altered_node.push_back(
-        clean_up_after_remove(src_parent, deleted, nodes_to_clean,tree));
+        clean_up_after_remove(src_parent, deleted, nodes_to_clean,tree,score_change));
     altered_node.back()->set_self_changed();
     altered_node.push_back(dst_altered);
     altered_node.back()->set_self_changed();
@@ -445,11 +460,12 @@ void move_node(MAT::Node *src, MAT::Node *dst,
     get_mutation_set_from_root(src, after_move);
     auto size = before_move.size();
     for (size_t idx = 0; idx < size; idx++) {
-        assert(before_move[idx].get_position() ==
-               after_move[idx].get_position());
+        assert(before_move[idx].get_sort_key() ==
+               after_move[idx].get_sort_key());
         assert(before_move[idx].get_mut_one_hot() ==
                after_move[idx].get_mut_one_hot());
     }
     //check_samples(tree.root, original_state, &tree);
 #endif
+    return score_change;
 }
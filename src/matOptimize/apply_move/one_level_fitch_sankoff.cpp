@@ -15,10 +15,13 @@ struct Allele_Count_t {
     int get_position() const {
         return base.get_position();
     }
+    uint64_t get_sort_key() const {
+        return base.get_sort_key();
+    }
 
     //Merge 2 allele count toghether
     void operator+=(const Allele_Count_t &to_add) {
-        assert(base.get_position() == to_add.base.get_position());
+        assert(base.get_sort_key() == to_add.base.get_sort_key());
         for (int i = 0; i < 4; i++) {
             count[i] += to_add.count[i];
         }
@@ -26,7 +29,7 @@ struct Allele_Count_t {
     }
     //add from a raw mutation
     void operator+=(const MAT::Mutation &to_add) {
-        assert(base.get_position() == to_add.get_position());
+        assert(base.get_sort_key() == to_add.get_sort_key());
         for (int i = 0; i < 4; i++) {
             if ((1 << i) & to_add.get_all_major_allele()) {
                 count[i] += 1;
@@ -50,25 +53,25 @@ static void merge_allele_count(const type1 &in1, const type2 &in2,
     auto in1_iter = in1.begin();
     auto in1_end = in1.end();
 #ifdef MERGE_ALLELE_CHECK_ORDER
-    size_t last_in_pos = 0;
+    uint64_t last_in_key = 0;
 #endif
     for (const auto &other_mut : in2) {
         while (in1_iter != in1_end &&
-                in1_iter->get_position() < other_mut.get_position()) {
+                in1_iter->get_sort_key() < other_mut.get_sort_key()) {
             out.emplace_back(*in1_iter);
 #ifdef MERGE_ALLELE_CHECK_ORDER
-            assert(last_in_pos < in1_iter->get_position());
-            last_in_pos = in1_iter->get_position();
+            assert(last_in_key < in1_iter->get_sort_key());
+            last_in_key = in1_iter->get_sort_key();
 #endif
             in1_iter++;
         }
         out.emplace_back(other_mut);
 #ifdef MERGE_ALLELE_CHECK_ORDER
-        assert(last_in_pos < other_mut.get_position());
-        last_in_pos = other_mut.get_position();
+        assert(last_in_key < other_mut.get_sort_key());
+        last_in_key = other_mut.get_sort_key();
 #endif
         if (in1_iter != in1_end &&
-                in1_iter->get_position() == other_mut.get_position()) {
+                in1_iter->get_sort_key() == other_mut.get_sort_key()) {
             out.back() += *in1_iter;
             in1_iter++;
         }
@@ -77,8 +80,8 @@ static void merge_allele_count(const type1 &in1, const type2 &in2,
     while (in1_iter != in1_end) {
         out.emplace_back(*in1_iter);
 #ifdef MERGE_ALLELE_CHECK_ORDER
-        assert(last_in_pos < in1_iter->get_position());
-        last_in_pos = in1_iter->get_position();
+        assert(last_in_key < in1_iter->get_sort_key());
+        last_in_key = in1_iter->get_sort_key();
 #endif
         in1_iter++;
     }
@@ -139,7 +142,7 @@ bool get_major_allele_polytomy(MAT::Node *node,
     bool changed = false;
     std::vector<int> backward_mut;
     for (const auto &allele : allele_count) {
-        while (iter != end && iter->get_position() < allele.get_position()) {
+        while (iter != end && iter->get_sort_key() < allele.get_sort_key()) {
             //original mutation shared by all children
             rewind_ori_mut_ploytomy(new_major_alleles_out, iter, changed);
             iter++;
@@ -148,7 +151,7 @@ bool get_major_allele_polytomy(MAT::Node *node,
         set_state_from_cnt(allele.count, boundary1_major_allele);
         nuc_one_hot major_alleles = boundary1_major_allele & 0xf;
         //Have a matching original mutation, set par_nuc from it
-        if (iter != end && iter->get_position() == allele.get_position()) {
+        if (iter != end && iter->get_sort_key() == allele.get_sort_key()) {
             MAT::Mutation altered = *iter;
             if (major_alleles != iter->get_all_major_allele()) {
                 changed = true;
@@ -51,7 +51,7 @@ static void set_major_allele_state_binary(
     MAT::Mutation &to_set, mut_iter &iter, const mut_iter &end,
     State_Change_Collection &changed_states,
     MAT::Mutations_Collection &major_alleles_out, bool &changed) {
-    while (iter != end && iter->get_position() < to_set.get_position()) {
+    while (iter != end && iter->get_sort_key() < to_set.get_sort_key()) {
         //original allele not present in both children
         place_ori_mutation(iter, major_alleles_out, changed);
         iter++;
@@ -60,7 +60,7 @@ static void set_major_allele_state_binary(
     nuc_one_hot par_nuc = to_set.get_par_one_hot();
     nuc_one_hot old_state = par_nuc;
     nuc_one_hot major_allele = to_set.get_all_major_allele();
-    if (iter != end && iter->get_position() == to_set.get_position()) {
+    if (iter != end && iter->get_sort_key() == to_set.get_sort_key()) {
         //there were mutations at this loci, so the original mutation have the correct par_nuc
         par_nuc = iter->get_par_one_hot();
         old_state = iter->get_mut_one_hot();
@@ -102,7 +102,7 @@ bool get_major_allele_binary(const MAT::Node *node,
     bool changed = false;
     //iterating on right child mutation
     for (const auto &right_mut : node->children[1]->mutations) {
-        while (iter != end && iter->get_position() < right_mut.get_position()) {
+        while (iter != end && iter->get_sort_key() < right_mut.get_sort_key()) {
             //only present in left child, right is par_nuc
             MAT::Mutation mut = *iter;
             get_new_mut_binary(mut, iter->get_all_major_allele(),
@@ -112,7 +112,7 @@ bool get_major_allele_binary(const MAT::Node *node,
             iter++;
         }
         MAT::Mutation mut = right_mut;
-        if (iter != end && iter->get_position() == right_mut.get_position()) {
+        if (iter != end && iter->get_sort_key() == right_mut.get_sort_key()) {
             //left right children match
             get_new_mut_binary(mut, iter->get_all_major_allele(),
                                right_mut.get_all_major_allele());
@@ -12,7 +12,7 @@ struct ConfirmedMove;
 struct Mutation_Pos_Only_Comparator {
     bool operator()(const Mutation_Annotated_Tree::Mutation &first,
                     const Mutation_Annotated_Tree::Mutation &second) const {
-        return (first.get_position() == second.get_position());
+        return (first.get_sort_key() == second.get_sort_key());
     }
 };
 struct Mutation_Pos_Only_Hash {
@@ -16,11 +16,11 @@ static void intersect_allele(const Mutation_Annotated_Tree::Mutations_Collection
     auto in1_iter=in1.begin();
     auto in1_end=in1.end();
     for(const auto& mut:in2) {
-        while (in1_iter!=in1_end&&in1_iter->get_position()<mut.get_position()) {
+        while (in1_iter!=in1_end&&in1_iter->get_sort_key()<mut.get_sort_key()) {
             in1_iter++;
             //skip all muts present in only one of the inout
         }
-        if (in1_iter!=in1_end&&in1_iter->get_position()==mut.get_position()) {
+        if (in1_iter!=in1_end&&in1_iter->get_sort_key()==mut.get_sort_key()) {
             //output common major allele
             nuc_one_hot common=in1_iter->get_all_major_allele()&mut.get_all_major_allele();
             if (common!=mut.get_par_one_hot()) {
@@ -124,6 +124,7 @@ void Mutation_Annotated_Tree::Tree::condense_leaves(std::vector<std::string> mis
     find_condensable_nodes(root, condensable_nodes);
     tbb::concurrent_vector<std::vector<size_t>> condensed_ids;
     tbb::parallel_for(tbb::blocked_range<size_t>(0,condensable_nodes.size()),Node_Condenser{condensable_nodes,condensed_ids});
+    invalidate_traversal_orders();
     //assert(condensed_nodes_count.load()==condensed_nodes.size());
     size_t condensed_nodes_count(0);
     for(const auto& condensed:condensed_ids) {
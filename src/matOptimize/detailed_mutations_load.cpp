@@ -53,11 +53,11 @@ struct output_mutation {
     output_mutation(MAT::Mutations_Collection &mut_out) : mut_out(mut_out) {}
     void operator()(MAT::Mutations_Collection::const_iterator &par_iter,
                     const MAT::Mutation &last_mut) {
-        while (par_iter->position < last_mut.position) {
+        while (par_iter->get_sort_key() < last_mut.get_sort_key()) {
             mut_out.push_back(*par_iter);
             par_iter++;
         }
-        if (par_iter->position == last_mut.position) {
+        if (par_iter->get_sort_key() == last_mut.get_sort_key()) {
             par_iter++;
         }
         mut_out.push_back(last_mut);
@@ -69,7 +69,7 @@ struct output_mutation {
         mut_out.reserve(in);
     }
     void exhaust(MAT::Mutations_Collection::const_iterator &par_iter) {
-        while (par_iter->position < INT_MAX) {
+        while (par_iter->get_sort_key() < UINT64_MAX) {
             mut_out.push_back(*par_iter);
             par_iter++;
         }
@@ -90,11 +90,13 @@ void fill_ignored_mutations(
     outputer_type next_level_muts) {
     for (int position = ignored_iter->first; position <= ignored_iter->second;
             position++) {
-        while (par_iter->position < position) {
+        //ignored ranges only cover the first chromosome
+        auto key = MAT::mutation_sort_key(0, position);
+        while (par_iter->get_sort_key() < key) {
             next_level_muts.push_back(*par_iter);
             par_iter++;
         }
-        if (par_iter->position == position) {
+        if (par_iter->get_sort_key() == key) {
             node->mutations.mutations.emplace_back(
                 0, position, par_iter->get_mut_one_hot(),
                 par_iter->get_mut_one_hot(), MAT::Mutation::ignored());
@@ -127,12 +129,12 @@ static void load_mutations(MAT::Node *node, Mutation_Detailed::node &to_load,
     MAT::ignored_t::const_iterator ignored_iter = node->ignore.begin();
     for (size_t mut_idx = 0; mut_idx < valid_mut_size; mut_idx++) {
         auto mut = get_mutation(to_load, mut_idx);
-        while (ignored_iter->first < mut.position) {
-            assert(ignored_iter->second < mut.position);
+        while (MAT::mutation_sort_key(0, ignored_iter->first) < mut.get_sort_key()) {
+            assert(MAT::mutation_sort_key(0, ignored_iter->second) < mut.get_sort_key());
             fill_ignored_mutations(node, par_iter, ignored_iter, mut_out);
             ignored_iter++;
         }
-        assert(ignored_iter->first > mut.position);
+        assert(MAT::mutation_sort_key(0, ignored_iter->first) > mut.get_sort_key());
         node->mutations.push_back(mut);
         mut_out(par_iter, node->mutations.back());
     }
@@ -128,7 +128,8 @@ struct gzip_input_source {
 
         isal_inflate_init(state);
         state->next_in=map_start;
-        state->avail_in=mapped_size;
+        state->avail_in=0;
+        refill();
         state->crc_flag=IGZIP_GZIP;
         isal_gzip_header_init(&gz_hdr);
         auto ret = isal_read_gzip_header(state, &gz_hdr);
@@ -139,16 +140,31 @@ struct gzip_input_source {
     void unalloc() {
         munmap(map_start, mapped_size);
     }
+    //avail_in of isa-l is 32 bit, so feed the mapping at most UINT32_MAX bytes at a time
+    void refill() const {
+        if (!state->avail_in) {
+            size_t left=map_start+mapped_size-state->next_in;
+            state->avail_in=std::min(left,(size_t)UINT32_MAX);
+        }
+    }
+    //inflate the current member until output is full or the member ends, across parts of the mapping
+    int inflate_member() const {
+        auto out=isal_inflate(state);
+        refill();
+        while (out==ISAL_DECOMP_OK&&state->avail_out>0&&state->avail_in>0&&state->block_state!=ISAL_BLOCK_FINISH) {
+            out=isal_inflate(state);
+            refill();
+        }
+        return out;
+    }
     bool decompress_to_buffer(unsigned char* buffer, size_t buffer_size) const {
+        refill();
         if (!state->avail_in) {
             return false;
         }
         state->next_out=buffer;
         state->avail_out=buffer_size;
-        auto out=ISAL_DECOMP_OK;
-        //while (out==ISAL_DECOMP_OK&&state->avail_out>0&&state->avail_in>0&&state->block_state!=ISAL_BLOCK_FINISH) {
-        out=isal_inflate(state);
-        //}
+        auto out=inflate_member();
         if (out!=ISAL_DECOMP_OK) {
             fprintf(stderr, "decompress error %d\n",out);
         }
@@ -158,9 +174,7 @@ struct gzip_input_source {
             if (state->avail_in > 1 && state->next_in[1] != 139)
                 break;
             isal_inflate_reset(state);
-            //while (out==ISAL_DECOMP_OK&&state->avail_out>0&&state->avail_in>0&&state->block_state!=ISAL_BLOCK_FINISH) {
-            out=isal_inflate(state);
-            //}
+            out=inflate_member();
             if (out!=ISAL_DECOMP_OK) {
                 fprintf(stderr, "restart error %d\n",out);
             }
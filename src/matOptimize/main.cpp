@@ -4,6 +4,8 @@
 #include "version.hpp"
 #include "src/matOptimize/mutation_annotated_tree.hpp"
 #include "tree_rearrangement_internal.hpp"
+#include "move_journal.hpp"
+#include "search_scheduler.hpp"
 #include <algorithm>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
@@ -48,6 +50,7 @@ int this_rank;
 uint32_t num_threads;
 MAT::Node* get_LCA(MAT::Node* src,MAT::Node* dst);
 FILE* movalbe_src_log;
+Move_Journal move_journal;
 bool changing_radius=false;
 void interrupt_handler(int) {
     fputs("interrupted\n", stderr);
@@ -121,6 +124,7 @@ int main(int argc, char **argv) {
     float min_improvement;
     bool no_write_intermediate;
     std::string diff_file_path;
+    std::string yield_log_path;
 
     po::options_description desc{"Options"};
     uint32_t num_cores = tbb::task_scheduler_init::default_num_threads();
@@ -152,6 +156,8 @@ int main(int argc, char **argv) {
     ("node_sel,y",po::value(&rand_sel_seed),"Random seed for selecting nodes to search")
     ("drift_nwk_file,b",po::value(&intermediate_nwk_out)->default_value(""),"Newick filename stem for drifting")
     ("no_reduce_back_mutations,c","skip FS that reduce back mutations in the end")
+    ("adaptive_schedule,A","Search nodes that found profitable moves in previous rounds first, and search nodes that did not with smaller radius or skip them")
+    ("yield_log,Y",po::value(&yield_log_path)->default_value(""),"File to log the parsimony score change per second of search in each round")
     ("help,h", "Print help messages");
     auto search_end_time=std::chrono::steady_clock::time_point::max();
     po::options_description all_options;
@@ -274,6 +280,7 @@ int main(int argc, char **argv) {
             tbb::task_scheduler_init init(process_count*num_threads);
             if (input_complete_pb_path!="") {
                 t.load_detatiled_mutations(input_complete_pb_path);
+                Move_Journal::replay(input_complete_pb_path, t);
             } else {
                 if (input_vcf_path != "") {
                     fputs("Loading input tree\n",stderr);
@@ -332,6 +339,7 @@ int main(int argc, char **argv) {
                 make_output_path(intermediate_writing);
                 t.save_detailed_mutations(intermediate_writing);
                 rename(intermediate_writing.c_str(), intermediate_pb_base_name.c_str());
+                move_journal.start(intermediate_pb_base_name, t);
                 fputs("Finished checkpointing initial tree.\n",stderr);
             }
         }
@@ -348,20 +356,30 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Height:%zu\n", t.get_max_level());
 
         std::vector<MAT::Node *> nodes_to_search;
-        std::vector<MAT::Node *> bfs_ordered_nodes;
-        bfs_ordered_nodes = t.breadth_first_expansion();
         movalbe_src_log=fopen(profitable_src_log.c_str(),"w");
         if (!movalbe_src_log) {
             perror(("Error writing to log file "+profitable_src_log).c_str());
             movalbe_src_log=fopen("/dev/null", "w");
         }
         fprintf(movalbe_src_log, "source\tdestination\titeration\tscore.change\tdistance\tsubtree.size\n");
+        FILE* yield_log=nullptr;
+        if (yield_log_path!="") {
+            yield_log=fopen(yield_log_path.c_str(),"w");
+            if (!yield_log) {
+                perror(("Error writing to log file "+yield_log_path).c_str());
+            }
+        }
+        std::unique_ptr<Search_Scheduler> scheduler;
+        if (vm.count("adaptive_schedule")||yield_log) {
+            scheduler.reset(new Search_Scheduler(vm.count("adaptive_schedule"),yield_log));
+            search_scheduler=scheduler.get();
+        }
         bool isfirst=true;
         bool allow_drift=false;
         int iteration=1;
         tbb::task_scheduler_init init(num_threads);
         while(stalled<drift_iterations) {
-            bfs_ordered_nodes = t.breadth_first_expansion();
+            const auto& bfs_ordered_nodes = t.get_bfs_order();
             fputs("Start Finding nodes to move \n",stderr);
             bool search_all_nodes=false;
             bool search_all_dir=false;
@@ -420,7 +438,7 @@ int main(int argc, char **argv) {
         MPI_Request req;
         MPI_Ibcast(&temp, 1, MPI_INT, 0, MPI_COMM_WORLD,&req);
         if (reduce_back_mutations) {
-            fprintf(stderr, "Parsimony score before %zu\n",t.get_parsimony_score());
+            fprintf(stderr, "Parsimony score before %zu\n",t.get_running_parsimony_score());
             fprintf(stderr, "Back mutation count before %d\n",count_back_mutation(t));
             std::vector<mutated_t> output(MAT::Mutation::refs.size());
             get_pos_samples_old_tree(t, output);
@@ -433,6 +451,10 @@ int main(int argc, char **argv) {
         }
         fprintf(stderr, "Final Parsimony score %zu\n",t.get_parsimony_score());
         fclose(movalbe_src_log);
+        search_scheduler=nullptr;
+        if (yield_log) {
+            fclose(yield_log);
+        }
         save_final_tree(t, output_path);
         MPI_Wait(&req, MPI_STATUS_IGNORE);
     } else {
@@ -0,0 +1,225 @@
+#pragma once
+#include "tree_rearrangement_internal.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+/*
+Journal of moves applied after the last intermediate protobuf was written, so that
+checkpointing a round only costs appending its moves instead of rewriting the whole tree.
+File structure (all fields are 8 byte):
+magic, node_idx and parsimony score of the tree in the protobuf this journal follows
+repeated records, each starting with a tag:
+    JOURNAL_CLEAR_CHANGED: no payload, changed flags of all nodes are cleared
+    JOURNAL_MOVES: number of moves, then node id of source and destination of each move,
+        in the order they are passed to apply_moves
+    JOURNAL_ROUND_END: parsimony score after the round
+A round is only replayed if its JOURNAL_ROUND_END record is complete, as clean_tree and
+populate_ignored_range are done at the end of each round.
+*/
+#define JOURNAL_MAGIC 0x314c4e524a54414dULL
+#define JOURNAL_CLEAR_CHANGED 1
+#define JOURNAL_MOVES 2
+#define JOURNAL_ROUND_END 3
+//rewrite the full protobuf when the journal have more moves than this fraction of nodes,
+//to bound the time spent replaying it
+#define JOURNAL_MOVES_PER_SNAPSHOT_FRACTION 8
+MAT::Node* get_LCA(MAT::Node* src,MAT::Node* dst);
+class Move_Journal {
+    int fd;
+    size_t moves_since_snapshot;
+    std::vector<uint64_t> buffer;
+    void flush(bool sync) {
+        if (fd==-1) {
+            return;
+        }
+        size_t to_write=buffer.size()*sizeof(uint64_t);
+        auto content=(const char*)buffer.data();
+        while (to_write) {
+            auto written=write(fd, content, to_write);
+            if (written<0) {
+                if (errno==EINTR) {
+                    continue;
+                }
+                perror("Failed to write move journal, stop journaling");
+                close();
+                break;
+            }
+            content+=written;
+            to_write-=written;
+        }
+        buffer.clear();
+        if (sync&&fd!=-1&&fdatasync(fd)) {
+            perror("Failed to sync move journal");
+        }
+    }
+  public:
+    Move_Journal():fd(-1),moves_since_snapshot(0) {}
+    ~Move_Journal() {
+        close();
+    }
+    static std::string path_for(const std::string& pb_path) {
+        return pb_path+".moves";
+    }
+    bool is_open() const {
+        return fd!=-1;
+    }
+    void close() {
+        if (fd!=-1) {
+            ::close(fd);
+            fd=-1;
+        }
+    }
+    //whether the journal have grown large enough that a full protobuf should be written
+    bool need_snapshot(const MAT::Tree& t) const {
+        return fd==-1||moves_since_snapshot*JOURNAL_MOVES_PER_SNAPSHOT_FRACTION>=t.get_size_upper();
+    }
+    //start a new journal following the protobuf just written to pb_path from t
+    void start(const std::string& pb_path,MAT::Tree& t) {
+        close();
+        auto path=path_for(pb_path);
+        fd=open(path.c_str(),O_WRONLY|O_CREAT|O_TRUNC,S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+        if (fd==-1) {
+            perror(("Cannot create move journal "+path).c_str());
+            return;
+        }
+        moves_since_snapshot=0;
+        buffer= {JOURNAL_MAGIC,t.get_next_node_id(),t.get_parsimony_score()};
+        flush(true);
+    }
+    void log_clear_changed() {
+        if (fd==-1) {
+            return;
+        }
+        buffer.push_back(JOURNAL_CLEAR_CHANGED);
+        flush(false);
+    }
+    void log_moves(const std::vector<Profitable_Moves_ptr_t>& moves) {
+        if (fd==-1||moves.empty()) {
+            return;
+        }
+        buffer.reserve(2+2*moves.size());
+        buffer.push_back(JOURNAL_MOVES);
+        buffer.push_back(moves.size());
+        for (const auto move : moves) {
+            buffer.push_back(move->src->node_id);
+            buffer.push_back(move->dst->node_id);
+        }
+        moves_since_snapshot+=moves.size();
+        flush(false);
+    }
+    void log_round_end(size_t parsimony_score) {
+        if (fd==-1) {
+            return;
+        }
+        buffer.push_back(JOURNAL_ROUND_END);
+        buffer.push_back(parsimony_score);
+        flush(true);
+    }
+    /**
+     * @brief Reapply rounds recorded in the journal of the protobuf t is loaded from
+     * @param pb_path path of the protobuf t is loaded from
+     * @return number of moves replayed
+     */
+    static size_t replay(const std::string& pb_path,MAT::Tree& t) {
+        auto path=path_for(pb_path);
+        FILE* fh=fopen(path.c_str(),"rb");
+        if (!fh) {
+            return 0;
+        }
+        std::vector<uint64_t> content;
+        uint64_t temp[4096];
+        size_t read_count;
+        while ((read_count=fread(temp, sizeof(uint64_t), 4096, fh))) {
+            content.insert(content.end(),temp,temp+read_count);
+        }
+        fclose(fh);
+        if (content.size()<3||content[0]!=JOURNAL_MAGIC) {
+            fprintf(stderr, "Ignoring malformed move journal %s\n",path.c_str());
+            return 0;
+        }
+        //A journal left behind from before the protobuf was rewritten
+        if (content[1]!=t.get_next_node_id()||content[2]!=t.get_parsimony_score()) {
+            fprintf(stderr, "Move journal %s does not follow %s, ignoring it\n",path.c_str(),pb_path.c_str());
+            return 0;
+        }
+        //find the end of the last complete round
+        size_t replay_end=3;
+        size_t idx=3;
+        while (idx<content.size()) {
+            auto tag=content[idx];
+            if (tag==JOURNAL_CLEAR_CHANGED) {
+                idx++;
+            } else if (tag==JOURNAL_MOVES&&idx+1<content.size()) {
+                idx+=2+2*content[idx+1];
+            } else if (tag==JOURNAL_ROUND_END&&idx+1<content.size()) {
+                idx+=2;
+                replay_end=idx;
+            } else {
+                break;
+            }
+        }
+        size_t replayed=0;
+        size_t rounds=0;
+#ifdef CHECK_STATE_REASSIGN
+        Original_State_t origin_states;
+#endif
+        idx=3;
+        while (idx<replay_end) {
+            auto tag=content[idx];
+            if (tag==JOURNAL_CLEAR_CHANGED) {
+                for (auto node : t.depth_first_expansion()) {
+                    node->clear_changed();
+                }
+                idx++;
+            } else if (tag==JOURNAL_MOVES) {
+                size_t move_count=content[idx+1];
+                idx+=2;
+                //apply_moves need dfs index to group moves
+                t.depth_first_expansion();
+                std::vector<Profitable_Moves> moves;
+                moves.reserve(move_count);
+                for (size_t move_idx=0; move_idx<move_count; move_idx++) {
+                    auto src=t.get_node(content[idx]);
+                    auto dst=t.get_node(content[idx+1]);
+                    idx+=2;
+                    if (!src||!dst) {
+                        fprintf(stderr, "Move journal %s refers to node not in the tree, cannot continue\n",path.c_str());
+                        exit(EXIT_FAILURE);
+                    }
+                    moves.push_back(Profitable_Moves{0,src,dst,get_LCA(src, dst),0});
+                }
+                std::vector<Profitable_Moves_ptr_t> all_moves;
+                all_moves.reserve(moves.size());
+                for (auto& move : moves) {
+                    all_moves.push_back(&move);
+                }
+                apply_moves(all_moves, t
+#ifdef CHECK_STATE_REASSIGN
+                            ,origin_states
+#endif
+                           );
+                replayed+=move_count;
+            } else {
+                clean_tree(t);
+                t.populate_ignored_range();
+                auto score=t.get_running_parsimony_score();
+                if (score!=content[idx+1]) {
+                    fprintf(stderr, "Parsimony score %zu after replaying round %zu of move journal %s, expected %zu\n",
+                            score,rounds,path.c_str(),(size_t)content[idx+1]);
+                    exit(EXIT_FAILURE);
+                }
+                rounds++;
+                idx+=2;
+            }
+        }
+        fprintf(stderr, "Replayed %zu moves in %zu rounds from move journal %s\n",replayed,rounds,path.c_str());
+        return replayed;
+    }
+};
+extern Move_Journal move_journal;
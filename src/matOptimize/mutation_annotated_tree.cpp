@@ -46,6 +46,8 @@ std::vector<Mutation_Annotated_Tree::Node*> Mutation_Annotated_Tree::Tree::bread
     } else {
         node=get_node(nid);
     }
+    //bfs index of nodes in the subtree are now relative to its root
+    bfs_order_valid=false;
     size_t idx=0;
     std::queue<Node*> remaining_nodes;
     remaining_nodes.push(node);
@@ -58,7 +60,10 @@ std::vector<Mutation_Annotated_Tree::Node*> Mutation_Annotated_Tree::Tree::bread
             remaining_nodes.push(c);
         }
     }
-
+    if (node==root) {
+        bfs_order=traversal;
+        bfs_order_valid=true;
+    }
     return traversal;
 }
 
@@ -88,19 +93,56 @@ std::vector<Mutation_Annotated_Tree::Node*> Mutation_Annotated_Tree::Tree::depth
         return traversal;
     }
     depth_first_expansion_helper(node, traversal,index,0);
+    if (node==root) {
+        dfs_order=traversal;
+        dfs_order_valid=true;
+    } else {
+        dfs_order_valid=false;
+    }
     return traversal;
 }
 
+const std::vector<Mutation_Annotated_Tree::Node*>& Mutation_Annotated_Tree::Tree::get_dfs_order() {
+    if (!dfs_order_valid) {
+        depth_first_expansion();
+    }
+    return dfs_order;
+}
+
+const std::vector<Mutation_Annotated_Tree::Node*>& Mutation_Annotated_Tree::Tree::get_bfs_order() {
+    if (!bfs_order_valid) {
+        breadth_first_expansion();
+    }
+    return bfs_order;
+}
+
 size_t Mutation_Annotated_Tree::Tree::get_parsimony_score() {
     size_t score = 0;
     auto dfs = depth_first_expansion();
     for (auto n: dfs) {
-        for (const auto& mut:n->mutations) {
-            score+=mut.is_valid();
-        }
+        score+=n->mutations.count_valid_mutations();
     }
+    running_parsimony_score = score;
     return score;
 }
+size_t Mutation_Annotated_Tree::Tree::get_running_parsimony_score() const {
+#ifndef NDEBUG
+    //not using depth_first_expansion, as it renumbers nodes whose dfs index may still be in use
+    size_t full_score = 0;
+    std::vector<const Node*> stack({root});
+    while (!stack.empty()) {
+        auto node=stack.back();
+        stack.pop_back();
+        full_score+=node->mutations.count_valid_mutations();
+        stack.insert(stack.end(),node->children.begin(),node->children.end());
+    }
+    if (full_score!=running_parsimony_score) {
+        fprintf(stderr, "Running parsimony score %zu, full count %zu\n",running_parsimony_score,full_score);
+        raise(SIGTRAP);
+    }
+#endif
+    return running_parsimony_score;
+}
 static size_t level_helper(const Node* node) {
     size_t level = 0;
     for (auto child : node->children) {
@@ -154,6 +196,7 @@ void Mutation_Annotated_Tree::Tree::delete_nodes() {
     }
     root->delete_this();
     root=nullptr;
+    invalidate_traversal_orders();
 }
 static void get_leaves_helper(const Node* root, std::vector<Node*>& out) {
     for(auto child:root->children) {
@@ -383,6 +426,7 @@ Mutation_Annotated_Tree::get_subtree(const Mutation_Annotated_Tree::Tree &tree,
 }
 void Mutation_Annotated_Tree::Tree::rotate_for_display(bool reverse) {
     auto dfs = depth_first_expansion();
+    invalidate_traversal_orders();
 
     std::unordered_map<Node *, int> num_desc;
 
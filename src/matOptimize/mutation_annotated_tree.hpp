@@ -2,6 +2,7 @@
 #define MUTATION_ANNOTATED_TREE
 #include <algorithm>
 #include <atomic>
+#include <climits>
 #include <csignal>
 #include <cstddef>
 #include <cstdint>
@@ -98,7 +99,15 @@ int8_t get_nt (int8_t nuc_id);
 std::vector<int8_t> get_nuc_vec (char nuc);
 std::vector<int8_t> get_nuc_vec_from_id (int8_t nuc_id);
 
-// WARNING: chrom is currently ignored!
+//Mutations are ordered by chromosome index then position, packed into one integer so
+//comparing them costs the same as comparing positions when there is only one chromosome.
+//Position INT_MAX marks the end of mutation vectors, so it is ordered after all chromosomes
+inline uint64_t mutation_sort_key(uint8_t chrom_idx,int position) {
+    if (position==INT_MAX) {
+        return UINT64_MAX;
+    }
+    return ((uint64_t)chrom_idx<<32)|(uint32_t)(position^INT_MIN);
+}
 // position < 0 implies masked mutations i.e. mutations that exist but
 // details are unknown
 class Mutation;
@@ -155,13 +164,16 @@ class Mutation {
         return chrom_idx;
     }
 
-    //order defined only by position, not chromidx yet
+    uint64_t get_sort_key() const {
+        return mutation_sort_key(chrom_idx, position);
+    }
+
     inline bool operator< (const Mutation& m) const {
-        return ((*this).position < m.position);
+        return get_sort_key() < m.get_sort_key();
     }
 
     inline bool operator<= (const Mutation& m) const {
-        return ((*this).position <= m.position);
+        return get_sort_key() <= m.get_sort_key();
     }
     /*
             inline Mutation copy() const {
@@ -224,8 +236,7 @@ class Mutation {
         if (other.boundary1_all_major_allele!=boundary1_all_major_allele) {
             return false;
         }
-        //assert(other.chrom_idx==chrom_idx);
-        return true;
+        return other.chrom_idx==chrom_idx;
     }
     inline bool is_masked() const {
         return (position < 0);
@@ -306,19 +317,20 @@ class Mutations_Collection {
             raise(SIGTRAP);
         }
         if (!mutations.empty()) {
-            if (m.get_position()<=mutations.back().get_position()) {
+            if (m.get_sort_key()<=mutations.back().get_sort_key()) {
                 fprintf(stderr, "Adding out of order %d to %d \n",m.get_position(),mutations.back().get_position());
                 raise(SIGTRAP);
             }
         }
         mutations.push_back(m);
     }
-    //Find next mutation with position greater or equal to pos
-    iterator find_next(int pos);
+    //Find next mutation with sort key greater or equal to key
+    iterator find_next(uint64_t key);
 
-    iterator find(int position) {
-        auto iter=find_next(position);
-        if(iter!=mutations.end()&&iter->get_position()>position) {
+    iterator find(uint8_t chrom_idx,int position) {
+        auto key=mutation_sort_key(chrom_idx, position);
+        auto iter=find_next(key);
+        if(iter!=mutations.end()&&iter->get_sort_key()>key) {
             return mutations.end();
         }
         return iter;
@@ -337,10 +349,10 @@ class Mutations_Collection {
     }
     int count_valid_mutations()const;
     iterator find(const Mutation& mut) {
-        return find(mut.get_position());
+        return find(mut.get_chromIdx(),mut.get_position());
     }
-    bool remove(int pos) {
-        auto iter=find(pos);
+    bool remove(const Mutation& mut) {
+        auto iter=find(mut);
         if(iter==mutations.end()) {
             return false;
         }
@@ -373,8 +385,8 @@ class Mutations_Collection {
                         Mutations_Collection &common) const;
     bool insert(const Mutation &mut, char keep_self = -1) {
         //assert(mut.get_par_one_hot()!=mut.get_mut_one_hot());
-        auto iter=find_next(mut.get_position());
-        if(iter!=mutations.end()&&iter->get_position()==mut.get_position()) {
+        auto iter=find_next(mut.get_sort_key());
+        if(iter!=mutations.end()&&iter->get_sort_key()==mut.get_sort_key()) {
             assert(keep_self!=NO_DUPLICATE);
             if(keep_self==KEEP_OTHER) {
                 *iter=mut;
@@ -503,6 +515,13 @@ class Tree {
     std::unordered_map<size_t,  std::string> node_names;
     std::unordered_map<std::string, size_t> node_name_to_idx_map;
     size_t node_idx;
+    //parsimony score as of the last full count, plus changes reported by apply_moves and clean_tree
+    size_t running_parsimony_score;
+    //traversal orders of the whole tree from the last traversal, valid until nodes are added, removed or rearranged
+    mutable std::vector<Node*> dfs_order;
+    mutable std::vector<Node*> bfs_order;
+    mutable bool dfs_order_valid;
+    bool bfs_order_valid;
   public:
     typedef  tbb::concurrent_unordered_map<size_t, std::vector<std::string>> condensed_node_t;
     size_t root_ident;
@@ -510,9 +529,13 @@ class Tree {
         root_ident=1;
         root = NULL;
         node_idx=0;
+        running_parsimony_score=0;
+        dfs_order_valid=false;
+        bfs_order_valid=false;
         all_nodes.clear();
     }
     void register_node_serial(Node* node) {
+        invalidate_traversal_orders();
         all_nodes.resize(std::max(all_nodes.size(),node->node_id+1),nullptr);
         all_nodes[node->node_id]=node;
     }
@@ -532,6 +555,10 @@ class Tree {
     size_t get_size_upper() const {
         return all_nodes.size();
     }
+    //id the next node created will get
+    size_t get_next_node_id() const {
+        return node_idx;
+    }
     Node* get_node(size_t idx)const {
         if (idx>=all_nodes.size()) {
             /*if (warn) {
@@ -548,6 +575,7 @@ class Tree {
         return all_nodes[idx];
     }
     void erase_node(size_t node_idx) {
+        invalidate_traversal_orders();
         all_nodes[node_idx]=nullptr;
         auto iter=node_names.find(node_idx);
         if (iter!=node_names.end()) {
@@ -565,6 +593,9 @@ class Tree {
 
     void rename_node(size_t old_nid, std::string new_nid);
     Node* create_node ();
+    //reserve count consecutive node ids, so that create_node_with_id can be called from multiple threads
+    size_t reserve_node_ids(size_t count);
+    Node* create_node_with_id (size_t node_id);
     std::string get_node_name(size_t node_idx) const {
         auto node_name_iter=node_names.find(node_idx);
         if (node_name_iter==node_names.end()) {
@@ -602,8 +633,24 @@ class Tree {
     int get_node_id_c_str (const char* identifier) const;
     std::vector<Node*> breadth_first_expansion(std::string nid="");
     std::vector<Node*> depth_first_expansion(Node* node=NULL) const;
-
+    //Same order and indices as depth_first_expansion()/breadth_first_expansion() of the whole tree,
+    //but only traverse the tree again if it changed since the last traversal
+    const std::vector<Node*>& get_dfs_order();
+    const std::vector<Node*>& get_bfs_order();
+    //Nodes are registered and erased serially, so that marks the cached orders stale, code that rearrange
+    //existing nodes without creating or erasing any (or create them concurrently) need to call this
+    void invalidate_traversal_orders() {
+        dfs_order_valid=false;
+        bfs_order_valid=false;
+    }
+
+    //count valid mutations of all nodes, and reset the running parsimony score to it
     size_t get_parsimony_score();
+    //parsimony score kept up to date with moves applied since the last get_parsimony_score, without traversing the tree
+    size_t get_running_parsimony_score() const;
+    void adjust_parsimony_score(int change) {
+        running_parsimony_score+=change;
+    }
 
     size_t get_num_annotations() const {
         size_t ret = 0;
@@ -660,5 +707,5 @@ void save_mutation_annotated_tree (const Tree& tree, std::string filename);
 void get_sample_mutation_paths (Mutation_Annotated_Tree::Tree* T, std::vector<Node*> samples, std::string mutation_paths_filename);
 }
 bool check_grand_parent(const Mutation_Annotated_Tree::Node* node,const Mutation_Annotated_Tree::Node* grand_parent);
-nuc_one_hot get_parent_state(Mutation_Annotated_Tree::Node* ancestor,int position);
+nuc_one_hot get_parent_state(Mutation_Annotated_Tree::Node* ancestor,uint8_t chrom_idx,int position);
 #endif
@@ -1,4 +1,5 @@
 #include "mutation_annotated_tree.hpp"
+#include "src/newick_topology.hpp"
 #include <boost/iostreams/filtering_stream.hpp>
 #include <fstream>
 #include <csignal>
@@ -19,6 +20,7 @@
 #include <sys/mman.h>
 #include <string>
 #include <unordered_map>
+#include <algorithm>
 std::vector<int8_t> Mutation_Annotated_Tree::get_nuc_vec_from_id (int8_t nuc_id) {
     return get_nuc_vec(get_nuc(nuc_id));
 }
@@ -151,92 +153,40 @@ void Mutation_Annotated_Tree::string_split (std::string s, std::vector<std::stri
 }
 
 void Mutation_Annotated_Tree::Tree::load_from_newick(const std::string& newick_string,bool use_internal_node_label) {
-    std::vector<std::string> leaves;
-    std::vector<size_t> num_open;
-    std::vector<size_t> num_close;
-    std::vector<std::queue<float>> branch_len (128);  // will be resized later if needed
-    size_t level = 0;
-    node_idx=0;
-
-    std::vector<std::string> s1;
-    string_split(newick_string, ',', s1);
-
-    num_open.reserve(s1.size());
-    num_close.reserve(s1.size());
-
-    for (auto s: s1) {
-        size_t no = 0;
-        size_t nc = 0;
-        bool stop = false;
-        bool branch_start = false;
-        std::string leaf = "";
-        std::string branch = "";
-        for (auto c: s) {
-            if (c == ':') {
-                stop = true;
-                branch = "";
-                branch_start = true;
-            } else if (c == '(') {
-                no++;
-                level++;
-                if (branch_len.size() <= level) {
-                    branch_len.resize(level*2);
-                }
-            } else if (c == ')') {
-                stop = true;
-                nc++;
-                float len = (branch.size() > 0) ? std::stod(branch) : -1.0;
-                branch_len[level].push(len);
-                level--;
-                branch_start = false;
-            } else if (!stop) {
-                leaf += c;
-                branch_start = false;
-            } else if (branch_start) {
-                if (isdigit(c)  || c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+') {
-                    branch += c;
-                }
-            }
+    Newick_Topology topo;
+    parse_newick_topology(newick_string, topo);
+
+    // Nodes are allocated in parallel with node ids in preorder, then linked
+    // in preorder so that children keep their order in the newick string
+    size_t num_nodes = topo.parent.size();
+    all_nodes.clear();
+    all_nodes.resize(num_nodes, nullptr);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_nodes),
+    [&](tbb::blocked_range<size_t> r) {
+        for (size_t k=r.begin(); k<r.end(); ++k) {
+            Node* n = new Node(k);
+            n->branch_length = topo.branch_len[k];
+            n->children.reserve(topo.num_children[k]);
+            all_nodes[k] = n;
         }
-        leaves.push_back(std::move(leaf));
-        num_open.push_back(no);
-        num_close.push_back(nc);
-        float len = (branch.size() > 0) ? std::stod(branch) : -1.0;
-        branch_len[level].push(len);
-    }
-
-    if (level != 0) {
-        fprintf(stderr, "ERROR: incorrect Newick format!\n");
-        exit(1);
+    });
+    node_idx = num_nodes;
+    curr_internal_node = 0;
+    root = (num_nodes > 0) ? all_nodes[0] : NULL;
+    for (size_t k=1; k<num_nodes; k++) {
+        all_nodes[topo.parent[k]]->add_child(all_nodes[k]);
     }
 
-    curr_internal_node = 0;
-    std::stack<Node*> parent_stack;
-
-    for (size_t i=0; i<leaves.size(); i++) {
-        auto leaf = leaves[i];
-        auto no = num_open[i];
-        auto nc = num_close[i];
-        for (size_t j=0; j<no; j++) {
-            Node* new_node = create_node();
-            new_node->branch_length= branch_len[level].front();
-            if (parent_stack.size() == 0) {
-                //root
-                root=new_node;
-            } else {
-                parent_stack.top()->add_child(new_node);
-            }
-            branch_len[level].pop();
-            level++;
-            parent_stack.push(new_node);
-        }
-        auto new_node=create_node(leaf);
-        new_node->branch_length= branch_len[level].front();
-        parent_stack.top()->add_child(new_node);
-        branch_len[level].pop();
-        for (size_t j=0; j<nc; j++) {
-            parent_stack.pop();
-            level--;
+    size_t num_leaves = num_nodes - std::count_if(topo.internal_id.begin(), topo.internal_id.end(), [](size_t id) {
+        return id > 0;
+    });
+    node_names.reserve(num_leaves);
+    node_name_to_idx_map.reserve(num_leaves);
+    for (size_t k=0; k<num_nodes; k++) {
+        if (topo.internal_id[k] == 0) {
+            std::string name(newick_string, topo.name_begin[k], topo.name_end[k]-topo.name_begin[k]);
+            node_names.emplace(k, name);
+            node_name_to_idx_map.emplace(std::move(name), k);
         }
     }
 
@@ -57,6 +57,25 @@ Mutation_Annotated_Tree::Node* Mutation_Annotated_Tree::Tree::create_node () {
     return n;
 }
 
+size_t Mutation_Annotated_Tree::Tree::reserve_node_ids(size_t count) {
+    //reserved nodes are created concurrently, so cannot mark traversal orders stale themselves
+    if (count) {
+        invalidate_traversal_orders();
+    }
+    auto first_node_id=node_idx;
+    node_idx+=count;
+    all_nodes.resize(std::max(all_nodes.size(),node_idx),nullptr);
+    return first_node_id;
+}
+
+Mutation_Annotated_Tree::Node* Mutation_Annotated_Tree::Tree::create_node_with_id (size_t node_id) {
+    Node* n = new Node(node_id);
+    size_t num_annotations = get_num_annotations();
+    n->clade_annotations.resize(num_annotations,"");
+    all_nodes[node_id]=n;
+    return n;
+}
+
 Node* Mutation_Annotated_Tree::Tree::get_node_c_str (const char* identifier) const {
     return get_node(std::string(identifier));
 }
@@ -85,15 +104,15 @@ void Mutation_Annotated_Tree::Tree::rename_node(size_t old_nid, std::string new_
         node_name_to_idx_map.emplace(new_nid,old_nid);
     }
 }
-nuc_one_hot get_parent_state(Node* ancestor,int position) {
-    auto iter = ancestor->mutations.find(position);
+nuc_one_hot get_parent_state(Node* ancestor,uint8_t chrom_idx,int position) {
+    auto iter = ancestor->mutations.find(chrom_idx,position);
     if (iter == ancestor->mutations.end()) {
         ancestor = ancestor->parent;
     } else {
         return iter->get_par_one_hot();
     }
     while (ancestor) {
-        auto iter = ancestor->mutations.find(position);
+        auto iter = ancestor->mutations.find(chrom_idx,position);
         if (iter == ancestor->mutations.end()) {
             ancestor = ancestor->parent;
         } else {
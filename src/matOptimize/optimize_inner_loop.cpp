@@ -1,4 +1,6 @@
 #include "tree_rearrangement_internal.hpp"
+#include "move_journal.hpp"
+#include "search_scheduler.hpp"
 #include <mpi.h>
 #include <cstdlib>
 #include <unistd.h>
@@ -23,9 +25,9 @@ size_t optimize_inner_loop(std::vector<MAT::Node*>& nodes_to_search,MAT::Tree& t
     static std::chrono::steady_clock::time_point last_save_time=std::chrono::steady_clock::now();
     auto save_period=std::chrono::minutes(minutes_between_save);
     bool isfirst_this_iter=true;
-    size_t new_score;
+    size_t new_score=SIZE_MAX;
      while (!nodes_to_search.empty()) {
-                auto dfs_ordered_nodes=t.depth_first_expansion();
+                t.get_dfs_order();
                 std::mt19937_64 rng;
                 std::shuffle(nodes_to_search.begin(), nodes_to_search.end(),rng);
                 bool distribute=(process_count>1)&&(nodes_to_search.size()>1000);
@@ -48,10 +50,16 @@ size_t optimize_inner_loop(std::vector<MAT::Node*>& nodes_to_search,MAT::Tree& t
                 adjust_all(t);
                 use_bound=true;
                 std::vector<size_t> nodes_to_search_idx;
-                nodes_to_search_idx.reserve(nodes_to_search.size());
-                for(const auto node:nodes_to_search) {
-                    nodes_to_search_idx.push_back(node->dfs_index);
+                if (search_scheduler) {
+                    search_scheduler->prepare(t);
+                    search_scheduler->schedule(nodes_to_search, nodes_to_search_idx, std::abs(radius), !allow_drift);
+                } else {
+                    nodes_to_search_idx.reserve(nodes_to_search.size());
+                    for(const auto node:nodes_to_search) {
+                        nodes_to_search_idx.push_back(node->dfs_index);
+                    }
                 }
+                size_t score_before_round=t.get_running_parsimony_score();
                 std::vector<size_t> defered_nodes;
                 auto next_save_time=minutes_between_save?last_save_time+save_period:std::chrono::steady_clock::time_point::max();
                 bool do_continue=true;
@@ -60,6 +68,10 @@ size_t optimize_inner_loop(std::vector<MAT::Node*>& nodes_to_search,MAT::Tree& t
                     search_stop_time=search_end_time;
                 }
                 optimize_tree_main_thread(nodes_to_search_idx, t,std::abs(radius),movalbe_src_log,allow_drift,log_moves?iteration:-1,defered_nodes,distribute,search_stop_time,do_continue,search_all_dir,isfirst_this_iter
+#ifdef CHECK_STATE_REASSIGN
+                                          ,origin_states
+#endif
+                                          ,&move_journal
                                          );
                 isfirst_this_iter=false;
                 fprintf(stderr, "Defered %zu nodes\n",defered_nodes.size());
@@ -70,7 +82,11 @@ size_t optimize_inner_loop(std::vector<MAT::Node*>& nodes_to_search,MAT::Tree& t
                         nodes_to_search.push_back(t.get_node(idx));
                     }
                 }
-                auto curr_score=t.get_parsimony_score();
+                auto curr_score=t.get_running_parsimony_score();
+                if (search_scheduler) {
+                    search_scheduler->finish_round(defered_nodes, std::abs(radius), iteration, score_before_round, curr_score,
+                                                   std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now()-start_time).count());
+                }
                 if(curr_score>=new_score) {
                     nodes_to_search.clear();
                 }
@@ -78,13 +94,20 @@ size_t optimize_inner_loop(std::vector<MAT::Node*>& nodes_to_search,MAT::Tree& t
                 fprintf(stderr, "parsimony score after optimizing: %zu,with radius %d, second from start %ld \n\n",
                         new_score,std::abs(radius),std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now()-start_time).count());
                 if(!no_write_intermediate) {
-                    auto intermediate_writing=intermediate_template;
-                    make_output_path(intermediate_writing);
                     auto save_start=std::chrono::steady_clock::now();
-                    t.save_detailed_mutations(intermediate_writing);
-                    rename(intermediate_writing.c_str(), intermediate_pb_base_name.c_str());
+                    //moves of this round are already in the journal, only rewrite the whole tree once in a while
+                    move_journal.log_round_end(new_score);
+                    if (move_journal.need_snapshot(t)) {
+                        auto intermediate_writing=intermediate_template;
+                        make_output_path(intermediate_writing);
+                        t.save_detailed_mutations(intermediate_writing);
+                        rename(intermediate_writing.c_str(), intermediate_pb_base_name.c_str());
+                        move_journal.start(intermediate_pb_base_name, t);
+                        fprintf(stderr, "Took %ldsecond to save intermediate protobuf\n",std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now()-save_start).count());
+                    } else {
+                        fprintf(stderr, "Took %ldsecond to append to move journal\n",std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now()-save_start).count());
+                    }
                     last_save_time=std::chrono::steady_clock::now();
-                    fprintf(stderr, "Took %ldsecond to save intermediate protobuf\n",std::chrono::duration_cast<std::chrono::seconds>(last_save_time-save_start).count());
                 }
                 if(allow_drift) {
                     MAT::save_mutation_annotated_tree(t, intermediate_nwk_out+std::to_string(iteration)+".pb.gz");
@@ -1,6 +1,8 @@
 #include "src/matOptimize/mutation_annotated_tree.hpp"
 #include "tree_rearrangement_internal.hpp"
 #include "priority_conflict_resolver.hpp"
+#include "move_journal.hpp"
+#include "search_scheduler.hpp"
 #include <algorithm>
 #include <atomic>
 #include <chrono>
@@ -35,6 +37,7 @@ thread_local allocator_state<Mutation_Count_Change> FIFO_allocator_state;
 extern tbb::task_group_context search_context;
 size_t nodes_per_min_per_thread=100;
 float target_fetch_period=0.5;
+Search_Scheduler* search_scheduler=nullptr;
 MAT::Node* get_LCA(MAT::Node* src,MAT::Node* dst) {
     while (src!=dst) {
         //as dfs index of parent node will always smaller than its children's , so
@@ -65,11 +68,11 @@ void log_move_detail(const std::vector<Profitable_Moves_ptr_t> & moves, FILE* ou
     }
 }
 
-typedef tbb::flow::function_node<std::vector<Profitable_Moves_ptr_t>*,tbb::flow::continue_msg,tbb::flow::queueing> resolver_node_t;
+typedef tbb::flow::function_node<std::vector<Profitable_Moves>*,tbb::flow::continue_msg,tbb::flow::queueing> resolver_node_t;
 static void MPI_recieve_move(const std::vector<MAT::Node*>& dfs_ordered_nodes,resolver_node_t& resover_node ) {
     int* buffer=new int[MAX_MOVE_MSG_SIZE];
     while (true) {
-        std::vector<Profitable_Moves_ptr_t>* out =new std::vector<Profitable_Moves_ptr_t>;
+        std::vector<Profitable_Moves>* out =new std::vector<Profitable_Moves>;
         MPI_Status stat;
         MPI_Recv(buffer,MAX_MOVE_MSG_SIZE, MPI_INT, MPI_ANY_SOURCE, MOVE_TAG, MPI_COMM_WORLD, &stat);
         int msg_size;
@@ -89,7 +92,10 @@ static void MPI_recieve_move(const std::vector<MAT::Node*>& dfs_ordered_nodes,re
             int score_change=buffer[3+4*move_idx];
             int radius_left=buffer[4+4*move_idx];
             //fprintf(stderr, "Recevieved move with src %d, dst %d,LCA %d,score_change %d, radius %d \n",buffer[0],dst_idx,LCA_idx,score_change,radius_left);
-            out->push_back(Profitable_Moves_ptr_t(new Profitable_Moves{score_change,src,dfs_ordered_nodes[dst_idx],dfs_ordered_nodes[LCA_idx],radius_left}));
+            out->push_back(Profitable_Moves{score_change,src,dfs_ordered_nodes[dst_idx],dfs_ordered_nodes[LCA_idx],radius_left});
+        }
+        if (search_scheduler) {
+            search_scheduler->record_moves(src, *out);
         }
         resover_node.try_put(out);
     }
@@ -106,12 +112,12 @@ struct MPI_move_sender {
     MPI_move_sender(const MPI_move_sender&) {
         init();
     }
-    void operator()(std::vector<Profitable_Moves_ptr_t>* to_send) {
+    void operator()(std::vector<Profitable_Moves>* to_send) {
         size_t moves_to_send=std::min(to_send->size(),MAX_MOVE_SIZE);
         size_t msg_size=1+4*moves_to_send;
-        buffer[0]=(*to_send)[0]->src->dfs_index;
+        buffer[0]=(*to_send)[0].src->dfs_index;
         for (size_t move_idx=0; move_idx<moves_to_send; move_idx++) {
-            const auto& this_move=(*(*to_send)[move_idx]);
+            const auto& this_move=(*to_send)[move_idx];
             buffer[1+4*move_idx]=this_move.LCA->dfs_index;
             buffer[2+4*move_idx]=this_move.dst->dfs_index;
             buffer[3+4*move_idx]=this_move.score_change;
@@ -126,24 +132,37 @@ struct MPI_move_sender {
         delete[] buffer;
     }
 };
-typedef tbb::flow::multifunction_node<std::vector<size_t>*, tbb::flow::tuple<std::vector<Profitable_Moves_ptr_t>*>,tbb::flow::rejecting> searcher_node_t;
+typedef tbb::flow::multifunction_node<std::vector<size_t>*, tbb::flow::tuple<std::vector<Profitable_Moves>*>,tbb::flow::rejecting> searcher_node_t;
 struct move_searcher {
     const std::vector<MAT::Node*>& dfs_ordered_nodes;
     int radius;
     bool do_drift;
     Reachable reachable;
+    //stop searching nodes already fetched at this time, and leave them in preempted
+    std::chrono::steady_clock::time_point stop_time;
+    tbb::concurrent_vector<size_t>* preempted;
     void operator()(std::vector<size_t>* to_search,searcher_node_t::output_ports_type& output)const {
-        int r=radius;
         auto start_time=std::chrono::steady_clock::now();
-        for (auto idx:*to_search) {
-            auto node_to_search=dfs_ordered_nodes[idx];
+        size_t searched=0;
+        for (; searched<to_search->size(); searched++) {
+            if (preempted&&std::chrono::steady_clock::now()>=stop_time) {
+                preempted->grow_by(to_search->begin()+searched,to_search->end());
+                break;
+            }
+            auto idx=(*to_search)[searched];
+            auto node_to_search=dfs_ordered_nodes[idx&SEARCH_IDX_MASK];
+            int r=radius>>(idx>>RADIUS_SHIFT_OFFSET);
             output_t out;
-            out.moves=new std::vector<Profitable_Moves_ptr_t>;
+            out.moves=new std::vector<Profitable_Moves>;
+            auto node_start_time=std::chrono::steady_clock::now();
             find_moves_bounded(node_to_search, out,r,do_drift,reachable
 #ifdef CHECK_BOUND
                                ,count
 #endif
                               );
+            if (search_scheduler) {
+                search_scheduler->record_search(node_to_search, *out.moves, std::chrono::steady_clock::now()-node_start_time);
+            }
             if (!out.moves->empty()) {
                 //resolve conflicts
                 std::get<0>(output).try_put(out.moves);
@@ -155,7 +174,7 @@ struct move_searcher {
             //}
         }
         float seconds_duration=std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now()-start_time).count();
-        float currate=to_search->size()/((seconds_duration+1.0)/60.0);
+        float currate=searched/((seconds_duration+1.0)/60.0);
         nodes_per_min_per_thread=nodes_per_min_per_thread*(1-update_rate)+update_rate*currate;
         //fprintf(stderr, "Cur rate %f, %zu\n",currate,nodes_per_min_per_thread);
         delete to_search;
@@ -241,9 +260,10 @@ struct fetcher {
         }
         auto nodes_to_release_this_round=std::min(nodes_to_push.size(),release_rate);
         //fprintf(stderr, "buf size %zu, releasing %lu nodes \n",nodes_to_push.size(),nodes_to_release_this_round);
-        auto split_iter=nodes_to_push.end()-nodes_to_release_this_round;
-        out=new std::vector<size_t>(split_iter,nodes_to_push.end());
-        nodes_to_push.erase(split_iter,nodes_to_push.end());
+        //release from the front, so nodes are searched in the order the distributor scheduled them
+        auto split_iter=nodes_to_push.begin()+nodes_to_release_this_round;
+        out=new std::vector<size_t>(nodes_to_push.begin(),split_iter);
+        nodes_to_push.erase(nodes_to_push.begin(),split_iter);
         //fprintf(stderr, "left %zu nodes at %d \n",nodes_to_push.size(),this_rank);
         return true;
     }
@@ -256,15 +276,17 @@ Reachable set_reachable(int radius,MAT::Tree& t,bool search_all_dir) {
     reachable.reachable_change=true;
     return reachable;
 }
-void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
+int optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
                                MAT::Tree &t,int radius,FILE* log,bool allow_drift,int iteration,
                                std::vector<size_t>& defered_node_identifier,bool MPI_involved,std::chrono::steady_clock::time_point end_time,bool do_continue,bool search_all_dir,bool isfirst_this_iter
 #ifdef CHECK_STATE_REASSIGN
                                , Original_State_t& origin_states
 #endif
+                               , Move_Journal* journal
                               ) {
-    t.breadth_first_expansion();
-    auto dfs_ordered_nodes=t.depth_first_expansion();
+    t.get_bfs_order();
+    //not used after applying moves, which renumber nodes
+    const auto& dfs_ordered_nodes=t.get_dfs_order();
     auto start_time=std::chrono::steady_clock::now();
     fprintf(stderr, "%zu nodes to search \n", nodes_to_search.size());
     fprintf(stderr, "Node size: %zu\n", dfs_ordered_nodes.size());
@@ -274,14 +296,17 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
     //for resolving conflicting moves
     Deferred_Move_t deferred_moves;
     Cross_t potential_crosses(dfs_ordered_nodes.size(),nullptr);
+    Accepted_Moves_t accepted_moves;
     tbb::flow::graph g;
     resolver_node_t resover_node(g, 1,
                                  Conflict_Resolver(potential_crosses,
+                                         accepted_moves,
                                          deferred_moves,
                                          &defered_node_identifier));
     std::thread move_reciever(MPI_recieve_move,std::ref(dfs_ordered_nodes),std::ref(resover_node));
     //progress bar
-    searcher_node_t searcher(g,num_threads+1,move_searcher{dfs_ordered_nodes,radius,allow_drift,set_reachable(radius, t,search_all_dir)});
+    tbb::concurrent_vector<size_t> preempted_idx;
+    searcher_node_t searcher(g,num_threads+1,move_searcher{dfs_ordered_nodes,radius,allow_drift,set_reachable(radius, t,search_all_dir),end_time,&preempted_idx});
     tbb::flow::make_edge(std::get<0>(searcher.output_ports()),resover_node);
     std::vector<size_t> local_nodes_to_search;
     auto last_request_time=std::chrono::steady_clock::now();
@@ -299,9 +324,12 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
     //fprintf(stderr, "Waiting for distributor thread\n");
     distributor_thread.join();
     if(do_continue) {
-        defered_node_identifier.reserve(defered_node_identifier.size()+incomplete_idx.size());
+        defered_node_identifier.reserve(defered_node_identifier.size()+incomplete_idx.size()+preempted_idx.size());
         for(auto idx:incomplete_idx) {
-            defered_node_identifier.push_back(dfs_ordered_nodes[idx]->node_id);
+            defered_node_identifier.push_back(dfs_ordered_nodes[idx&SEARCH_IDX_MASK]->node_id);
+        }
+        for(auto idx:preempted_idx) {
+            defered_node_identifier.push_back(dfs_ordered_nodes[idx&SEARCH_IDX_MASK]->node_id);
         }
     }
     double search_min=std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start_time).count();
@@ -314,6 +342,9 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
         for (auto node : dfs_ordered_nodes) {
             node->clear_changed();
         }
+        if (journal) {
+            journal->log_clear_changed();
+        }
     }
     auto apply_start=std::chrono::steady_clock::now();
     fputs("Start applying moves\n",stderr);
@@ -323,11 +354,14 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
     if (iteration>0) {
         log_move_detail(all_moves, log, iteration, radius,t);
     }
-    apply_moves(all_moves, t
+    if (journal) {
+        journal->log_moves(all_moves);
+    }
+    int score_change=apply_moves(all_moves, t
 #ifdef CHECK_STATE_REASSIGN
-                ,origin_states
+                                 ,origin_states
 #endif
-               );
+                                );
     auto apply_end=std::chrono::steady_clock::now();
     auto elpased_time =std::chrono::duration_cast<std::chrono::seconds>(apply_end-apply_start);
     fprintf(stderr, "apply moves took %ld seconds\n",elpased_time.count());
@@ -340,18 +374,18 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
             fprintf(stderr, "\r %zu nodes left",deferred_moves.size());
             Deferred_Move_t deferred_moves_next;
             potential_crosses.clear();
-            auto bfs_ordered_nodes=t.breadth_first_expansion();
-            potential_crosses.resize(bfs_ordered_nodes.size(),nullptr);
+            potential_crosses.resize(t.get_bfs_order().size(),nullptr);
+            Accepted_Moves_t recycled_moves;
             tbb::flow::graph resolver_g;
             std::vector<MAT::Node*> ignored;
-            resolver_node_t resover_node(resolver_g,1,Conflict_Resolver(potential_crosses,deferred_moves_next,nullptr));
+            resolver_node_t resover_node(resolver_g,1,Conflict_Resolver(potential_crosses,recycled_moves,deferred_moves_next,nullptr));
             tbb::parallel_for(tbb::blocked_range<size_t>(0,deferred_moves.size()),[&deferred_moves,&resover_node,&t,allow_drift](const tbb::blocked_range<size_t>& r) {
                 for (size_t i=r.begin(); i<r.end(); i++) {
                     MAT::Node* src=t.get_node(deferred_moves[i].first);
                     MAT::Node* dst=t.get_node(deferred_moves[i].second);
                     if (src&&dst) {
                         output_t out;
-                        out.moves=new std::vector<Profitable_Moves_ptr_t>;
+                        out.moves=new std::vector<Profitable_Moves>;
                         if (check_not_ancestor(dst, src)) {
                             individual_move(src,dst,get_LCA(src, dst),out,allow_drift
 #ifdef DEBUG_PARSIMONY_SCORE_CHANGE_CORRECT
@@ -375,11 +409,14 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
                 log_move_detail(all_moves, log, iteration, radius,t);
             }
             recycled+=all_moves.size();
-            apply_moves(all_moves, t
+            if (journal) {
+                journal->log_moves(all_moves);
+            }
+            score_change+=apply_moves(all_moves, t
 #ifdef CHECK_STATE_REASSIGN
-                        ,origin_states
+                                      ,origin_states
 #endif
-                       );
+                                     );
             deferred_moves=std::move(deferred_moves_next);
         }
 
@@ -391,19 +428,20 @@ void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
     //check_samples(t.root, origin_states, &t);
 #endif
     if(!do_continue) {
-        return;
+        return score_change;
     }
-    clean_tree(t);
+    score_change+=clean_tree(t);
     fprintf(stderr, "First stage %zu deferred node \n",defered_node_identifier.size());
     fprintf(stderr, "recycled %f of conflicting moves \n",(double)recycled/(double)init_deferred);
     fprintf(stderr, "recycling moves took %ld seconds\n",elpased_time.count());
     t.populate_ignored_range();
+    return score_change;
 }
 void optimize_tree_worker_thread(MAT::Tree &t,int radius,bool do_drift,bool search_all_dir) {
     auto dfs_ordered_nodes=t.depth_first_expansion();
     tbb::flow::graph g;
     resolver_node_t resolver_node(g,1,MPI_move_sender());
-    searcher_node_t searcher(g,num_threads+1,move_searcher{dfs_ordered_nodes,radius,do_drift,set_reachable(radius, t,search_all_dir)});
+    searcher_node_t searcher(g,num_threads+1,move_searcher{dfs_ordered_nodes,radius,do_drift,set_reachable(radius, t,search_all_dir),std::chrono::steady_clock::time_point::max(),nullptr});
     tbb::flow::make_edge(std::get<0>(searcher.output_ports()),resolver_node);
     std::vector<size_t> nodes_to_search;
     auto last_request_time=std::chrono::steady_clock::now();
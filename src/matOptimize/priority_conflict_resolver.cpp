@@ -10,16 +10,16 @@
 #include <utility>
 #include <vector>
 
-bool Conflict_Resolver::check_single_move_no_conflict(Profitable_Moves_ptr_t& candidate_move)const {
+bool Conflict_Resolver::check_single_move_no_conflict(const Profitable_Moves& candidate_move)const {
     int best_score=0;
     //gather the minimium parsimony score of all the moves intersecting with this move
-    candidate_move->apply_nodes([&best_score,this](MAT::Node* node) {
+    candidate_move.apply_nodes([&best_score,this](MAT::Node* node) {
         if (potential_crosses[node->bfs_index]) {
             best_score=std::min(best_score,potential_crosses[node->bfs_index]->score_change);
         }
     });
     //only insert if its score change is the most negative among all conflicting moves
-    if (candidate_move->score_change<best_score) {
+    if (candidate_move.score_change<best_score) {
         return true;
     }
     return false;
@@ -27,7 +27,7 @@ bool Conflict_Resolver::check_single_move_no_conflict(Profitable_Moves_ptr_t& ca
 //Remove other ove from the set of move to apply, by clearing it from all nodes on its path
 // also reset the minimum parsimony score change of all moves whose path include these nodes to 0
 //, except for the "exclude" node, as it have been set for the new move.
-static void remove_move(Cross_t &potential_crosses, const std::shared_ptr<Profitable_Moves>& other_move,
+static void remove_move(Cross_t &potential_crosses, const Profitable_Moves_ptr_t other_move,
                         MAT::Node *exclude) {
 
     other_move->apply_nodes([&](MAT::Node *other_nodes_in_path) {
@@ -41,7 +41,7 @@ static void remove_move(Cross_t &potential_crosses, const std::shared_ptr<Profit
 }
 // Reggister "candidate_move" to apply
 bool Conflict_Resolver::register_single_move_no_conflict (
-    Profitable_Moves_ptr_t& candidate_move) const {
+    Profitable_Moves_ptr_t candidate_move) const {
     candidate_move->apply_nodes([&](MAT::Node* node) {
         //for each node on the path
         auto& this_node_move = potential_crosses[node->bfs_index];
@@ -55,28 +55,28 @@ bool Conflict_Resolver::register_single_move_no_conflict (
     return true;
 }
 
-char Conflict_Resolver::operator()(std::vector<Profitable_Moves_ptr_t>* candidate_move_ptr) const {
-    std::vector<Profitable_Moves_ptr_t>& candidate_move=*candidate_move_ptr;
+char Conflict_Resolver::operator()(std::vector<Profitable_Moves>* candidate_move_ptr) const {
+    std::vector<Profitable_Moves>& candidate_move=*candidate_move_ptr;
     char ret=0;
     Profitable_Moves_ptr_t selected_move=nullptr;
     if (defered_nodes) {
-        defered_nodes->push_back(candidate_move[0]->src->node_id);
+        defered_nodes->push_back(candidate_move[0].src->node_id);
     }
-    for (Profitable_Moves_ptr_t& move : candidate_move) {
-        move->populate_involved_nodes();
+    for (const Profitable_Moves& move : candidate_move) {
         //don't need check-lock-check-set, as there is little contension on conflict resolver
         if (check_single_move_no_conflict(move)) {
             //fprintf(stderr, "registered move\n");
-            register_single_move_no_conflict(move);
+            accepted_moves.push_back(move);
+            selected_move = &accepted_moves.back();
+            register_single_move_no_conflict(selected_move);
             ret =1;
-            selected_move = move;
             break;
         }
     }
 
     if(!selected_move&&(!candidate_move.empty())) {
-        for (Profitable_Moves_ptr_t move : candidate_move) {
-            deferred_moves.emplace_back(move->src->node_id,move->dst->node_id);
+        for (const Profitable_Moves& move : candidate_move) {
+            deferred_moves.emplace_back(move.src->node_id,move.dst->node_id);
         }
     }
     delete candidate_move_ptr;
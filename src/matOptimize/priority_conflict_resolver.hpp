@@ -7,23 +7,27 @@
 #include <cstdio>
 #include "tbb/concurrent_vector.h"
 #include <cstddef>
+#include <deque>
 #include <string>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 //For recording which moves that have path crossing this node is pending to be applied, and its parsimony score improvement
 typedef std::vector<Profitable_Moves_ptr_t> Cross_t;
+//Storage of moves that have been accepted, only appended to by the (serial) resolver, so pointers to them stay valid until it is destroyed after applying moves
+typedef std::deque<Profitable_Moves> Accepted_Moves_t;
 typedef std::vector<std::pair<std::size_t,std::size_t>> Deferred_Move_t;
 struct Conflict_Resolver {
     Cross_t& potential_crosses;
+    Accepted_Moves_t& accepted_moves;
     //int& nodes_inside;
     Deferred_Move_t & deferred_moves;
     std::vector<size_t>* defered_nodes;
-    Conflict_Resolver(Cross_t& potential_crosses,Deferred_Move_t& deferred_moves,std::vector<size_t>* defered_nodes):potential_crosses(potential_crosses),deferred_moves(deferred_moves),defered_nodes(defered_nodes) {}
-    bool check_single_move_no_conflict(Profitable_Moves_ptr_t& candidate_move)const;
-    bool register_single_move_no_conflict(Profitable_Moves_ptr_t& candidate_move) const;
+    Conflict_Resolver(Cross_t& potential_crosses,Accepted_Moves_t& accepted_moves,Deferred_Move_t& deferred_moves,std::vector<size_t>* defered_nodes):potential_crosses(potential_crosses),accepted_moves(accepted_moves),deferred_moves(deferred_moves),defered_nodes(defered_nodes) {}
+    bool check_single_move_no_conflict(const Profitable_Moves& candidate_move)const;
+    bool register_single_move_no_conflict(Profitable_Moves_ptr_t candidate_move) const;
     //enqueuing a move
-    char operator()(std::vector<Profitable_Moves_ptr_t>* candidate_move) const;
+    char operator()(std::vector<Profitable_Moves>* candidate_move) const;
     //output non-conflicting moves
 };
 void schedule_moves(Cross_t& potential_crosses,std::vector<Profitable_Moves_ptr_t>& out);
@@ -71,7 +71,7 @@ void clean_up_internal_nodes(MAT::Node* this_node,MAT::Tree& tree,std::unordered
     }
 }
 //For removing nodes with no valid mutations between rounds
-void clean_tree(MAT::Tree& t) {
+int clean_tree(MAT::Tree& t) {
     std::unordered_set<size_t> changed_nodes;
     std::unordered_set<size_t> node_with_inconsistent_states;
     clean_up_internal_nodes(t.root, t, changed_nodes,node_with_inconsistent_states);
@@ -88,32 +88,36 @@ void clean_tree(MAT::Tree& t) {
     }
     auto cleaned_count=for_reassign.size();
     fprintf(stderr, "%zu nodes cleaned\n",cleaned_count);
-    t.depth_first_expansion();
+    t.get_dfs_order();
+    //removed nodes have no valid mutations, so only state reassignment can change parsimony score
+    int score_change=0;
     if(!for_reassign.empty()) {
         std::vector<Altered_Node_t> nodes_with_changed_states_out;
-        reassign_backward_pass(for_reassign, nodes_with_changed_states_out
+        score_change+=reassign_backward_pass(for_reassign, nodes_with_changed_states_out
 #ifdef CHECK_STATE_REASSIGN
-                               ,new_tree
+                                             ,new_tree
 #endif
-                              );
+                                            );
         for(const auto& node_id:node_with_inconsistent_states) {
-            clean_up_src_states(t.get_node(node_id), nodes_with_changed_states_out);
+            score_change+=clean_up_src_states(t.get_node(node_id), nodes_with_changed_states_out);
         }
         if (!nodes_with_changed_states_out.empty()) {
-            forward_pass(nodes_with_changed_states_out
+            score_change+=forward_pass(nodes_with_changed_states_out
 #ifdef CHECK_STATE_REASSIGN
-                         ,
-                         new_tree
+                                       ,
+                                       new_tree
 #endif
-                        );
+                                      );
         }
     }
+    t.adjust_parsimony_score(score_change);
 #ifdef CHECK_STATE_REASSIGN
     compare_mutation_tree(t, new_tree);
 #endif
     if (cleaned_count) {
-        clean_tree(t);
+        score_change+=clean_tree(t);
     }
+    return score_change;
 }
 
 //Use Full fitch sankoff to reassign state from scratch
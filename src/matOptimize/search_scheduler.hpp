@@ -0,0 +1,166 @@
+#pragma once
+#include "tree_rearrangement_internal.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+//Node indices sent to searchers carry how many times the radius is halved for that node in their top byte
+#define SEARCH_IDX_MASK 0x00ffffffffffffffULL
+#define RADIUS_SHIFT_OFFSET 56
+//number of consecutive searches without profitable move before a node is no longer searched at the same radius
+#define COLD_STREAK 2
+//Outcome of past searches from a node, indexed by node_id
+struct Node_Search_Stats {
+    float search_seconds;
+    int score_gain;
+    uint32_t profitable_searches;
+    //full radius of the first unprofitable search in the current streak
+    int cold_radius;
+    uint8_t empty_streak;
+    uint8_t found_this_round;
+    uint8_t not_reached;
+};
+/*
+Keep statistics of searches from each node across rounds, to search nodes that yielded
+moves first, search nodes that did not yield moves with a smaller radius, and skip them every
+other round after COLD_STREAK consecutive unprofitable searches, until the radius increases.
+Statistics are only collected on the main process, searches done on other processes only
+report the moves they found, and not their time.
+*/
+class Search_Scheduler {
+    std::vector<Node_Search_Stats> stats;
+    //node id and radius shift of nodes scheduled this round
+    std::vector<std::pair<size_t,uint8_t>> searched_ids;
+    std::atomic<uint64_t> search_microseconds;
+    std::atomic<size_t> profitable_this_round;
+    size_t reduced_radius_count;
+    size_t skipped_count;
+    bool adaptive;
+    FILE* yield_log;
+  public:
+    Search_Scheduler(bool adaptive,FILE* yield_log):search_microseconds(0),profitable_this_round(0),reduced_radius_count(0),skipped_count(0),adaptive(adaptive),yield_log(yield_log) {
+        if (yield_log) {
+            fputs("iteration\tradius\tnodes.searched\treduced.radius\tskipped\tsearch.seconds\tscore.change\tscore.change.per.second\tprofitable.nodes\telapsed.seconds\n",yield_log);
+        }
+    }
+    bool is_adaptive() const {
+        return adaptive;
+    }
+    //radius the node is searched with is radius>>shift, -1 to not search it
+    int radius_shift(const MAT::Node* node,int radius) const {
+        if (node->node_id>=stats.size()) {
+            return 0;
+        }
+        const auto& this_stat=stats[node->node_id];
+        //radius too small to be reduced further
+        if (this_stat.empty_streak==0||this_stat.cold_radius<radius||(radius>>this_stat.empty_streak)<1) {
+            return 0;
+        }
+        if (this_stat.empty_streak>=COLD_STREAK) {
+            return -1;
+        }
+        return this_stat.empty_streak;
+    }
+    /**
+     * @brief Drop cold nodes, and put nodes that yielded moves last time first, in the order of improvement per second
+     * @param[in,out] nodes_to_search nodes that will be searched this round
+     * @param[out] nodes_to_search_idx dfs index of nodes to search, with radius shift encoded
+     */
+    void schedule(std::vector<MAT::Node*>& nodes_to_search,std::vector<size_t>& nodes_to_search_idx,int radius,bool reduce_search) {
+        reduced_radius_count=0;
+        skipped_count=0;
+        if (adaptive&&reduce_search) {
+            auto end=std::stable_partition(nodes_to_search.begin(),nodes_to_search.end(),[this](const MAT::Node* node) {
+                return node->node_id<stats.size()&&stats[node->node_id].empty_streak==0&&stats[node->node_id].profitable_searches;
+            });
+            std::stable_sort(nodes_to_search.begin(),end,[this](const MAT::Node* first,const MAT::Node* second) {
+                const auto& first_stat=stats[first->node_id];
+                const auto& second_stat=stats[second->node_id];
+                return first_stat.score_gain/(first_stat.search_seconds+1e-3f)>second_stat.score_gain/(second_stat.search_seconds+1e-3f);
+            });
+        }
+        nodes_to_search_idx.clear();
+        nodes_to_search_idx.reserve(nodes_to_search.size());
+        searched_ids.clear();
+        searched_ids.reserve(nodes_to_search.size());
+        for (const auto node : nodes_to_search) {
+            size_t shift=0;
+            if (adaptive&&reduce_search) {
+                auto this_shift=radius_shift(node, radius);
+                if (this_shift<0) {
+                    //search it with reduced radius next round
+                    stats[node->node_id].empty_streak=COLD_STREAK-1;
+                    skipped_count++;
+                    continue;
+                }
+                if (this_shift) {
+                    reduced_radius_count++;
+                }
+                shift=this_shift;
+            }
+            searched_ids.emplace_back(node->node_id,shift);
+            nodes_to_search_idx.push_back(node->dfs_index|(shift<<RADIUS_SHIFT_OFFSET));
+        }
+    }
+    //called before searching a round, node ids created by the last round of moves are within t.get_size_upper()
+    void prepare(const MAT::Tree& t) {
+        stats.resize(t.get_size_upper(),Node_Search_Stats{0,0,0,0,0,0,0});
+        search_microseconds=0;
+        profitable_this_round=0;
+    }
+    //called by searchers on the main process, nodes are searched by one thread, so no need for locking
+    void record_search(const MAT::Node* node,const std::vector<Profitable_Moves>& moves,std::chrono::steady_clock::duration duration) {
+        stats[node->node_id].search_seconds+=std::chrono::duration<float>(duration).count();
+        search_microseconds+=std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        record_moves(node,moves);
+    }
+    //moves found from a node, by searchers on any process
+    void record_moves(const MAT::Node* node,const std::vector<Profitable_Moves>& moves) {
+        if (moves.empty()) {
+            return;
+        }
+        auto& this_stat=stats[node->node_id];
+        this_stat.found_this_round=true;
+        this_stat.score_gain-=moves[0].score_change;
+        profitable_this_round++;
+    }
+    /**
+     * @brief Update the unprofitable streak of nodes searched this round, and log the yield of this round
+     * @param deferred_nodes node ids of nodes not searched or with moves conflicting with others
+     */
+    void finish_round(const std::vector<size_t>& deferred_nodes,int radius,int iteration,size_t score_before,size_t score_after,double elapsed_seconds) {
+        //deferred nodes without moves are those not reached before time out
+        for (auto node_id : deferred_nodes) {
+            if (node_id<stats.size()) {
+                stats[node_id].not_reached=true;
+            }
+        }
+        for (const auto& searched : searched_ids) {
+            auto& this_stat=stats[searched.first];
+            if (this_stat.found_this_round) {
+                this_stat.profitable_searches++;
+                this_stat.empty_streak=0;
+            } else if (!this_stat.not_reached) {
+                if (searched.second==0) {
+                    this_stat.cold_radius=radius;
+                    this_stat.empty_streak=1;
+                } else {
+                    this_stat.empty_streak++;
+                }
+            }
+            this_stat.found_this_round=0;
+            this_stat.not_reached=0;
+        }
+        if (yield_log) {
+            double seconds=search_microseconds/1e6;
+            long score_change=(long)score_after-(long)score_before;
+            fprintf(yield_log, "%d\t%d\t%zu\t%zu\t%zu\t%f\t%ld\t%f\t%zu\t%f\n",iteration,radius,searched_ids.size(),reduced_radius_count,skipped_count,
+                    seconds,score_change,seconds>0?score_change/seconds:0,profitable_this_round.load(),elapsed_seconds);
+            fflush(yield_log);
+        }
+    }
+};
+extern Search_Scheduler* search_scheduler;
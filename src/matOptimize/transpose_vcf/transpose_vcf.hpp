@@ -1,3 +1,4 @@
+#pragma once
 #include <cstdint>
 #include <tbb/pipeline.h>
 #include <unordered_map>
@@ -16,6 +17,7 @@ struct partitioner {
     const uint8_t* operator()(tbb::flow_control& fc)const {
         if (last_out>=end) {
             fc.stop();
+            return nullptr;
         }
         //assert(last_out<end);
         auto out=last_out;
@@ -137,6 +139,26 @@ static bool load_mutations(const char *path, int nthread, output_t &out) {
             tbb::filter::parallel, printer<output_t> {out}));
     return true;
 }
+//Parse blocks in parallel with block_parser, and pass what it returns for each block to block_merger in file order
+template <typename block_parser_t, typename block_merger_t>
+static bool load_blocks_in_order(const char *path, int nthread, const block_parser_t& block_parser, const block_merger_t& block_merger) {
+    typedef decltype(block_parser((const uint8_t*)nullptr)) parsed_t;
+    mapped_file f(path);
+    if (!f) {
+        return false;
+    }
+    const uint8_t *last_out;
+    const uint8_t *end;
+    f.get_mapped_range(last_out, end);
+    tbb::parallel_pipeline(
+        nthread, tbb::make_filter<void, const uint8_t *>(
+            tbb::filter::serial_in_order, partitioner{last_out, end}) &
+        tbb::make_filter<const uint8_t *, parsed_t>(
+            tbb::filter::parallel, block_parser) &
+        tbb::make_filter<parsed_t, void>(
+            tbb::filter::serial_in_order, block_merger));
+    return true;
+}
 static void parse_rename_file(const std::string&  in_file_name, std::unordered_map<std::string,std::string>& mapping) {
     FILE* fd=fopen(in_file_name.c_str(),"r");
     char sample_name[BUFSIZ];
@@ -6,11 +6,14 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <ios>
 #include <string>
 #include "transpose_vcf.hpp"
+#include "transpose_vcf_isal.hpp"
+#include "transpose_vcf_output.hpp"
 #include <sys/types.h>
 #include <tbb/pipeline.h>
 #include <tbb/task_scheduler_init.h>
@@ -28,57 +31,262 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 std::mutex print_mutex;
-#define ZLIB_BUFSIZ 0x10000
 #include <atomic>
 #define SAMPLE_START_IDX 9
 std::atomic<size_t> buffer_left;
 //Decouple parsing (slow) and decompression, segment file into blocks for parallelized parsing
 typedef tbb::flow::source_node<char*> decompressor_node_t;
 typedef tbb::flow::function_node<char*> line_parser_t;
-static void writeVariant(std::string& out,unsigned int to_write) {
-    assert(to_write);
-    out.push_back(to_write&0x7f);
-    to_write>>=7;
-    while(to_write) {
-        out.back()|=0x80;
-        out.push_back(to_write&0x7f);
-        to_write>>=7;
+//Compressed size of the bgzip member at start, 0 if it is not a bgzip member with the BC extra field
+static size_t bgzf_member_size(const unsigned char* start,size_t left) {
+    if (left<18||start[0]!=31||start[1]!=139||start[2]!=8||!(start[3]&4)) {
+        return 0;
     }
+    size_t extra_len=start[10]|(start[11]<<8);
+    const unsigned char* extra=start+12;
+    const unsigned char* extra_end=extra+extra_len;
+    if (extra_end>start+left) {
+        return 0;
+    }
+    while (extra+4<=extra_end) {
+        size_t sub_len=extra[2]|(extra[3]<<8);
+        if (extra[0]=='B'&&extra[1]=='C'&&sub_len==2&&extra+6<=extra_end) {
+            size_t member_size=(extra[4]|(extra[5]<<8))+1;
+            //header, at least an empty deflate block and trailer
+            if (member_size<12+extra_len+8||member_size>left) {
+                return 0;
+            }
+            return member_size;
+        }
+        extra+=4+sub_len;
+    }
+    return 0;
 }
-struct Pos_Mut {
-    int position;
-    uint8_t mut;
-    bool operator<(const Pos_Mut& other)const {
-        return position<other.position;
+//Input VCF, inflated with isa-l if it is gzip (or bgzip) compressed, otherwise read as is
+class VCF_Reader {
+    unsigned char* map_start;
+    size_t mapped_size;
+    bool is_gzip;
+    //next unread byte of uncompressed input
+    const unsigned char* raw_ptr;
+    struct inflate_state state;
+    struct isal_gzip_header gz_hdr;
+    //small look-ahead buffer for parsing header character by character
+    unsigned char getc_buf[BUFSIZ];
+    unsigned char* getc_ptr;
+    unsigned char* getc_end;
+    //avail_in of isa-l is 32 bit, so feed the mapping at most UINT32_MAX bytes at a time
+    void refill() {
+        if (state.avail_in==0) {
+            size_t left=map_start+mapped_size-state.next_in;
+            state.avail_in=std::min(left,(size_t)UINT32_MAX);
+        }
+    }
+    size_t inflate_to_buffer(unsigned char* buffer, size_t buffer_size,bool stop_at_member_end=false) {
+        if (!is_gzip) {
+            size_t to_copy=std::min(buffer_size,(size_t)(map_start+mapped_size-raw_ptr));
+            memcpy(buffer, raw_ptr, to_copy);
+            raw_ptr+=to_copy;
+            return to_copy;
+        }
+        state.next_out=buffer;
+        state.avail_out=buffer_size;
+        refill();
+        while (state.avail_out>0&&state.avail_in>0) {
+            //bgzip and concatenated gzip files have multiple members, same as import_vcf_fast.cpp
+            if (state.block_state==ISAL_BLOCK_FINISH) {
+                if (stop_at_member_end&&state.avail_out!=buffer_size) {
+                    break;
+                }
+                if (state.avail_in>1&&state.next_in[0]==31&&state.next_in[1]==139) {
+                    isal_inflate_reset(&state);
+                } else {
+                    break;
+                }
+            }
+            auto out=isal_inflate(&state);
+            if (out!=ISAL_DECOMP_OK) {
+                fprintf(stderr, "decompress error %d\n",out);
+                exit(EXIT_FAILURE);
+            }
+            refill();
+        }
+        return buffer_size-state.avail_out;
+    }
+  public:
+    VCF_Reader(const char* fname):map_start(nullptr),mapped_size(0) {
+        auto fh=open(fname, O_RDONLY);
+        if (fh==-1) {
+            return;
+        }
+        struct stat stat_buf;
+        fstat(fh, &stat_buf);
+        mapped_size=stat_buf.st_size;
+        map_start=(unsigned char*)mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fh, 0);
+        close(fh);
+        if (map_start==MAP_FAILED) {
+            map_start=nullptr;
+            return;
+        }
+        madvise(map_start, mapped_size, MADV_SEQUENTIAL);
+        raw_ptr=map_start;
+        is_gzip=mapped_size>=2&&map_start[0]==31&&map_start[1]==139;
+        if (is_gzip) {
+            isal_inflate_init(&state);
+            state.next_in=map_start;
+            state.avail_in=0;
+            refill();
+            state.crc_flag=IGZIP_GZIP;
+            isal_gzip_header_init(&gz_hdr);
+            isal_read_gzip_header(&state, &gz_hdr);
+        }
+        getc_end=getc_buf+inflate_to_buffer(getc_buf, BUFSIZ);
+        getc_ptr=getc_buf;
+    }
+    operator bool() const {
+        return map_start!=nullptr;
+    }
+    int getc() {
+        if (getc_ptr==getc_end) {
+            getc_ptr=getc_buf;
+            getc_end=getc_buf+inflate_to_buffer(getc_buf, BUFSIZ);
+            if (getc_ptr==getc_end) {
+                return -1;
+            }
+        }
+        return *(getc_ptr++);
+    }
+    //Fill buffer with up to size bytes, first from what is left over from getc, return bytes read, 0 on EOF.
+    //Stop at the end of the current gzip member if any byte is read, so the following bgzip members can be inflated in parallel
+    size_t read(char* buffer, size_t size) {
+        size_t from_getc=std::min(size,(size_t)(getc_end-getc_ptr));
+        memcpy(buffer, getc_ptr, from_getc);
+        getc_ptr+=from_getc;
+        return from_getc+inflate_to_buffer((unsigned char*)buffer+from_getc, size-from_getc,true);
+    }
+    /**
+     * @brief Take whole bgzip members following what is already inflated, without inflating them
+     * @param[out] start start of the first member
+     * @param[out] inflated_size total uncompressed size of members taken
+     * @return compressed size of members taken, 0 if the next member is not a complete bgzip member
+     */
+    size_t take_bgzf_members(size_t target_inflated_size,const unsigned char*& start,size_t& inflated_size) {
+        inflated_size=0;
+        if (!is_gzip||getc_ptr!=getc_end||state.block_state!=ISAL_BLOCK_FINISH) {
+            return 0;
+        }
+        start=state.next_in;
+        auto map_end=map_start+mapped_size;
+        auto member_start=start;
+        while (inflated_size<target_inflated_size) {
+            auto member_size=bgzf_member_size(member_start, map_end-member_start);
+            if (!member_size) {
+                break;
+            }
+            member_start+=member_size;
+            inflated_size+=member_start[-4]|(member_start[-3]<<8)|(member_start[-2]<<16)|((uint32_t)member_start[-1]<<24);
+        }
+        state.next_in=const_cast<unsigned char*>(member_start);
+        state.avail_in=0;
+        refill();
+        return member_start-start;
+    }
+    ~VCF_Reader() {
+        if (map_start) {
+            munmap(map_start, mapped_size);
+        }
     }
 };
-struct Decompressor {
-    gzFile* fd;
-    size_t init_read_size;
-    size_t cont_read_size;
-    char* operator()(tbb::flow_control& fc) const {
-        char* buf;
-        if (gzeof(*fd)) {
+//A chunk of input, either already inflated, or bgzip members to be inflated in parallel
+struct Input_Chunk {
+    char* inflated;
+    size_t inflated_size;
+    const unsigned char* bgzf_start;
+    size_t bgzf_size;
+};
+//Serial head of the pipeline, only reads a chunk of bgzip members without inflating it,
+//other input (plain gzip, uncompressed, or what is left of the member the header ends in) is inflated here.
+struct Chunk_Reader {
+    VCF_Reader* fd;
+    size_t read_size;
+    Input_Chunk* operator()(tbb::flow_control& fc) const {
+        auto out=new Input_Chunk{nullptr,0,nullptr,0};
+        out->bgzf_size=fd->take_bgzf_members(read_size,out->bgzf_start,out->inflated_size);
+        if (out->bgzf_size) {
+            return out;
+        }
+        out->inflated=new char[read_size];
+        out->inflated_size=fd->read(out->inflated, read_size);
+        if (!out->inflated_size) {
+            delete[] out->inflated;
+            delete out;
             fc.stop();
             return nullptr;
         }
-        buf=new char[init_read_size+cont_read_size];
-        int read_size=gzread(*fd, buf, init_read_size);
-        if (read_size<0) {
-            int z_errnum = 0;
-            fputs( gzerror(*fd,&z_errnum),stderr);
+        return out;
+    }
+};
+//Inflate each bgzip member of a chunk separately
+struct Chunk_Inflater {
+    Input_Chunk* operator()(Input_Chunk* in) const {
+        if (!in->bgzf_size) {
+            return in;
         }
-        if (!read_size) {
+        in->inflated=new char[in->inflated_size];
+        auto member_start=in->bgzf_start;
+        auto chunk_end=in->bgzf_start+in->bgzf_size;
+        auto out=(unsigned char*) in->inflated;
+        while (member_start<chunk_end) {
+            auto member_size=bgzf_member_size(member_start, chunk_end-member_start);
+            auto member_end=member_start+member_size;
+            //empty member, like the EOF marker of bgzip
+            if (!(member_end[-4]|member_end[-3]|member_end[-2]|member_end[-1])) {
+                member_start=member_end;
+                continue;
+            }
+            size_t header_size=12+(member_start[10]|(member_start[11]<<8));
+            struct inflate_state state;
+            isal_inflate_init(&state);
+            state.next_in=const_cast<unsigned char*>(member_start+header_size);
+            state.avail_in=member_size-header_size-8;
+            state.next_out=out;
+            state.avail_out=in->inflated+in->inflated_size-(char*)out;
+            state.crc_flag=ISAL_DEFLATE;
+            auto ret=isal_inflate_stateless(&state);
+            if (ret!=ISAL_DECOMP_OK) {
+                fprintf(stderr, "decompress error %d\n",ret);
+                exit(EXIT_FAILURE);
+            }
+            out+=state.total_out;
+            member_start=member_end;
+        }
+        in->inflated_size=(char*)out-in->inflated;
+        return in;
+    }
+};
+//Carry the incomplete last line of each inflated chunk over to the next chunk,
+//so parsing of each chunk can start as soon as it is inflated.
+//Return nullptr if there is not even one complete line yet
+struct Line_Splitter {
+    std::string* carry_over;
+    char* operator()(Input_Chunk* in) const {
+        auto carry_size=carry_over->size();
+        size_t filled=carry_size+in->inflated_size;
+        char* buf=new char[filled+1];
+        memcpy(buf, carry_over->data(), carry_size);
+        memcpy(buf+carry_size, in->inflated, in->inflated_size);
+        delete[] in->inflated;
+        delete in;
+        size_t line_end=filled;
+        while (line_end&&buf[line_end-1]!='\n') {
+            line_end--;
+        }
+        carry_over->assign(buf+line_end,filled-line_end);
+        if (!line_end) {
             delete [] (buf);
-            fc.stop();
             return nullptr;
         }
-        //Make sure the last line is complete in the block.
-        if(!gzgets(*fd, buf+read_size, cont_read_size)) {
-            *(buf+read_size)=0;
-        }
-        //buffer_left++;
-        //fprintf(stderr, "buffer in flight %zu\n",buffer_left.load());
+        buf[line_end]=0;
         return buf;
     }
 };
@@ -113,6 +321,9 @@ struct Pos_Mut_Block {
 struct Line_Parser {
     size_t sample_size;
     std::vector<Pos_Mut_Block>* operator()(char* line_in)const {
+        if (!line_in) {
+            return nullptr;
+        }
         char* const start=line_in;
         std::vector<Pos_Mut_Block>* local_block= new std::vector<Pos_Mut_Block>(sample_size);
         while (*line_in!=0) {
@@ -193,6 +404,9 @@ struct Line_Parser {
 struct Appender {
     std::vector<std::vector<Pos_Mut_Block>>& sample_pos_mut;
     void operator()(std::vector<Pos_Mut_Block>* in) const {
+        if (!in) {
+            return;
+        }
         for (size_t idx=0; idx<sample_pos_mut.size(); idx++) {
             if (!(*in)[idx].empty()) {
                 sample_pos_mut[idx].push_back(std::move((*in)[idx]));
@@ -202,18 +416,18 @@ struct Appender {
     }
 };
 //tokenize header, get sample name
-static int read_header(gzFile* fd,std::vector<std::string>& out) {
+static int read_header(VCF_Reader& fd,std::vector<std::string>& out) {
     int header_len=0;
-    char in=gzgetc(*fd);
-    in=gzgetc(*fd);
+    char in=fd.getc();
+    in=fd.getc();
     bool second_char_pong=(in=='#');
 
     while (second_char_pong) {
         while (in!='\n') {
-            in=gzgetc(*fd);
+            in=fd.getc();
         }
-        in=gzgetc(*fd);
-        in=gzgetc(*fd);
+        in=fd.getc();
+        in=fd.getc();
         second_char_pong=(in=='#');
     }
 
@@ -226,43 +440,14 @@ static int read_header(gzFile* fd,std::vector<std::string>& out) {
                 break;
             }
             field.push_back(in);
-            in=gzgetc(*fd);
+            in=fd.getc();
             header_len++;
         }
-        in=gzgetc(*fd);
+        in=fd.getc();
         out.push_back(field);
     }
     return header_len;
 }
-struct Sample_Mut_Msg {
-    std::string buffer;
-    Sample_Mut_Msg() {}
-    Sample_Mut_Msg(const std::string& sample, const std::vector<Pos_Mut>& not_Ns,const std::vector<std::pair<int, int>>& Ns) {
-        buffer.reserve(sample.size()+5*not_Ns.size()+8*Ns.size());
-        buffer.insert(buffer.end(),(const uint8_t*)sample.c_str(),(const uint8_t*)(sample.c_str()+1+sample.size()));
-        assert(buffer.back()==0);
-        auto loop_end=not_Ns.size()&0xfffffffe;
-        for(size_t idx=0; idx<loop_end; idx+=2) {
-            writeVariant(buffer, not_Ns[idx].position);
-            assert(idx+1<not_Ns.size());
-            writeVariant(buffer, not_Ns[idx+1].position);
-            buffer.push_back((not_Ns[idx+1].mut<<4)|not_Ns[idx].mut);
-        }
-        if (not_Ns.size()&1) {
-            writeVariant(buffer, not_Ns[not_Ns.size()-1].position);
-            buffer.push_back(not_Ns[not_Ns.size()-1].mut);
-        }
-        buffer.push_back(0);
-        for(size_t idx=0; idx<Ns.size(); idx++) {
-            writeVariant(buffer, Ns[idx].second);
-            if (Ns[idx].first!=Ns[idx].second) {
-                writeVariant(buffer, Ns[idx].first);
-            }
-        }
-        buffer.push_back(0);
-    }
-};
-
 Sample_Mut_Msg* serialize(const std::string& sample, std::vector<Pos_Mut_Block>& mutation_blocks) {
     for (auto& block : mutation_blocks) {
         block.finalize();
@@ -287,100 +472,6 @@ Sample_Mut_Msg* serialize(const std::string& sample, std::vector<Pos_Mut_Block>&
     Sample_Mut_Msg* out=new Sample_Mut_Msg(sample,not_Ns,Ns);
     return out;
 }
-struct Packed_Msgs:public std::vector<Sample_Mut_Msg*> {
-    size_t acc_size;
-    Packed_Msgs():acc_size(0) {
-        clear();
-    }
-    bool push_back(Sample_Mut_Msg* in) {
-        auto new_size=acc_size+in->buffer.size();
-        if (new_size<=MAX_SIZ) {
-            std::vector<Sample_Mut_Msg*>::push_back(in);
-            acc_size=new_size;
-            return true;
-        }
-        return false;
-    }
-    void pop_back() {
-        acc_size-=(back()->buffer.size());
-        std::vector<Sample_Mut_Msg*>::pop_back();
-    }
-};
-typedef tbb::flow::multifunction_node<Packed_Msgs*, tbb::flow::tuple<Packed_Msgs*>> block_serializer_t;
-struct Block_Serializer {
-    Packed_Msgs* & out_buffer;
-    void operator()(Packed_Msgs * in,block_serializer_t::output_ports_type& out ) const {
-        if (!in) {
-            if (!out_buffer->empty()) {
-                std::get<0>(out).try_put(out_buffer);
-            }
-            out_buffer=nullptr;
-            return;
-        }
-        assert(out_buffer);
-        while(!in->empty()) {
-            if (out_buffer->push_back(in->back())) {
-                in->pop_back();
-            } else {
-                break;
-            }
-        }
-        if (in->empty()) {
-            delete in;
-        } else {
-            std::get<0>(out).try_put(out_buffer);
-            out_buffer=in;
-        }
-    }
-};
-size_t compress_len;
-typedef tbb::flow::function_node<Packed_Msgs*,std::pair<unsigned char*,size_t>> compressor_t;
-struct Compressor {
-    std::pair<unsigned char*,size_t> operator()(Packed_Msgs* in) const {
-        uint8_t* out=new uint8_t[compress_len];
-        z_stream stream;
-        stream.zalloc = (alloc_func)0;
-        stream.zfree = (free_func)0;
-        stream.opaque = (voidpf)0;
-        auto err = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
-        assert(err==Z_OK);
-        stream.next_out=out;
-        stream.avail_out=compress_len;
-        for(size_t idx=0; idx<in->size()-1; idx++) {
-            stream.next_in=(uint8_t*)const_cast<char*>((*in)[idx]->buffer.c_str());
-            stream.avail_in=(*in)[idx]->buffer.size();
-            err=deflate(&stream,Z_NO_FLUSH);
-            assert(stream.avail_out);
-            if (err!=Z_OK) {
-                fprintf(stderr, "%d",err);
-                assert(false);
-            }
-            assert(!stream.avail_in);
-            delete (*in)[idx];
-        }
-        stream.next_in=(uint8_t*)const_cast<char*>((*in)[in->size()-1]->buffer.c_str());
-        stream.avail_in=(*in)[in->size()-1]->buffer.size();
-        err=deflate(&stream,Z_FINISH);
-        assert(err==Z_STREAM_END);
-        assert(!stream.avail_in);
-        delete (*in)[in->size()-1];
-        deflateEnd(&stream);
-        size_t comp_len=stream.total_out;
-        delete in;
-        return std::make_pair(out,comp_len);
-    }
-};
-typedef tbb::flow::function_node<std::pair<unsigned char*,size_t>> write_node_t;
-struct Write_Node {
-    FILE* file;
-    void operator()(std::pair<unsigned char*,size_t> in) const {
-        unsigned int b_length=in.second;
-        //fprintf(stderr,"%d\n",b_length);
-        std::fwrite(&b_length,4,1,file);
-        std::fwrite(in.first,1,b_length,file);
-        delete[] in.first;
-    }
-};
 struct Empty {
     void add_Not_N(int position, uint8_t allele) {
     }
@@ -407,48 +498,19 @@ void get_samp_names(const std::string sample_names_fn,const std::vector<std::str
     }
 }
 #define CHUNK_SIZ 5
-template<typename T>
-void output_transposed_vcf(const char* out_name,T& data_source) {
-    tbb::flow::graph output_graph;
-    Packed_Msgs* blk_str=new Packed_Msgs;
-    block_serializer_t serializer_head(output_graph,tbb::flow::serial,Block_Serializer{blk_str});
-    compressor_t compressor(output_graph,4,Compressor{});
-    FILE* out_file=fopen(out_name, "a");
-    write_node_t writer(output_graph,tbb::flow::serial,Write_Node{out_file});
-    tbb::flow::make_edge(serializer_head,compressor);
-    tbb::flow::make_edge(compressor,writer);
-    data_source(compressor,serializer_head);
-    serializer_head.try_put(nullptr);
-    output_graph.wait_for_all();
-    fclose(out_file);
-}
-void add_output(compressor_t& compressor,block_serializer_t& serializer_head,Sample_Mut_Msg* out,Packed_Msgs*& packed_out) {
-    if (!packed_out->push_back(out)) {
-        compressor.try_put(packed_out);
-        packed_out=new Packed_Msgs();
-        auto ret=packed_out->push_back(out);
-        if (!ret) {
-            fprintf(stderr, "Message size %zu, cannot fit %d, new content %zu\n",out->buffer.size(),MAX_SIZ,packed_out->acc_size);
-        }
-        assert(ret);
-    }
-}
 struct VCF_inputer {
     uint32_t nthreads;
-    gzFile fd;
+    VCF_Reader fd;
     unsigned int header_size;
     std::vector<std::string> fields;
     std::vector<bool> do_add;
-    VCF_inputer(const char * name,uint32_t nthreads, const std::string& sample_names_fn) {
-        //open file set increase buffer size
-        fd=gzopen(name, "r");
+    VCF_inputer(const char * name,uint32_t nthreads, const std::string& sample_names_fn):nthreads(nthreads),fd(name) {
         if (!fd) {
             fprintf(stderr, "cannnot open vcf file : %s, exiting.\n",name);
             exit(EXIT_FAILURE);
         }
-        gzbuffer(fd,ZLIB_BUFSIZ);
 
-        header_size=read_header(&fd, fields);
+        header_size=read_header(fd, fields);
         get_samp_names(sample_names_fn, fields, do_add);
     }
     void operator()(compressor_t& compressor,block_serializer_t& serializer_head) {
@@ -458,11 +520,21 @@ struct VCF_inputer {
             samp.reserve(30);
         }
 
+        std::string carry_over;
         tbb::parallel_pipeline(nthreads,
-                               tbb::make_filter<void,char*>(tbb::filter::serial_in_order,Decompressor{&fd,CHUNK_SIZ*header_size,2*header_size})&
+                               tbb::make_filter<void,Input_Chunk*>(tbb::filter::serial_in_order,Chunk_Reader{&fd,CHUNK_SIZ*header_size})&
+                               tbb::make_filter<Input_Chunk*,Input_Chunk*>(tbb::filter::parallel,Chunk_Inflater{})&
+                               tbb::make_filter<Input_Chunk*,char*>(tbb::filter::serial_in_order,Line_Splitter{&carry_over})&
                                tbb::make_filter<char*,std::vector<Pos_Mut_Block>*>(tbb::filter::parallel,Line_Parser{fields.size()})&
                                tbb::make_filter<std::vector<Pos_Mut_Block>*,void>(tbb::filter::serial_out_of_order,Appender{sample_pos_mut}));
-        gzclose(fd);
+        //last line may not be terminated
+        if (!carry_over.empty()) {
+            char* last_line=new char[carry_over.size()+2];
+            memcpy(last_line, carry_over.data(), carry_over.size());
+            last_line[carry_over.size()]='\n';
+            last_line[carry_over.size()+1]=0;
+            Appender{sample_pos_mut}(Line_Parser{fields.size()}(last_line));
+        }
 
         tbb::parallel_for(tbb::blocked_range<size_t>(SAMPLE_START_IDX,fields.size()),[this,&sample_pos_mut,&serializer_head,&compressor](tbb::blocked_range<size_t>& range) {
             auto packed_out=new Packed_Msgs();
@@ -521,8 +593,7 @@ class Rename_Data_Source {
             uint8_t buffer[MAX_SIZ];
             unsigned int item_len=*(int*) in;
             size_t out_len=MAX_SIZ;
-            auto uncompress_out=uncompress(buffer, &out_len, in+4, item_len);
-            if(uncompress_out!=Z_OK) {
+            if(!inflate_block(in+4, item_len, buffer, out_len)) {
                 fprintf(stderr, "Corrupted input\n");
                 exit(EXIT_FAILURE);
             }
@@ -556,7 +627,6 @@ class Rename_Data_Source {
 namespace po = boost::program_options;
 
 int main(int argc,char** argv) {
-    compress_len=compressBound(MAX_SIZ);
     po::options_description desc{"Options"};
     uint32_t num_cores = tbb::task_scheduler_init::default_num_threads();
     std::string input_vcf_path;
@@ -590,10 +660,10 @@ int main(int argc,char** argv) {
     tbb::task_scheduler_init init(num_threads);
     if (input_vcf_path!="") {
         VCF_inputer vcf_in(input_vcf_path.c_str(),num_threads,output_path);
-        output_transposed_vcf(output_path.c_str(), vcf_in);
+        output_transposed_vcf(output_path.c_str(), vcf_in,num_threads);
     } else {
         Rename_Data_Source remaper(input_pb_path,input_remap_path,filter,num_threads);
-        output_transposed_vcf(output_path.c_str(), remaper);
+        output_transposed_vcf(output_path.c_str(), remaper,num_threads);
     }
     std::flush(std::cout);
 }
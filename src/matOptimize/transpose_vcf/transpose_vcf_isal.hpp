@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <zlib.h>
+#include "isa-l/igzip_lib.h"
+//Compress a block of transposed VCF with isa-l into zlib format, so readers in transpose_vcf.hpp
+//can still use zlib uncompress, out need to have at least compressBound(in_len) bytes
+static size_t compress_block(const uint8_t* in,size_t in_len,uint8_t* out,size_t out_len) {
+    static thread_local std::vector<uint8_t> level_buf(ISAL_DEF_LVL1_DEFAULT);
+    struct isal_zstream stream;
+    isal_deflate_stateless_init(&stream);
+    stream.gzip_flag=IGZIP_ZLIB;
+    stream.level=1;
+    stream.level_buf=level_buf.data();
+    stream.level_buf_size=level_buf.size();
+    stream.end_of_stream=1;
+    stream.flush=NO_FLUSH;
+    stream.next_in=const_cast<uint8_t*>(in);
+    stream.avail_in=in_len;
+    stream.next_out=out;
+    stream.avail_out=out_len;
+    auto err=isal_deflate_stateless(&stream);
+    if (err==COMP_OK) {
+        return stream.total_out;
+    }
+    //fall back to zlib, should not happen with compressBound sized output buffer
+    uLongf zlib_len=out_len;
+    auto zlib_err=compress2(out, &zlib_len, in, in_len, Z_DEFAULT_COMPRESSION);
+    if (zlib_err!=Z_OK) {
+        fprintf(stderr, "Compression error %d, %d\n",err,zlib_err);
+        exit(EXIT_FAILURE);
+    }
+    return zlib_len;
+}
+//Inflate a zlib compressed block of transposed VCF with isa-l
+static bool inflate_block(const uint8_t* in,size_t in_len,uint8_t* out,size_t& out_len) {
+    struct inflate_state state;
+    isal_inflate_init(&state);
+    state.next_in=const_cast<uint8_t*>(in);
+    state.avail_in=in_len;
+    state.next_out=out;
+    state.avail_out=out_len;
+    state.crc_flag=ISAL_ZLIB;
+    auto ret=isal_inflate_stateless(&state);
+    out_len=state.total_out;
+    return ret==ISAL_DECOMP_OK;
+}
@@ -0,0 +1,326 @@
+#pragma once
+#include "transpose_vcf.hpp"
+#include "transpose_vcf_isal.hpp"
+#include "tbb/flow_graph.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <tbb/parallel_sort.h>
+#include <tbb/pipeline.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+//Writing transposed VCF: samples are serialized into Sample_Mut_Msg by a data source, packed into blocks
+//of at most MAX_SIZ bytes, compressed in parallel and appended to the output.
+static void writeVariant(std::string& out,unsigned int to_write) {
+    assert(to_write);
+    out.push_back(to_write&0x7f);
+    to_write>>=7;
+    while(to_write) {
+        out.back()|=0x80;
+        out.push_back(to_write&0x7f);
+        to_write>>=7;
+    }
+}
+struct Pos_Mut {
+    int position;
+    uint8_t mut;
+    bool operator<(const Pos_Mut& other)const {
+        return position<other.position;
+    }
+};
+struct Sample_Mut_Msg {
+    std::string buffer;
+    Sample_Mut_Msg() {}
+    Sample_Mut_Msg(const std::string& sample, const std::vector<Pos_Mut>& not_Ns,const std::vector<std::pair<int, int>>& Ns) {
+        buffer.reserve(sample.size()+5*not_Ns.size()+8*Ns.size());
+        buffer.insert(buffer.end(),(const uint8_t*)sample.c_str(),(const uint8_t*)(sample.c_str()+1+sample.size()));
+        assert(buffer.back()==0);
+        auto loop_end=not_Ns.size()&0xfffffffe;
+        for(size_t idx=0; idx<loop_end; idx+=2) {
+            writeVariant(buffer, not_Ns[idx].position);
+            assert(idx+1<not_Ns.size());
+            writeVariant(buffer, not_Ns[idx+1].position);
+            buffer.push_back((not_Ns[idx+1].mut<<4)|not_Ns[idx].mut);
+        }
+        if (not_Ns.size()&1) {
+            writeVariant(buffer, not_Ns[not_Ns.size()-1].position);
+            buffer.push_back(not_Ns[not_Ns.size()-1].mut);
+        }
+        buffer.push_back(0);
+        for(size_t idx=0; idx<Ns.size(); idx++) {
+            writeVariant(buffer, Ns[idx].second);
+            if (Ns[idx].first!=Ns[idx].second) {
+                writeVariant(buffer, Ns[idx].first);
+            }
+        }
+        buffer.push_back(0);
+    }
+};
+struct Packed_Msgs:public std::vector<Sample_Mut_Msg*> {
+    size_t acc_size;
+    Packed_Msgs():acc_size(0) {
+        clear();
+    }
+    bool push_back(Sample_Mut_Msg* in) {
+        auto new_size=acc_size+in->buffer.size();
+        if (new_size<=MAX_SIZ) {
+            std::vector<Sample_Mut_Msg*>::push_back(in);
+            acc_size=new_size;
+            return true;
+        }
+        return false;
+    }
+    void pop_back() {
+        acc_size-=(back()->buffer.size());
+        std::vector<Sample_Mut_Msg*>::pop_back();
+    }
+};
+typedef tbb::flow::multifunction_node<Packed_Msgs*, tbb::flow::tuple<Packed_Msgs*>> block_serializer_t;
+struct Block_Serializer {
+    Packed_Msgs* & out_buffer;
+    void operator()(Packed_Msgs * in,block_serializer_t::output_ports_type& out ) const {
+        if (!in) {
+            if (!out_buffer->empty()) {
+                std::get<0>(out).try_put(out_buffer);
+            }
+            out_buffer=nullptr;
+            return;
+        }
+        assert(out_buffer);
+        while(!in->empty()) {
+            if (out_buffer->push_back(in->back())) {
+                in->pop_back();
+            } else {
+                break;
+            }
+        }
+        if (in->empty()) {
+            delete in;
+        } else {
+            std::get<0>(out).try_put(out_buffer);
+            out_buffer=in;
+        }
+    }
+};
+static size_t compress_len=compressBound(MAX_SIZ);
+typedef tbb::flow::function_node<Packed_Msgs*,std::pair<unsigned char*,size_t>> compressor_t;
+struct Compressor {
+    std::pair<unsigned char*,size_t> operator()(Packed_Msgs* in) const {
+        std::string raw;
+        raw.reserve(in->acc_size);
+        for(auto msg:*in) {
+            raw.append(msg->buffer);
+            delete msg;
+        }
+        delete in;
+        uint8_t* out=new uint8_t[compress_len];
+        size_t comp_len=compress_block((const uint8_t*)raw.data(), raw.size(), out, compress_len);
+        return std::make_pair(out,comp_len);
+    }
+};
+typedef tbb::flow::function_node<std::pair<unsigned char*,size_t>> write_node_t;
+struct Write_Node {
+    FILE* file;
+    void operator()(std::pair<unsigned char*,size_t> in) const {
+        unsigned int b_length=in.second;
+        //fprintf(stderr,"%d\n",b_length);
+        std::fwrite(&b_length,4,1,file);
+        std::fwrite(in.first,1,b_length,file);
+        delete[] in.first;
+    }
+};
+template<typename T>
+void output_transposed_vcf(const char* out_name,T& data_source,uint32_t nthreads) {
+    tbb::flow::graph output_graph;
+    Packed_Msgs* blk_str=new Packed_Msgs;
+    block_serializer_t serializer_head(output_graph,tbb::flow::serial,Block_Serializer{blk_str});
+    compressor_t compressor(output_graph,nthreads,Compressor{});
+    FILE* out_file=fopen(out_name, "a");
+    write_node_t writer(output_graph,tbb::flow::serial,Write_Node{out_file});
+    tbb::flow::make_edge(serializer_head,compressor);
+    tbb::flow::make_edge(compressor,writer);
+    data_source(compressor,serializer_head);
+    serializer_head.try_put(nullptr);
+    output_graph.wait_for_all();
+    fclose(out_file);
+}
+static void add_output(compressor_t& compressor,block_serializer_t& serializer_head,Sample_Mut_Msg* out,Packed_Msgs*& packed_out) {
+    if (!packed_out->push_back(out)) {
+        compressor.try_put(packed_out);
+        packed_out=new Packed_Msgs();
+        auto ret=packed_out->push_back(out);
+        if (!ret) {
+            fprintf(stderr, "Message size %zu, cannot fit %d, new content %zu\n",out->buffer.size(),MAX_SIZ,packed_out->acc_size);
+        }
+        assert(ret);
+    }
+}
+//Compaction: merge transposed VCFs, keeping only the last record of each sample
+struct Skip_Mutations {
+    void add_Not_N(int position, uint8_t allele) {}
+    void add_N(int first, int second) {}
+};
+struct Record_Name_Getter {
+    std::string name;
+    Skip_Mutations set_name(std::string &&sample_name) {
+        name=std::move(sample_name);
+        return Skip_Mutations{};
+    }
+};
+//Serialized record of a sample as it is in the file, the name is also at the start of buffer
+typedef std::vector<std::pair<std::string, std::string>> sample_records_t;
+//Split a block into records of each sample without decoding the mutations
+struct Record_Splitter {
+    sample_records_t* operator()(const uint8_t* in) const {
+        uint8_t buffer[MAX_SIZ];
+        unsigned int item_len=*(int*) in;
+        size_t out_len=MAX_SIZ;
+        if(!inflate_block(in+4, item_len, buffer, out_len)) {
+            fprintf(stderr, "Corrupted input\n");
+            exit(EXIT_FAILURE);
+        }
+        auto out=new sample_records_t;
+        const uint8_t* start=buffer;
+        auto end=buffer+out_len;
+        while(start!=end) {
+            Record_Name_Getter name_getter;
+            auto record_start=start;
+            start=parse_buffer(start, name_getter);
+            out->emplace_back(std::move(name_getter.name),std::string((const char*)record_start,start-record_start));
+        }
+        return out;
+    }
+};
+//Blocks arrive in file order, so later records of the same sample replace earlier ones
+struct Record_Merger {
+    std::unordered_map<std::string, std::string>& latest;
+    size_t& total_records;
+    void operator()(sample_records_t* in) const {
+        total_records+=in->size();
+        for(auto& record:*in) {
+            latest[std::move(record.first)]=std::move(record.second);
+        }
+        delete in;
+    }
+};
+//Fill blocks to about this fraction of MAX_SIZ, so blocks are balanced in size
+#define TARGET_BLOCK_FRACTION 0.75
+typedef std::vector<const std::pair<const std::string, std::string>*> sorted_records_t;
+struct Block_Range {
+    size_t start;
+    size_t end;
+};
+struct Range_Generator {
+    const std::vector<size_t>& block_starts;
+    size_t& next_block;
+    Block_Range operator()(tbb::flow_control& fc) const {
+        if (next_block+1>=block_starts.size()) {
+            fc.stop();
+            return Block_Range{0,0};
+        }
+        next_block++;
+        return Block_Range{block_starts[next_block-1],block_starts[next_block]};
+    }
+};
+struct Block_Range_Compressor {
+    const sorted_records_t& sorted;
+    std::pair<Block_Range,std::pair<unsigned char*,size_t>> operator()(Block_Range range) const {
+        auto packed=new Packed_Msgs;
+        for (size_t idx=range.start; idx<range.end; idx++) {
+            auto msg=new Sample_Mut_Msg;
+            msg->buffer=sorted[idx]->second;
+            auto ret=packed->push_back(msg);
+            assert(ret);
+        }
+        return std::make_pair(range,Compressor{}(packed));
+    }
+};
+//Write blocks in order, and for each block a line of "offset, compressed length, number of samples, first sample, last sample" to the index
+struct Indexed_Block_Writer {
+    FILE* file;
+    FILE* index_file;
+    const sorted_records_t& sorted;
+    size_t& offset;
+    void operator()(std::pair<Block_Range,std::pair<unsigned char*,size_t>> in) const {
+        auto range=in.first;
+        unsigned int b_length=in.second.second;
+        Write_Node{file}(in.second);
+        fprintf(index_file, "%zu\t%u\t%zu\t%s\t%s\n",offset,b_length,range.end-range.start,
+                sorted[range.start]->first.c_str(),sorted[range.end-1]->first.c_str());
+        offset+=b_length+4;
+    }
+};
+//Merge transposed VCFs, samples in later files override earlier ones, and within a file later records override earlier ones.
+//Samples are written sorted by name into size balanced blocks, with a block index at <out_name>.idx, so the output only
+//depends on the input. out_name can be one of in_names, it is only replaced after everything is written
+static bool compact_transposed_vcf(const std::vector<std::string>& in_names,const std::string& out_name,uint32_t nthreads) {
+    std::unordered_map<std::string, std::string> latest;
+    size_t total_records=0;
+    for(const auto& in_name:in_names) {
+        if (!load_blocks_in_order(in_name.c_str(), nthreads, Record_Splitter{}, Record_Merger{latest,total_records})) {
+            fprintf(stderr, "cannot open %s\n",in_name.c_str());
+            return false;
+        }
+    }
+    fprintf(stderr, "%zu records loaded, %zu unique samples\n",total_records,latest.size());
+    sorted_records_t sorted;
+    sorted.reserve(latest.size());
+    size_t total_size=0;
+    for(const auto& record:latest) {
+        sorted.push_back(&record);
+        total_size+=record.second.size();
+    }
+    tbb::parallel_sort(sorted.begin(),sorted.end(),[](const std::pair<const std::string, std::string>* lhs,const std::pair<const std::string, std::string>* rhs) {
+        return lhs->first<rhs->first;
+    });
+    size_t block_count=total_size/(MAX_SIZ*TARGET_BLOCK_FRACTION)+1;
+    size_t target_size=total_size/block_count+1;
+    std::vector<size_t> block_starts{0};
+    size_t curr_size=0;
+    for (size_t idx=0; idx<sorted.size(); idx++) {
+        auto record_size=sorted[idx]->second.size();
+        if (curr_size&&(curr_size+record_size>target_size||curr_size+record_size>MAX_SIZ)) {
+            block_starts.push_back(idx);
+            curr_size=0;
+        }
+        curr_size+=record_size;
+    }
+    if (!sorted.empty()) {
+        block_starts.push_back(sorted.size());
+    }
+
+    auto temp_name=out_name+".tmp";
+    auto index_name=out_name+".idx";
+    auto temp_index_name=index_name+".tmp";
+    FILE* out_file=fopen(temp_name.c_str(), "w");
+    if (!out_file) {
+        perror(("cannot open output "+temp_name).c_str());
+        return false;
+    }
+    FILE* index_file=fopen(temp_index_name.c_str(), "w");
+    if (!index_file) {
+        perror(("cannot open output "+temp_index_name).c_str());
+        fclose(out_file);
+        return false;
+    }
+    fputs("#offset\tcompressed_length\tsample_count\tfirst_sample\tlast_sample\n",index_file);
+    size_t next_block=0;
+    size_t offset=0;
+    tbb::parallel_pipeline(
+        nthreads, tbb::make_filter<void, Block_Range>(
+            tbb::filter::serial_in_order, Range_Generator{block_starts,next_block}) &
+        tbb::make_filter<Block_Range, std::pair<Block_Range,std::pair<unsigned char*,size_t>>>(
+            tbb::filter::parallel, Block_Range_Compressor{sorted}) &
+        tbb::make_filter<std::pair<Block_Range,std::pair<unsigned char*,size_t>>,void>(
+            tbb::filter::serial_in_order, Indexed_Block_Writer{out_file,index_file,sorted,offset}));
+    fclose(out_file);
+    fclose(index_file);
+    if (rename(temp_name.c_str(), out_name.c_str())||rename(temp_index_name.c_str(), index_name.c_str())) {
+        perror("cannot rename output");
+        return false;
+    }
+    fprintf(stderr, "%zu blocks written, %zu bytes\n",block_starts.size()-1,offset);
+    return true;
+}
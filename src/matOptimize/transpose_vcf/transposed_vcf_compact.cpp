@@ -0,0 +1,39 @@
+#include "transpose_vcf_output.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tbb/task_scheduler_init.h>
+#include <vector>
+#include <boost/program_options/value_semantic.hpp>
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+int main(int argc,char** argv) {
+    po::options_description desc{"Options"};
+    uint32_t num_cores = tbb::task_scheduler_init::default_num_threads();
+    std::vector<std::string> input_paths;
+    std::string output_path;
+    uint32_t num_threads;
+    std::string num_threads_message = "Number of threads to use when possible [DEFAULT uses all available cores, " + std::to_string(num_cores) + " detected on this machine]";
+    desc.add_options()
+    ("input_path,i", po::value<std::vector<std::string>>(&input_paths)->multitoken()->required(), "Input transposed VCF(s), samples in later ones override earlier ones")
+    ("output_path,o", po::value<std::string>(&output_path)->required(), "Output compacted transposed VCF, index is written to <output_path>.idx")
+    ("threads,T", po::value<uint32_t>(&num_threads)->default_value(num_cores), num_threads_message.c_str());
+    po::options_description all_options;
+    all_options.add(desc);
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(all_options).run(), vm);
+        po::notify(vm);
+    } catch(std::exception &e) {
+        std::cerr << desc << std::endl;
+        // Return with error code 1 unless the user specifies help
+        if(vm.count("help"))
+            return 0;
+        else
+            return 1;
+    }
+    tbb::task_scheduler_init init(num_threads);
+    if (!compact_transposed_vcf(input_paths, output_path, num_threads)) {
+        return EXIT_FAILURE;
+    }
+}
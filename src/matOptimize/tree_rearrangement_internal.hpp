@@ -32,30 +32,26 @@ extern std::atomic_bool interrupted;
 extern tbb::concurrent_unordered_map<MAT::Mutation, tbb::concurrent_unordered_map<std::string, nuc_one_hot>*,Mutation_Pos_Only_Hash,
        Mutation_Pos_Only_Comparator>
        mutated_positions;
+//Compact record of a move, candidate moves are passed around by value, and the path src-LCA-dst is
+//walked through parent pointers when needed instead of stored, as the tree is not changed during search
 struct Profitable_Moves {
     int score_change;
     MAT::Node* src;
     MAT::Node* dst;
     MAT::Node* LCA;
     int radius_left;
-    std::unordered_set<MAT::Node*> involved_nodes;
+    //call f on each node on the path from src to dst, including LCA
     template<typename F>
-    void apply_nodes(F f) {
-        for (const auto node : involved_nodes) {
-            f(node);
-        }
-    }
-    void populate_involved_nodes() {
-        involved_nodes.reserve(2+src->level+dst->level-2*LCA->level);
-        involved_nodes.insert(LCA);
+    void apply_nodes(F f) const {
+        f(LCA);
         auto src_ancestor=src;
         auto dst_ancestor=dst;
         while (src_ancestor!=LCA) {
-            involved_nodes.insert(src_ancestor);
+            f(src_ancestor);
             src_ancestor=src_ancestor->parent;
         }
         while (dst_ancestor!=LCA) {
-            involved_nodes.insert(dst_ancestor);
+            f(dst_ancestor);
             dst_ancestor=dst_ancestor->parent;
         }
     }
@@ -66,11 +62,12 @@ struct Profitable_Moves {
         return dst;
     }
 };
-typedef std::shared_ptr<Profitable_Moves> Profitable_Moves_ptr_t;
+//Points to moves accepted by the conflict resolver, owned by the resolver's Accepted_Moves_t
+typedef Profitable_Moves* Profitable_Moves_ptr_t;
 struct output_t {
     int score_change;
     int radius_left;
-    std::vector<Profitable_Moves_ptr_t>* moves;
+    std::vector<Profitable_Moves>* moves;
     output_t():score_change(-1),radius_left(-1) {}
 };
 int individual_move(Mutation_Annotated_Tree::Node* src,Mutation_Annotated_Tree::Node* dst,Mutation_Annotated_Tree::Node* LCA,output_t& out,bool do_drift
@@ -80,7 +77,7 @@ int individual_move(Mutation_Annotated_Tree::Node* src,Mutation_Annotated_Tree::
                    );
 Mutation_Annotated_Tree::Tree load_tree(const std::string& path,Original_State_t& origin_states);
 void load_vcf_nh_directly( MAT::Tree& t,const std::string& vcf_path,Original_State_t& origin_states);
-void apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
+int apply_moves(std::vector<Profitable_Moves_ptr_t> &all_moves, MAT::Tree &t
 #ifdef CHECK_STATE_REASSIGN
                  ,
                  const Original_State_t& original_state
@@ -92,18 +89,21 @@ void find_nodes_to_move(const std::vector<MAT::Node *> &bfs_ordered_nodes,
 void add_root(MAT::Tree *tree) ;
 void VCF_input(const char * name,MAT::Tree& tree);
 
-void optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
+class Move_Journal;
+//returns the change in parsimony score from applying moves and cleaning the tree
+int optimize_tree_main_thread(std::vector<size_t> &nodes_to_search,
                                MAT::Tree &t,int radius,FILE* log,bool allow_drift,int iteration,
                                std::vector<size_t>& deferred_nodes_out,bool MPI_involved,std::chrono::steady_clock::time_point end_time,bool do_continue,bool search_all_dir,bool isfirst_this_iter
 #ifdef CHECK_STATE_REASSIGN
                                , Original_State_t& origin_states
 #endif
+                               , Move_Journal* journal=nullptr
                               );
 
 void optimize_tree_worker_thread(MAT::Tree &t,int radius,bool do_drift,bool search_all_dir);
 void save_final_tree(MAT::Tree &t,const std::string &output_path);
-//For removing nodes with no valid mutations between rounds
-void clean_tree(MAT::Tree& t);
+//For removing nodes with no valid mutations between rounds, returns the change in parsimony score
+int clean_tree(MAT::Tree& t);
 void populate_mutated_pos(const Original_State_t& origin_state,MAT::Tree& tree);
 void add_ambuiguous_mutations(const char* path,Original_State_t& to_patch,Mutation_Annotated_Tree::Tree& tree);
 void recondense_tree(MAT::Tree& t);
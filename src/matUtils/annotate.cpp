@@ -347,7 +347,7 @@ void parse_clade_names(const std::string& clade_filename,
 
                 for (auto m: ancestral_mutations) {
                     if (m.ref_nuc != m.mut_nuc) {
-                        std::string mut_string = m.chrom + "\t" + std::to_string(m.ref_nuc) + "\t" +
+                        std::string mut_string = m.get_chromosome() + "\t" + std::to_string(m.ref_nuc) + "\t" +
                                                  std::to_string(m.position) + "\t" + std::to_string(m.mut_nuc);
                         tbb_lock.lock();
                         if (mutation_counts.find(mut_string) == mutation_counts.end()) {
@@ -367,7 +367,7 @@ void parse_clade_names(const std::string& clade_filename,
                 std::vector<std::string> words;
                 MAT::string_split(mc.first, words);
                 MAT::Mutation m;
-                m.chrom = words[0];
+                m.set_chromosome(words[0]);
                 m.ref_nuc = static_cast<int8_t>(std::stoi(words[1]));
                 m.par_nuc = m.ref_nuc;
                 m.position = std::stoi(words[2]);
@@ -377,7 +377,7 @@ void parse_clade_names(const std::string& clade_filename,
                 std::vector<std::string> words;
                 MAT::string_split(mc.first, words);
                 MAT::Mutation m;
-                m.chrom = words[0];
+                m.set_chromosome(words[0]);
                 m.ref_nuc = static_cast<int8_t>(std::stoi(words[1]));
                 m.par_nuc = m.ref_nuc;
                 m.position = std::stoi(words[2]);
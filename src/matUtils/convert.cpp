@@ -1,4 +1,5 @@
 #include "convert.hpp"
+#include "select.hpp"
 #include "nlohmann_json.hpp"
 #include "tbb/pipeline.h"
 #include <algorithm>
@@ -64,7 +65,7 @@ uint r_add_genotypes(MAT::Node *node,
     if (samples_to_use->find(node->identifier) != samples_to_use->end()) {
         // Store genotypes in this leaf's column for all mutations on the path from root to leaf
         for (auto mut: mut_stack) {
-            std::string chrom = mut->chrom;
+            const std::string& chrom = mut->get_chromosome();
             uint pos = (uint)mut->position;
             if (chrom.empty()) {
                 fprintf(stderr, "mut->chrom is empty std::string at node '%s', position %u\n",
@@ -94,9 +95,7 @@ uint r_add_genotypes(MAT::Node *node,
         leaf_ix = r_add_genotypes(child, info, leaf_count, leaf_ix,
                                   mut_stack, samples_to_use);
     }
-    for (auto mut: node->mutations) {
-        mut_stack.pop_back();
-    }
+    mut_stack.resize(mut_stack.size() - node->mutations.size());
     return leaf_ix;
 }
 
@@ -365,7 +364,7 @@ void create_node_from_json(MAT::Tree* T, json nodeinfo, MAT::Node* parent = NULL
             n->branch_length = blen;
             for (auto m: mutations) {
                 MAT::Mutation mut;
-                mut.chrom = "NC_045512"; //hardcoded for sars-cov-2, in line with the jsons.
+                mut.set_chromosome("NC_045512"); //hardcoded for sars-cov-2, in line with the jsons.
                 //the json encodes ambiguous bases as - sometimes, it seems.
                 int8_t nucid;
                 if (static_cast<char>(m[0]) == '-') {
@@ -427,13 +426,14 @@ MAT::Tree load_mat_from_json(std::string json_filename) {
     return T;
 }
 
-json get_json_entry(MAT::Node* n, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, size_t div = 0, bool use_clade_zero = false, bool use_clade_one = false) {
+json get_json_entry(MAT::Node* n, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, size_t& div, bool use_clade_zero = false, bool use_clade_one = false) {
     //each node has 3 constituent attributes
     //node_attrs, branch_attrs, and children. If its a leaf,
     //it also has a simple name attribute.
     //branch_attrs contains mutation information.
     //node_attrs contains clade information.
-    //children contains nested information about the child nodes.
+    //children are not included here, they are streamed in between by get_json_node_parts.
+    //div is updated to include the mutations of this node.
     json sj;
     std::vector<std::string> mutids;
     std::string muts;
@@ -491,15 +491,63 @@ json get_json_entry(MAT::Node* n, std::vector<std::unordered_map<std::string,std
         }
     }
     sj["name"] = n->identifier;
-    std::vector<json> child_json;
-    for (auto cn: n->children) {
-        json cj = get_json_entry(cn, catmeta, div, use_clade_zero, use_clade_one);
-        child_json.push_back(cj);
-        sj["children"] = child_json;
-    }
     return sj;
 }
 
+void get_json_node_parts(MAT::Node* n, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, size_t& div, bool use_clade_zero, bool use_clade_one, std::string& head, std::string& tail) {
+    //the children of a node are written between head and tail, keys are in the same (sorted) order
+    //as nlohmann would dump a node with its "children" array, so the output is unchanged.
+    json sj = get_json_entry(n, catmeta, div, use_clade_zero, use_clade_one);
+    if (n->children.size() == 0) {
+        head = sj.dump();
+        tail = "";
+        return;
+    }
+    head = "{\"branch_attrs\":" + sj["branch_attrs"].dump() + ",\"children\":[";
+    tail = "],\"name\":" + sj["name"].dump() + ",\"node_attrs\":" + sj["node_attrs"].dump() + "}";
+}
+
+void append_json_subtree(std::string& out, MAT::Node* n, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, size_t div, bool use_clade_zero, bool use_clade_one) {
+    std::string head;
+    std::string tail;
+    get_json_node_parts(n, catmeta, div, use_clade_zero, use_clade_one, head, tail);
+    out.append(head);
+    for (size_t i = 0; i < n->children.size(); i++) {
+        if (i > 0) {
+            out.push_back(',');
+        }
+        append_json_subtree(out, n->children[i], catmeta, div, use_clade_zero, use_clade_one);
+    }
+    out.append(tail);
+}
+
+struct JSON_Fragment {
+    //either a subtree to render starting at div, or literal text from the nodes above the subtrees if node is NULL
+    MAT::Node* node;
+    size_t div;
+    std::string text;
+};
+
+void plan_json_fragments(MAT::Node* n, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, size_t div, bool use_clade_zero, bool use_clade_one, size_t max_fragment_size, std::vector<JSON_Fragment>& plan) {
+    //split the tree into subtrees of at most max_fragment_size nodes (in dfs order) that can be rendered independently,
+    //relies on dfs_idx and dfs_end_idx from depth_first_expansion
+    if (n->dfs_end_idx - n->dfs_idx <= max_fragment_size) {
+        plan.push_back(JSON_Fragment{n, div, ""});
+        return;
+    }
+    std::string head;
+    std::string tail;
+    get_json_node_parts(n, catmeta, div, use_clade_zero, use_clade_one, head, tail);
+    plan.push_back(JSON_Fragment{NULL, 0, head});
+    for (size_t i = 0; i < n->children.size(); i++) {
+        if (i > 0) {
+            plan.push_back(JSON_Fragment{NULL, 0, ","});
+        }
+        plan_json_fragments(n->children[i], catmeta, div, use_clade_zero, use_clade_one, max_fragment_size, plan);
+    }
+    plan.push_back(JSON_Fragment{NULL, 0, tail});
+}
+
 void write_json_from_mat(MAT::Tree* T, std::string output_filename, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, std::string title) {
     T->rotate_for_display(true);
     json nj;
@@ -541,7 +589,8 @@ void write_json_from_mat(MAT::Tree* T, std::string output_filename, std::vector<
     //check whether each of the mat clade annotation fields are used by any sample.
     bool uses_clade_0 = false;
     bool uses_clade_1 = false;
-    for (auto n: T->depth_first_expansion()) {
+    auto dfs = T->depth_first_expansion();
+    for (auto n: dfs) {
         if (n->clade_annotations.size() >= 1) {
             if (n->clade_annotations[0] != "") {
                 uses_clade_0 = true;
@@ -564,12 +613,47 @@ void write_json_from_mat(MAT::Tree* T, std::string output_filename, std::vector<
         std::unordered_map<std::string,std::string> c2map {{"key","MAT_Clade_1"},{"title","MAT_Clade_2"},{"type","categorical"}};
         nj["meta"]["colorings"].push_back(c2map);
     }
-    auto treestuff = get_json_entry(T->root, catmeta, 0, uses_clade_0, uses_clade_1);
-    nj["tree"]["children"] = json::array({treestuff});
-    std::ofstream out(output_filename);
-    // out << std::setw(4) << nj << std::endl;
-    out << nj << std::endl;
-    out.close();
+    //the tree is streamed instead of being built as one json object, subtrees are rendered in parallel
+    //and written in order, so only a bounded number of rendered subtrees are in memory at a time.
+    size_t num_threads = tbb::task_scheduler_init::default_num_threads();
+    size_t max_fragment_size = std::max((size_t)1024, dfs.size() / (16 * num_threads));
+    std::vector<JSON_Fragment> plan;
+    plan_json_fragments(T->root, catmeta, 0, uses_clade_0, uses_clade_1, max_fragment_size, plan);
+    try {
+        std::ofstream outfile(output_filename, std::ios::out | std::ios::binary);
+        boost::iostreams::filtering_streambuf<boost::iostreams::output> outbuf;
+        if (output_filename.find(".gz\0") != std::string::npos) {
+            outbuf.push(boost::iostreams::gzip_compressor());
+        }
+        outbuf.push(outfile);
+        std::ostream out(&outbuf);
+        //same layout as dumping nj with the tree as the only child of the wrapper
+        out << "{\"meta\":" << nj["meta"].dump() << ",\"tree\":{\"children\":[";
+        size_t fragment_idx = 0;
+        tbb::parallel_pipeline(num_threads * 2, tbb::make_filter<void, JSON_Fragment*>(tbb::filter::serial_in_order,
+        [&](tbb::flow_control& fc) -> JSON_Fragment* {
+            if (fragment_idx >= plan.size()) {
+                fc.stop();
+                return NULL;
+            }
+            return &plan[fragment_idx++];
+        }) & tbb::make_filter<JSON_Fragment*, JSON_Fragment*>(tbb::filter::parallel,
+        [&](JSON_Fragment* fragment) {
+            if (fragment->node != NULL) {
+                append_json_subtree(fragment->text, fragment->node, catmeta, fragment->div, uses_clade_0, uses_clade_1);
+            }
+            return fragment;
+        }) & tbb::make_filter<JSON_Fragment*, void>(tbb::filter::serial_in_order,
+        [&](JSON_Fragment* fragment) {
+            out << fragment->text;
+            std::string().swap(fragment->text);
+        }));
+        out << "],\"name\":\"wrapper\"},\"version\":" << nj["version"].dump() << "}" << std::endl;
+        boost::iostreams::close(outbuf);
+        outfile.close();
+    } catch (const boost::iostreams::gzip_error& e) {
+        std::cout << e.what() << '\n';
+    }
 }
 
 void get_minimum_subtrees(MAT::Tree* T, std::vector<std::string> samples, size_t nearest_subtree_size, std::string output_dir, std::vector<std::unordered_map<std::string,std::unordered_map<std::string,std::string>>>* catmeta, std::string json_n, std::string newick_n, bool retain_original_branch_len) {
@@ -596,6 +680,9 @@ void get_minimum_subtrees(MAT::Tree* T, std::vector<std::string> samples, size_t
     /// record trees here
     std::vector<std::vector<std::string> > subtree_sample_sets ;
 
+    /// one index shared by every query; this also sets dfs_idx for extraction below
+    Nearest_Sample_Index nearest_index(T);
+
     for ( size_t i = 0 ; i < samples.size() ; i ++ ) {
 
         auto check_sample = samples_we_have_seen.find( samples[i] ) ;
@@ -604,7 +691,7 @@ void get_minimum_subtrees(MAT::Tree* T, std::vector<std::string> samples, size_t
         }
 
         /// get the nearby tree of size nearest_subtree_size
-        std::vector<std::string> leaves_to_keep = get_nearby( T, samples[i], nearest_subtree_size ) ;
+        std::vector<std::string> leaves_to_keep = nearest_index.get_nearby( samples[i], nearest_subtree_size ) ;
 
         if ( leaves_to_keep.size() == 0 ) {
             samples_we_have_seen.insert({samples[i],-1}) ;
@@ -624,7 +711,13 @@ void get_minimum_subtrees(MAT::Tree* T, std::vector<std::string> samples, size_t
     [&](tbb::blocked_range<size_t> r) {
         for (size_t i = r.begin(); i < r.end() ; i++) {
 
-            auto new_T = Mutation_Annotated_Tree::get_subtree(*T, subtree_sample_sets[i]);
+            //the tree is only read from here on, so subtrees are extracted concurrently
+            std::vector<MAT::Node*> subtree_samples;
+            subtree_samples.reserve(subtree_sample_sets[i].size());
+            for (const auto& s: subtree_sample_sets[i]) {
+                subtree_samples.push_back(T->get_node(s));
+            }
+            auto new_T = Mutation_Annotated_Tree::get_subtree_dfs_indexed(*T, subtree_samples);
 
             //from here, this function diverges from the similar function in the MAT definition.
             if (json_n != output_dir) {
@@ -639,6 +732,7 @@ void get_minimum_subtrees(MAT::Tree* T, std::vector<std::string> samples, size_t
                 subtree_file << newick_ss.rdbuf();
                 subtree_file.close();
             }
+            MAT::clear_tree(new_T);
         }
         /// end TBB loop
     } ) ;
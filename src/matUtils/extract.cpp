@@ -266,7 +266,7 @@ usher_single_subtree_size == 0 && usher_minimum_subtrees_size == 0) {
             fprintf(stderr, "ERROR: Invalid neighborhood size. Please choose a positive nonzero integer.\n");
             exit(1);
         }
-        auto nk_samples = get_nearby(&T, sample_id, nk);
+        auto nk_samples = Nearest_Sample_Index(&T).get_nearby(sample_id, nk);
         assert ( nk_samples.size() > 0 ) ;
         if (samples.size() == 0) {
             samples = nk_samples;
@@ -400,8 +400,9 @@ usher_single_subtree_size == 0 && usher_minimum_subtrees_size == 0) {
         //in this case, just store the original list.
         not_nearest.insert(samples.begin(), samples.end());
         std::unordered_set<std::string> nsamples;
+        Nearest_Sample_Index nearest_index(&T);
         for (auto s: samples) {
-            auto nearest = get_nearby(&T, s, select_nearest);
+            auto nearest = nearest_index.get_nearby(s, select_nearest);
             nsamples.insert(nearest.begin(), nearest.end());
         }
         samples.assign(nsamples.begin(), nsamples.end());
@@ -675,16 +676,24 @@ usher_single_subtree_size == 0 && usher_minimum_subtrees_size == 0) {
         auto batch_samples = read_sample_names(sample_file);
         timer.Start();
         static tbb::affinity_partitioner ap;
+        //T is indexed once here, threads below only read it, so subtrees are extracted with
+        //get_subtree_dfs_indexed instead of anything that calls depth_first_expansion on T
+        Nearest_Sample_Index nearest_index(&T);
 
         tbb::parallel_for(tbb::blocked_range<size_t>(0, batch_samples.size() ),
         [&](const tbb::blocked_range<size_t> r) {
 
             for (auto s = r.begin() ; s < r.end() ; ++s ) {
-                auto cs = get_nearby(&T, batch_samples[s], nk);
+                auto cs = nearest_index.get_nearby(batch_samples[s], nk);
                 if ( cs.size() == 0 ) {
                     continue ;
                 }
-                MAT::Tree subt = filter_master(T, cs, false);
+                std::vector<MAT::Node*> cs_nodes;
+                cs_nodes.reserve(cs.size());
+                for (const auto& sample: cs) {
+                    cs_nodes.push_back(T.get_node(sample));
+                }
+                MAT::Tree subt = MAT::get_subtree_dfs_indexed(T, cs_nodes);
                 //remove forward slashes from the string, replacing them with underscores, so that it works for file names
                 size_t pos = 0;
                 while ((pos = batch_samples[s].find("/")) != std::string::npos) {
@@ -703,14 +712,19 @@ usher_single_subtree_size == 0 && usher_minimum_subtrees_size == 0) {
         std::ofstream out(closest_relatives_filename);
 
         timer.Start();
-        std::vector<std::string> closest_relatives;
-
-        for (std::string sample : samples) {
-            std::pair<std::vector<std::string>, size_t> closest_relatives_pair = get_closest_samples(&T, sample, false, 0);
-            std::vector<std::string> closest_relatives = closest_relatives_pair.first;
-            size_t dist = closest_relatives_pair.second;
-            if (closest_relatives.size() > 0) {
-                closest_relatives = closest_relatives_pair.first;
+        Nearest_Sample_Index nearest_index(&T);
+        //queries are independent, so answer them in parallel and write the lines in the original order
+        std::vector<std::string> lines(samples.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, samples.size()),
+        [&](const tbb::blocked_range<size_t> r) {
+            for (auto sample_idx = r.begin(); sample_idx < r.end(); ++sample_idx) {
+                const std::string& sample = samples[sample_idx];
+                std::pair<std::vector<std::string>, size_t> closest_relatives_pair = nearest_index.get_closest_samples(sample, false, 0);
+                std::vector<std::string> closest_relatives = closest_relatives_pair.first;
+                size_t dist = closest_relatives_pair.second;
+                if (closest_relatives.size() == 0) {
+                    continue;
+                }
                 std::string s = "";
                 s += sample + '\t';
                 std::string lex_smallest_sample = closest_relatives[0];
@@ -729,6 +743,11 @@ usher_single_subtree_size == 0 && usher_minimum_subtrees_size == 0) {
                     s = s.substr(0, s.size() - 1);
                 }
                 s += '\t' + std::to_string(dist);
+                lines[sample_idx] = s;
+            }
+        });
+        for (const auto& s : lines) {
+            if (s != "") {
                 out << s << "\n";
             }
         }
@@ -737,16 +756,25 @@ usher_single_subtree_size == 0 && usher_minimum_subtrees_size == 0) {
     if (within_dist_filename != dir_prefix) {
         fprintf(stderr, "Computing per-sample relatives within %ld mutations...", distance_threshold);
         std::ofstream out(within_dist_filename);
-
-        for (std::string sample : samples) {
-            std::pair<std::vector<std::string>, size_t> relatives_pair = get_closest_samples(&T, sample, true, distance_threshold);
-            std::vector<std::string> relatives = relatives_pair.first;
-            std::string s = "";
-            s += sample + '\t';
-            for (std::string relative : relatives) {
-                s += relative + ',';
+        timer.Start();
+        Nearest_Sample_Index nearest_index(&T);
+        std::vector<std::string> lines(samples.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, samples.size()),
+        [&](const tbb::blocked_range<size_t> r) {
+            for (auto sample_idx = r.begin(); sample_idx < r.end(); ++sample_idx) {
+                const std::string& sample = samples[sample_idx];
+                std::pair<std::vector<std::string>, size_t> relatives_pair = nearest_index.get_closest_samples(sample, true, distance_threshold);
+                std::vector<std::string> relatives = relatives_pair.first;
+                std::string s = "";
+                s += sample + '\t';
+                for (std::string relative : relatives) {
+                    s += relative + ',';
+                }
+                s = s.substr(0, s.size() - 1);
+                lines[sample_idx] = s;
             }
-            s = s.substr(0, s.size() - 1);
+        });
+        for (const auto& s : lines) {
             out << s << "\n";
         }
         fprintf(stderr, "TSV of relatives within threshold written to %s in %ld msec.\n\n", within_dist_filename.c_str(), timer.Stop());
@@ -203,76 +203,136 @@ std::vector<std::string> sample_intersect (std::unordered_set<std::string> sampl
     return inter_samples;
 }
 
-std::vector<std::string> get_nearby (MAT::Tree* T, std::string sample_id, int number_to_get) {
+Nearest_Sample_Index::Nearest_Sample_Index(MAT::Tree* T): T(T) {
+    dfs = T->depth_first_expansion();
+    size_t node_count = dfs.size();
+    parent_idx.resize(node_count);
+    end_idx.resize(node_count);
+    branch_len.resize(node_count);
+    root_dist.resize(node_count);
+    leaf_prefix.resize(node_count + 1);
+    leaf_prefix[0] = 0;
+    for (size_t idx = 0; idx < node_count; idx++) {
+        auto node = dfs[idx];
+        end_idx[idx] = node->dfs_end_idx;
+        branch_len[idx] = node->mutations.size();
+        //parents always precede their children in dfs order
+        if (node->parent == NULL) {
+            parent_idx[idx] = node_count;
+            root_dist[idx] = 0;
+        } else {
+            parent_idx[idx] = node->parent->dfs_idx;
+            root_dist[idx] = root_dist[parent_idx[idx]] + branch_len[idx];
+        }
+        leaf_prefix[idx + 1] = leaf_prefix[idx] + (is_leaf(idx) ? 1 : 0);
+    }
+}
+
+size_t Nearest_Sample_Index::get_idx(const std::string& nid) const {
+    auto node = T->get_node(nid);
+    if (node == NULL || node->dfs_idx >= dfs.size() || dfs[node->dfs_idx] != node) {
+        return dfs.size();
+    }
+    return node->dfs_idx;
+}
+
+std::vector<std::string> Nearest_Sample_Index::get_nearby(const std::string& sample_id, int number_to_get) const {
     //get the nearest X neighbors to sample_id and return them as a vector
-    //the simple indexing method is not guaranteed to get the very closest neighbors when the query sample is out near the edge of a large clade
-    //unfortunately. so we have to brute force it.
-    MAT::Node* last_anc = T->get_node(sample_id);
+    //go up until the first ancestor with more than X leaves, take every leaf of the child subtree on the path,
+    //then fill up with the other leaves of that ancestor in order of distance to it, visited best first
     assert (number_to_get > 0);
-    if (last_anc == NULL) {
+    std::vector<std::string> leaves_to_keep;
+    size_t last_anc = get_idx(sample_id);
+    if (last_anc == dfs.size()) {
         fprintf(stderr, "ERROR: %s is not present in the tree!\n", sample_id.c_str() );
+        return leaves_to_keep;
     }
-    std::vector<std::string> leaves_to_keep;
-    for (auto anc: T->rsearch(sample_id, true)) {
-        int num_leaves = static_cast<int>(T->get_num_leaves(anc));
-        if (num_leaves <= number_to_get) {
-            last_anc = anc;
+    size_t target_size = static_cast<size_t>(number_to_get);
+    size_t anc = parent_idx[last_anc];
+    while (anc != dfs.size() && leaf_prefix[end_idx[anc]] - leaf_prefix[anc] <= target_size) {
+        last_anc = anc;
+        anc = parent_idx[anc];
+    }
+    for (size_t idx = last_anc; idx < end_idx[last_anc]; idx++) {
+        if (is_leaf(idx)) {
+            leaves_to_keep.emplace_back(dfs[idx]->identifier);
+        }
+    }
+    if (anc == dfs.size()) {
+        //the whole tree has no more than X leaves
+        return leaves_to_keep;
+    }
+    //distance to anc is root_dist minus a constant, ties are broken by dfs order
+    std::priority_queue<std::pair<size_t, size_t>, std::vector<std::pair<size_t, size_t>>, std::greater<std::pair<size_t, size_t>>> to_visit;
+    for (size_t child = anc + 1; child < end_idx[anc]; child = end_idx[child]) {
+        if (child != last_anc) {
+            to_visit.emplace(root_dist[child], child);
+        }
+    }
+    while (leaves_to_keep.size() < target_size && !to_visit.empty()) {
+        auto idx = to_visit.top().second;
+        to_visit.pop();
+        if (is_leaf(idx)) {
+            leaves_to_keep.emplace_back(dfs[idx]->identifier);
             continue;
         }
+        for (size_t child = idx + 1; child < end_idx[idx]; child = end_idx[child]) {
+            to_visit.emplace(root_dist[child], child);
+        }
+    }
+    return leaves_to_keep;
+}
 
-        if (num_leaves > number_to_get) {
-            struct NodeDist {
-                MAT::Node* node;
-                uint32_t num_mut;
-
-                NodeDist(MAT::Node* n, uint32_t d) {
-                    node = n;
-                    num_mut = d;
-                }
-
-                inline bool operator< (const NodeDist& n) const {
-                    return ((*this).num_mut < n.num_mut);
-                }
-            };
-
-            for (auto l: T->get_leaves(last_anc->identifier)) {
-                leaves_to_keep.emplace_back(l->identifier);
-            }
-
-            std::vector<NodeDist> node_distances;
-            for (auto l: T->get_leaves(anc->identifier)) {
-                if (T->is_ancestor(last_anc->identifier, l->identifier)) {
-                    continue;
-                }
-
-                uint32_t dist = 0;
-                for (auto a: T->rsearch(l->identifier, true)) {
-                    if (a == anc) {
-                        break;
-                    }
-                    dist += a->mutations.size();
-                }
-
-                node_distances.emplace_back(NodeDist(l, dist));
-            }
-
-            std::sort(node_distances.begin(), node_distances.end());
-            for (auto n: node_distances) {
-                if ((int)leaves_to_keep.size() == number_to_get) {
-                    break;
-                }
-                leaves_to_keep.emplace_back(n.node->identifier);
-            }
-        } else {
-            for (auto l: T->get_leaves(anc->identifier)) {
-                leaves_to_keep.emplace_back(l->identifier);
-            }
+std::pair<std::vector<std::string>, size_t> Nearest_Sample_Index::get_closest_samples(const std::string& nid, bool fixed_k, size_t k) const {
+    // Returns a pair with (1) a vector of closest nodes to a target and (2) the distance from the target node
+    // (or all samples within k mutations of the target, and 0, if fixed_k is set)
+    // Best first walk from the target, only going up from the target itself, and never back to where it came from
+    std::pair<std::vector<std::string>, size_t> closest_samples;
+    closest_samples.second = 0;
+    size_t target = get_idx(nid);
+    if (target == dfs.size()) {
+        fprintf(stderr, "WARNING: Node %s not found in tree\n", nid.c_str());
+        return closest_samples;
+    }
+    struct To_Visit {
+        size_t dist;
+        size_t idx;
+        size_t from;
+        bool operator>(const To_Visit& other) const {
+            return std::tie(dist, idx) > std::tie(other.dist, other.idx);
         }
-        if (static_cast<int>(leaves_to_keep.size()) >= number_to_get) {
+    };
+    std::priority_queue<To_Visit, std::vector<To_Visit>, std::greater<To_Visit>> to_visit;
+    if (parent_idx[target] != dfs.size()) {
+        to_visit.push(To_Visit{branch_len[target], parent_idx[target], target});
+    }
+    size_t max_dist = fixed_k ? k : std::numeric_limits<size_t>::max();
+    while (!to_visit.empty()) {
+        auto curr = to_visit.top();
+        to_visit.pop();
+        if (curr.dist > max_dist) {
             break;
         }
+        if (is_leaf(curr.idx)) {
+            closest_samples.first.push_back(dfs[curr.idx]->identifier);
+            if (!fixed_k) {
+                //everything still in the queue at the same distance is tied
+                max_dist = curr.dist;
+                closest_samples.second = curr.dist;
+            }
+            continue;
+        }
+        auto parent = parent_idx[curr.idx];
+        if (parent != dfs.size() && parent != curr.from) {
+            to_visit.push(To_Visit{curr.dist + branch_len[curr.idx], parent, curr.idx});
+        }
+        for (size_t child = curr.idx + 1; child < end_idx[curr.idx]; child = end_idx[child]) {
+            if (child != curr.from) {
+                to_visit.push(To_Visit{curr.dist + branch_len[child], child, curr.idx});
+            }
+        }
     }
-    return leaves_to_keep;
+    return closest_samples;
 }
 
 std::vector<std::string> get_short_steppers(MAT::Tree* T, std::vector<std::string> samples_to_check, int max_mutations) {
@@ -442,142 +502,3 @@ std::vector<std::string> get_mrca_samples(MAT::Tree* T, std::vector<std::string>
     std::vector<std::string> mrca_samples = T->get_leaves_ids(mrca);
     return mrca_samples;
 }
-
-void closest_samples_dfs(MAT::Node *node, MAT::Node *target, size_t path_length, size_t max_path_length, std::vector<std::pair<MAT::Node *, size_t>> &leaves, bool fixed_k) {
-
-    if (path_length > max_path_length) {
-        return;
-    }
-    for (auto child : node->children) {
-        if (child->is_leaf()) {
-            if (fixed_k && path_length + child->mutations.size() <= max_path_length) {
-
-                leaves.push_back(std::make_pair(child, path_length + child->mutations.size()));
-            } else if (!fixed_k) {
-                leaves.push_back(std::make_pair(child, path_length + child->mutations.size()));
-            }
-        } else {
-            closest_samples_dfs(child, target, path_length + child->mutations.size(), max_path_length, leaves, fixed_k);
-        }
-    }
-}
-
-std::pair<std::vector<std::string>, size_t> get_closest_samples(MAT::Tree* T, std::string nid, bool fixed_k, size_t k) {
-    // Returns a pair with (1) a vector of closest nodes to a target and (2) the distance from the target node
-    std::pair<std::vector<std::string>, size_t> closest_samples;
-
-    MAT::Node *target = T->get_node(nid);
-    MAT::Node *target_parent = target->parent;
-    MAT::Node *curr_target = T->get_node(nid);
-
-    if (!target) {
-        fprintf(stderr, "WARNING: Node %s not found in tree\n", nid.c_str());
-        return closest_samples;
-    }
-    MAT::Node *parent = target->parent;
-
-    size_t min_dist = std::numeric_limits<size_t>::max();
-    size_t dist_to_orig_parent = 0; // cumulative distance to the parent of the initial target
-
-
-    bool go_up = true;
-    while (go_up && parent) {
-        size_t parent_branch_length = parent->mutations.size() + dist_to_orig_parent;
-        // make a vector of siblings of the current target.
-        // for siblings that are internal nodes, add leaves in the descendant subtree
-        // as pseudo-children if they are close enough
-        std::vector<std::pair<MAT::Node *, size_t>> children_and_distances;
-        std::vector<std::pair<MAT::Node *, size_t>> children_and_distances_fixed_k;
-
-        size_t min_of_sibling_leaves = std::numeric_limits<size_t>::max();
-        //collect leaves
-        for (auto child : parent->children) {
-
-            if (child->is_leaf()) {
-
-                if (child->identifier == curr_target->identifier) {
-
-                    continue; // skip the target node
-                }
-                size_t child_branch_length = child->mutations.size();
-
-                if (child_branch_length < min_of_sibling_leaves) {
-
-                    min_of_sibling_leaves = child_branch_length;
-                }
-            }
-        }
-
-        for (auto child : parent->children) {
-            if (child->identifier == curr_target->identifier) {
-                continue; // skip the target node
-            }
-            if (child->identifier == target_parent->identifier) {
-                continue; // don't go back down path
-            }
-
-            size_t dist_so_far = dist_to_orig_parent + target->mutations.size() + child->mutations.size();
-            if (!child->is_leaf()) {
-                // for internal nodes, descend the tree, adding leaves as they are
-                // encountered, restricting path lengths to less than the minimum of
-                // the sibling leaves at the current level
-                if (fixed_k) {
-                    closest_samples_dfs(child, target, dist_so_far, k, children_and_distances_fixed_k, true);
-                } else {
-                    size_t max_path;
-                    if (min_of_sibling_leaves == std::numeric_limits<size_t>::max()) {
-                        max_path = min_of_sibling_leaves;
-                    } else {
-                        max_path = min_of_sibling_leaves + dist_so_far;
-                    }
-                    closest_samples_dfs(child, target, dist_so_far, max_path, children_and_distances, false);
-                }
-
-            } else { // leaf node
-                if(fixed_k && dist_so_far <= k) {
-                    children_and_distances_fixed_k.push_back(std::make_pair(child, dist_so_far));
-                } else if (!fixed_k) {
-                    children_and_distances.push_back(std::make_pair(child, dist_so_far));
-                }
-            }
-        }
-
-        if (fixed_k) {
-            if (parent_branch_length > k) {
-                go_up = false;
-            }
-            for (std::pair child_and_dist : children_and_distances_fixed_k) {
-                MAT::Node *child = child_and_dist.first;
-                size_t child_branch_length = child_and_dist.second;
-                closest_samples.first.push_back(child->identifier);
-                closest_samples.second = 0;
-            }
-
-        } else {
-            for (std::pair child_and_dist : children_and_distances) {
-                // for the siblings of the target node, if any branch lengths
-                // are shorter than the path up a level, we can stop
-                MAT::Node *child = child_and_dist.first;
-                size_t child_branch_length = child_and_dist.second;
-                if (child_branch_length < parent_branch_length) {
-                    go_up = false;
-                }
-                if (child_branch_length < min_dist) {
-                    min_dist = child_branch_length;
-                    closest_samples.first.clear();
-                    closest_samples.first.push_back(child->identifier);
-                    closest_samples.second = min_dist;
-
-                } else if (child_branch_length == min_dist) {
-                    closest_samples.first.push_back(child->identifier);
-                }
-            }
-        }
-
-        curr_target = parent;
-        parent = curr_target->parent;
-        dist_to_orig_parent = parent_branch_length;
-
-    }
-    return closest_samples;
-}
@@ -1,17 +1,37 @@
 #include "common.hpp"
 #include <regex>
 
+//Flattened depth-first view of a tree, built once and shared by many nearest sample queries.
+//dfs_idx of the tree must not be changed while it is in use.
+//Stores root distances (in mutations) and DFS intervals, so each query only walks the part of the tree it needs.
+class Nearest_Sample_Index {
+    MAT::Tree* T;
+    std::vector<MAT::Node*> dfs;
+    std::vector<size_t> parent_idx;
+    std::vector<size_t> end_idx;
+    std::vector<size_t> branch_len;
+    std::vector<size_t> root_dist;
+    //number of leaves before each position in dfs order
+    std::vector<size_t> leaf_prefix;
+    bool is_leaf(size_t idx) const {
+        return end_idx[idx] == idx + 1;
+    }
+    size_t get_idx(const std::string& nid) const;
+  public:
+    Nearest_Sample_Index(MAT::Tree* T);
+    std::vector<std::string> get_nearby(const std::string& sample_id, int number_to_get) const;
+    std::pair<std::vector<std::string>, size_t> get_closest_samples(const std::string& nid, bool fixed_k, size_t k) const;
+};
+
 std::vector<std::string> read_sample_names (std::string sample_filename);
 std::vector<std::string> get_clade_samples (MAT::Tree* T, std::string clade_name);
 std::vector<std::string> get_mutation_samples (MAT::Tree* T, std::string mutation_id);
 std::vector<std::string> get_parsimony_samples (MAT::Tree* T, std::vector<std::string> samples_to_check, int max_parsimony);
 std::vector<std::string> get_clade_representatives(MAT::Tree* T, size_t samples_per_clade);
 std::vector<std::string> sample_intersect (std::unordered_set<std::string> samples, std::vector<std::string> nsamples);
-std::vector<std::string> get_nearby (MAT::Tree* T, std::string sample_id, int number_to_get);
 std::vector<std::string> get_short_steppers(MAT::Tree* T, std::vector<std::string> samples_to_check, int max_mutations);
 std::vector<std::string> get_short_paths(MAT::Tree* T, std::vector<std::string> samples_to_check, int max_path);
 std::unordered_map<std::string,std::unordered_map<std::string,std::string>> read_metafile(std::string metainf, std::set<std::string> samples_to_use);
 std::vector<std::string> get_sample_match(MAT::Tree* T, std::vector<std::string> samples_to_check, std::string substring);
 std::vector<std::string> fill_random_samples(MAT::Tree* T, std::vector<std::string> current_samples, size_t target_size, bool lca_limit = false);
 std::vector<std::string> get_mrca_samples(MAT::Tree* T, std::vector<std::string> current_samples);
-std::pair<std::vector<std::string>, size_t> get_closest_samples(MAT::Tree* T, std::string nid, bool fixed_k, size_t k);
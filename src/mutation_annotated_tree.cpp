@@ -13,9 +13,40 @@
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include "usher_graph.hpp"
+#include "newick_topology.hpp"
 #include <signal.h>
+#include <mutex>
 // Uses one-hot encoding if base is unambiguous
 // A:1,C:2,G:4,T:8
+tbb::concurrent_unordered_map<std::string, uint8_t> Mutation_Annotated_Tree::Mutation::chromosome_map;
+std::string Mutation_Annotated_Tree::Mutation::chromosomes[Mutation_Annotated_Tree::Mutation::max_chromosomes];
+static std::mutex chromosome_lock;
+static size_t num_chromosomes = 1;
+
+// Names are written to the table before they are published in the map, so
+// get_chromosome never needs the lock
+void Mutation_Annotated_Tree::Mutation::set_chromosome (const std::string& chromosome) {
+    if (chromosome.empty()) {
+        chrom_idx = 0;
+        return;
+    }
+    auto iter = chromosome_map.find(chromosome);
+    if (iter == chromosome_map.end()) {
+        std::lock_guard<std::mutex> lk(chromosome_lock);
+        iter = chromosome_map.find(chromosome);
+        if (iter == chromosome_map.end()) {
+            if (num_chromosomes == max_chromosomes) {
+                fprintf(stderr, "ERROR: more than %zu chromosomes are not supported.\n", max_chromosomes-1);
+                exit(1);
+            }
+            chromosomes[num_chromosomes] = chromosome;
+            iter = chromosome_map.emplace(chromosome, static_cast<uint8_t>(num_chromosomes)).first;
+            num_chromosomes++;
+        }
+    }
+    chrom_idx = iter->second;
+}
+
 int8_t Mutation_Annotated_Tree::get_nuc_id (char nuc) {
     int8_t ret = 0b1111;
     switch(nuc) {
@@ -416,90 +447,39 @@ Mutation_Annotated_Tree::Tree Mutation_Annotated_Tree::create_tree_from_newick_s
     TIMEIT();
     Tree T;
 
-    std::vector<std::string> leaves;
-    std::vector<size_t> num_open;
-    std::vector<size_t> num_close;
-    std::vector<std::queue<float>> branch_len (128);  // will be resized later if needed
-    size_t level = 0;
-
-    std::vector<std::string> s1;
-    string_split(newick_string, ',', s1);
-
-    num_open.reserve(s1.size());
-    num_close.reserve(s1.size());
-
-    for (auto s: s1) {
-        size_t no = 0;
-        size_t nc = 0;
-        bool stop = false;
-        bool branch_start = false;
-        std::string leaf = "";
-        std::string branch = "";
-        for (auto c: s) {
-            if (c == ':') {
-                stop = true;
-                branch = "";
-                branch_start = true;
-            } else if (c == '(') {
-                no++;
-                level++;
-                if (branch_len.size() <= level) {
-                    branch_len.resize(level*2);
-                }
-            } else if (c == ')') {
-                stop = true;
-                nc++;
-                float len = (branch.size() > 0) ? std::stof(branch) : -1.0;
-                branch_len[level].push(len);
-                level--;
-                branch_start = false;
-            } else if (!stop) {
-                leaf += c;
-                branch_start = false;
-            } else if (branch_start) {
-                if (isdigit(c)  || c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+') {
-                    branch += c;
-                }
-            }
-        }
-        leaves.push_back(std::move(leaf));
-        num_open.push_back(no);
-        num_close.push_back(nc);
-        float len = (branch.size() > 0) ? std::stof(branch) : -1.0;
-        branch_len[level].push(len);
-    }
-
-    if (level != 0) {
-        fprintf(stderr, "ERROR: incorrect Newick format!\n");
-        exit(1);
-    }
+    Newick_Topology topo;
+    parse_newick_topology(newick_string, topo);
 
-    std::stack<Node*> parent_stack;
-
-    for (size_t i=0; i<leaves.size(); i++) {
-        auto leaf = leaves[i];
-        auto no = num_open[i];
-        auto nc = num_close[i];
-        for (size_t j=0; j<no; j++) {
-            std::string nid = T.new_internal_node_id();
-            Node* new_node = NULL;
-            if (parent_stack.size() == 0) {
-                new_node = T.create_node(nid, branch_len[level].front());
+    // Nodes are allocated and filled in parallel, then linked in preorder so
+    // that children keep their order in the newick string
+    size_t num_nodes = topo.parent.size();
+    std::vector<Node*> nodes(num_nodes);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_nodes),
+    [&](tbb::blocked_range<size_t> r) {
+        for (size_t k=r.begin(); k<r.end(); ++k) {
+            Node* n = new Node();
+            if (topo.internal_id[k] > 0) {
+                n->identifier = "node_" + std::to_string(topo.internal_id[k]);
             } else {
-                new_node = T.create_node(nid, parent_stack.top(), branch_len[level].front());
+                n->identifier.assign(newick_string, topo.name_begin[k], topo.name_end[k]-topo.name_begin[k]);
             }
-            branch_len[level].pop();
-            level++;
-            parent_stack.push(new_node);
-        }
-        T.create_node(leaf, parent_stack.top(), branch_len[level].front());
-        branch_len[level].pop();
-        for (size_t j=0; j<nc; j++) {
-            parent_stack.pop();
-            level--;
+            n->branch_length = topo.branch_len[k];
+            n->level = topo.depth[k] + 1;
+            n->children.reserve(topo.num_children[k]);
+            nodes[k] = n;
         }
+    });
+    for (size_t k=1; k<num_nodes; k++) {
+        auto par = nodes[topo.parent[k]];
+        nodes[k]->parent = par;
+        par->children.push_back(nodes[k]);
     }
 
+    T.register_nodes(nodes);
+    T.curr_internal_node = std::count_if(topo.internal_id.begin(), topo.internal_id.end(), [](size_t id) {
+        return id > 0;
+    });
+
     if (T.root == NULL) {
         fprintf(stderr, "WARNING: Tree found empty!\n");
     }
@@ -566,7 +546,7 @@ Mutation_Annotated_Tree::Tree Mutation_Annotated_Tree::load_mutation_annotated_t
             for (int k = 0; k < mutation_list.mutation_size(); k++) {
                 auto mut = mutation_list.mutation(k);
                 Mutation m;
-                m.chrom = mut.chromosome();
+                m.set_chromosome(mut.chromosome());
                 m.position = mut.position();
                 if (!m.is_masked()) {
                     m.ref_nuc = (1 << mut.ref_nuc());
@@ -626,7 +606,7 @@ void Mutation_Annotated_Tree::save_mutation_annotated_tree (Mutation_Annotated_T
         auto mutation_list = data.add_node_mutations();
         for (auto m: dfs[idx]->mutations) {
             auto mut = mutation_list->add_mutation();
-            mut->set_chromosome(m.chrom);
+            mut->set_chromosome(m.get_chromosome());
             mut->set_position(m.position);
 
             if (m.is_masked()) {
@@ -882,6 +862,41 @@ Mutation_Annotated_Tree::Node* Mutation_Annotated_Tree::Tree::create_node (std::
     return create_node(identifier, par, branch_len);
 }
 
+// Registers nodes that are already linked to each other, with nodes[0] as the
+// root of the tree
+void Mutation_Annotated_Tree::Tree::register_nodes (const std::vector<Node*>& nodes) {
+    all_nodes.clear();
+    root = NULL;
+    if (nodes.empty()) {
+        return;
+    }
+    all_nodes.reserve(nodes.size());
+    for (auto n: nodes) {
+        if (!all_nodes.emplace(n->identifier, n).second) {
+            fprintf(stderr, "Error: %s already in the tree!\n", n->identifier.c_str());
+            exit(1);
+        }
+    }
+    root = nodes[0];
+}
+
+// Removes a node from the identifier index without unlinking or freeing it.
+// The returned entry adds it back, linked to the same parent, without
+// allocating a new one
+Mutation_Annotated_Tree::Tree::Node_Entry Mutation_Annotated_Tree::Tree::unregister_node (Node* node) {
+    auto it = all_nodes.find(node->identifier);
+    assert ((it != all_nodes.end()) && (it->second == node));
+    return all_nodes.extract(it);
+}
+
+void Mutation_Annotated_Tree::Tree::register_node (Node_Entry&& entry) {
+    auto res = all_nodes.insert(std::move(entry));
+    if (!res.inserted) {
+        fprintf(stderr, "Error: %s already in the tree!\n", res.node.key().c_str());
+        exit(1);
+    }
+}
+
 Mutation_Annotated_Tree::Node* Mutation_Annotated_Tree::Tree::get_node (std::string nid) const {
     if (all_nodes.find(nid) != all_nodes.end()) {
         return all_nodes.at(nid);
@@ -1180,44 +1195,61 @@ void Mutation_Annotated_Tree::Tree::condense_leaves(std::vector<std::string> mis
         uncondense_leaves();
     }
 
-    auto tree_leaves = get_leaves_ids();
-    for (auto l1_id: tree_leaves) {
-        std::vector<Node*> polytomy_nodes;
+    std::unordered_set<std::string> missing_samples_set(missing_samples.begin(), missing_samples.end());
 
-        auto l1 = get_node(l1_id);
-        if (l1 == NULL) {
-            continue;
-        }
-        if (std::find(missing_samples.begin(), missing_samples.end(), l1->identifier) != missing_samples.end()) {
-            continue;
+    // Leaves without mutations under the same parent are condensed into a
+    // single node, appended after the remaining children. Parents are visited
+    // in BFS order, which numbers the condensed nodes as a sweep over leaves
+    // in BFS order would. Each parent only rewrites its own children, so the
+    // groups are found in parallel.
+    std::vector<Node*> parents;
+    for (auto n: breadth_first_expansion()) {
+        if (!n->is_leaf()) {
+            parents.push_back(n);
         }
-        if (l1->mutations.size() > 0) {
-            continue;
-        }
-
-        for (auto l2: l1->parent->children) {
-            if (std::find(missing_samples.begin(), missing_samples.end(), l2->identifier) != missing_samples.end()) {
+    }
+    std::vector<std::vector<Node*>> polytomy_nodes(parents.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, parents.size()),
+    [&](tbb::blocked_range<size_t> r) {
+        for (size_t k=r.begin(); k<r.end(); ++k) {
+            for (auto c: parents[k]->children) {
+                if (c->is_leaf() && (c->mutations.size() == 0) &&
+                        (missing_samples_set.find(c->identifier) == missing_samples_set.end())) {
+                    polytomy_nodes[k].push_back(c);
+                }
+            }
+            if (polytomy_nodes[k].size() < 2) {
+                polytomy_nodes[k].clear();
                 continue;
             }
-            if (l2->is_leaf() && (get_node(l2->identifier) != NULL) && (l2->mutations.size() == 0)) {
-                polytomy_nodes.push_back(l2);
+            auto& children = parents[k]->children;
+            size_t num_kept = 0;
+            size_t next_condensed = 0;
+            for (auto c: children) {
+                if ((next_condensed < polytomy_nodes[k].size()) && (c == polytomy_nodes[k][next_condensed])) {
+                    next_condensed++;
+                } else {
+                    children[num_kept++] = c;
+                }
             }
+            children.resize(num_kept);
         }
-        if (polytomy_nodes.size() > 1) {
-            std::string new_node_name = "node_" + std::to_string(1+condensed_nodes.size()) + "_condensed_" + std::to_string(polytomy_nodes.size()) + "_leaves";
+    });
 
-            auto curr_node = get_node(l1->identifier);
-            auto new_node = create_node(new_node_name, curr_node->parent, l1->branch_length);
-
-            new_node->clear_mutations();
-
-            condensed_nodes[new_node_name] = std::vector<std::string>(polytomy_nodes.size());
+    for (size_t k=0; k<parents.size(); k++) {
+        if (polytomy_nodes[k].empty()) {
+            continue;
+        }
+        std::string new_node_name = "node_" + std::to_string(1+condensed_nodes.size()) + "_condensed_" + std::to_string(polytomy_nodes[k].size()) + "_leaves";
+        create_node(new_node_name, parents[k], polytomy_nodes[k][0]->branch_length);
 
-            for (size_t it = 0; it < polytomy_nodes.size(); it++) {
-                condensed_nodes[new_node_name][it] = polytomy_nodes[it]->identifier;
-                remove_node(polytomy_nodes[it]->identifier, false);
-            }
+        std::vector<std::string> condensed_ids(polytomy_nodes[k].size());
+        for (size_t it = 0; it < polytomy_nodes[k].size(); it++) {
+            condensed_ids[it] = polytomy_nodes[k][it]->identifier;
+            all_nodes.erase(condensed_ids[it]);
+            delete polytomy_nodes[k][it];
         }
+        condensed_nodes[new_node_name] = std::move(condensed_ids);
     }
 }
 
@@ -1370,53 +1402,41 @@ Mutation_Annotated_Tree::Tree Mutation_Annotated_Tree::get_tree_copy(const Mutat
         root = tree.get_node(identifier);
     }
 
-    Tree copy = create_tree_from_newick_string (get_newick_string(tree, root, true, true));
+    Tree copy;
+    if (root == NULL) {
+        return copy;
+    }
 
-    std::vector<Node*> dfs1;
-    std::vector<Node*> dfs2;
+    // Clone the structure directly over the DFS order of the source: the
+    // parent of every node precedes it and is found through its dfs_idx, so
+    // node identifiers and branch lengths are kept as they are
+    auto dfs1 = tree.depth_first_expansion(root);
+    std::vector<Node*> dfs2(dfs1.size());
+    dfs2[0] = copy.create_node(root->identifier, root->branch_length);
+    for (size_t k=1; k<dfs1.size(); ++k) {
+        auto n1 = dfs1[k];
+        dfs2[k] = copy.create_node(n1->identifier, dfs2[n1->parent->dfs_idx], n1->branch_length);
+    }
+    copy.curr_internal_node = tree.curr_internal_node;
 
     static tbb::affinity_partitioner ap;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, 2),
-    [&](tbb::blocked_range<size_t> r) {
-        for (size_t k=r.begin(); k<r.end(); ++k) {
-            if (k==0) {
-                dfs1 = tree.depth_first_expansion(root);
-            } else {
-                dfs2 = copy.depth_first_expansion();
-            }
-        }
-    }, ap);
-
-
     tbb::parallel_for(tbb::blocked_range<size_t>(0, dfs1.size()),
     [&](tbb::blocked_range<size_t> r) {
         for (size_t k=r.begin(); k<r.end(); ++k) {
             auto n1 = dfs1[k];
             auto n2 = dfs2[k];
-            n2->clade_annotations.resize(n1->clade_annotations.size());
-            for (size_t i=0; i<n1->clade_annotations.size(); i++) {
-                n2->clade_annotations[i] = n1->clade_annotations[i];
-            }
-            for (auto m: n1->mutations) {
-                Mutation m2 = m.copy();
-                n2->add_mutation(m2);
-            }
+            n2->clade_annotations = n1->clade_annotations;
+            // mutations of the source are already merged by position
+            n2->mutations = n1->mutations;
         }
     }, ap);
 
-    size_t num_condensed_nodes = static_cast<size_t>(tree.condensed_nodes.size());
-    tbb::parallel_for( tbb::blocked_range<size_t>(0, num_condensed_nodes),
-    [&](tbb::blocked_range<size_t> r) {
-        for (size_t idx = r.begin(); idx < r.end(); idx++) {
-            auto cn = tree.condensed_nodes.begin();
-            std::advance(cn, idx);
-            copy.condensed_nodes.insert(std::pair<std::string, std::vector<std::string>>(cn->first, std::vector<std::string>(cn->second.size())));
-            for (size_t k = 0; k < cn->second.size(); k++) {
-                copy.condensed_nodes[cn->first][k] = cn->second[k];
-                copy.condensed_leaves.insert(cn->second[k]);
-            }
+    for (const auto& cn: tree.condensed_nodes) {
+        copy.condensed_nodes.insert(cn);
+        for (const auto& l: cn.second) {
+            copy.condensed_leaves.insert(l);
         }
-    }, ap);
+    }
 
     return copy;
 }
@@ -1446,115 +1466,173 @@ Mutation_Annotated_Tree::Node* Mutation_Annotated_Tree::LCA (const Mutation_Anno
 // Extract the subtree consisting of the specified set of samples. This routine
 // maintains the internal node names of the input tree. Mutations are copied
 // from the tree such that the path of mutations from root to the sample is
-// same as the original tree.
-Mutation_Annotated_Tree::Tree Mutation_Annotated_Tree::get_subtree (const Mutation_Annotated_Tree::Tree& tree, const std::vector<std::string>& samples, bool keep_clade_annotations) {
-    TIMEIT();
+// same as the original tree. Nodes of the subtree are the samples and the LCAs
+// of samples adjacent in DFS order, which are all the pairwise LCAs.
+// dfs_range(node) returns the [start, end) interval of node in a DFS order of tree.
+template <typename dfs_range_t>
+static Mutation_Annotated_Tree::Tree build_subtree (const Mutation_Annotated_Tree::Tree& tree, const std::vector<Mutation_Annotated_Tree::Node*>& samples, bool keep_clade_annotations, const dfs_range_t& dfs_range) {
+    using namespace Mutation_Annotated_Tree;
     Tree subtree;
-
-    // Set of leaf and internal nodes corresponding to the subtree
-    tbb::concurrent_unordered_set<Node*> subtree_nodes;
-    // Maintain a set of all ancestors of a sample for each sample
-    std::vector<tbb::concurrent_unordered_set<Node*>> all_ancestors(samples.size());
-
-    static tbb::affinity_partitioner ap;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, samples.size()),
-    [&](tbb::blocked_range<size_t> r) {
-        for (size_t k=r.begin(); k<r.end(); ++k) {
-            subtree_nodes.insert(tree.get_node(samples[k]));
-            for (auto anc: tree.rsearch(samples[k], true)) {
-                all_ancestors[k].insert(anc);
-            }
+    std::vector<Node*> subtree_nodes;
+    subtree_nodes.reserve(2*samples.size());
+    for (auto n: samples) {
+        if (n != NULL) {
+            subtree_nodes.push_back(n);
         }
-    }, ap);
-
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, samples.size()),
-    [&](tbb::blocked_range<size_t> r) {
-        for (size_t i=r.begin(); i<r.end(); ++i) {
-            for (size_t j=i+1; j<samples.size(); ++j) {
-                for (auto anc: tree.rsearch(samples[i], true)) {
-                    if (all_ancestors[j].find(anc) != all_ancestors[j].end()) {
-                        subtree_nodes.insert(anc);
-                        break;
-                    }
-                }
-            }
+    }
+    auto dfs_order = [&dfs_range](const Node* n1, const Node* n2) {
+        return dfs_range(n1).first < dfs_range(n2).first;
+    };
+    auto is_dfs_ancestor = [&dfs_range](const Node* anc, const Node* node) {
+        auto anc_range = dfs_range(anc);
+        auto node_start = dfs_range(node).first;
+        return (anc_range.first <= node_start) && (node_start < anc_range.second);
+    };
+    std::sort(subtree_nodes.begin(), subtree_nodes.end(), dfs_order);
+    subtree_nodes.erase(std::unique(subtree_nodes.begin(), subtree_nodes.end()), subtree_nodes.end());
+    size_t num_samples = subtree_nodes.size();
+    for (size_t i = 1; i < num_samples; i++) {
+        auto lca = subtree_nodes[i-1];
+        while (!is_dfs_ancestor(lca, subtree_nodes[i])) {
+            lca = lca->parent;
         }
-    }, ap);
+        subtree_nodes.push_back(lca);
+    }
+    std::sort(subtree_nodes.begin(), subtree_nodes.end(), dfs_order);
+    subtree_nodes.erase(std::unique(subtree_nodes.begin(), subtree_nodes.end()), subtree_nodes.end());
 
-    auto dfs = tree.depth_first_expansion();
     size_t num_annotations = 0;
     if (keep_clade_annotations) {
         num_annotations = tree.get_num_annotations();
     }
 
-    std::stack<Node*> last_subtree_node;
-    for (auto n: dfs) {
-        // If the node is in subtree_nodes, it should be added to the subtree
-        if (subtree_nodes.find(n) != subtree_nodes.end()) {
-            Node* subtree_parent = NULL;
-            if (last_subtree_node.size() > 0) {
-                while (!tree.is_ancestor(last_subtree_node.top()->identifier, n->identifier)) {
-                    last_subtree_node.pop();
+    // subtree nodes that are ancestors of the current node, and their copy in subtree
+    std::vector<std::pair<Node*, Node*>> last_subtree_node;
+    std::vector<Node*> par_to_node;
+    for (auto n: subtree_nodes) {
+        while ((last_subtree_node.size() > 0) && (!is_dfs_ancestor(last_subtree_node.back().first, n))) {
+            last_subtree_node.pop_back();
+        }
+        // path from just below the parent in the subtree (or from the root) to the node
+        par_to_node.clear();
+        Node* subtree_parent = (last_subtree_node.size() > 0) ? last_subtree_node.back().first : NULL;
+        for (auto curr = n; curr != subtree_parent; curr = curr->parent) {
+            par_to_node.push_back(curr);
+        }
+        std::reverse(par_to_node.begin(), par_to_node.end());
+        Node* new_node;
+        // Add as root of the subtree
+        if (subtree_parent == NULL) {
+            // for root node, need to size the annotations vector
+            new_node = subtree.create_node(n->identifier, -1.0, num_annotations);
+            // but watch out for nodes that have fewer than expected annotations
+            size_t node_num_annotations = num_annotations;
+            if (node_num_annotations > n->clade_annotations.size()) {
+                node_num_annotations = n->clade_annotations.size();
+            }
+            // need to assign any clade annotations which would belong to that root as well
+            for (size_t k = 0; k < node_num_annotations; k++) {
+                if (n->clade_annotations[k] != "") {
+                    new_node->clade_annotations[k] = n->clade_annotations[k];
                 }
-                subtree_parent = last_subtree_node.top();
             }
-            // Add as root of the subtree
-            if (subtree_parent == NULL) {
-                // for root node, need to size the annotations vector
-                Node* new_node = subtree.create_node(n->identifier, -1.0, num_annotations);
-                // but watch out for nodes that have fewer than expected annotations
+        }
+        // Add to the parent identified
+        else {
+            new_node = subtree.create_node(n->identifier, last_subtree_node.back().second, num_annotations);
+            for (auto curr: par_to_node) {
+                // watch out for nodes that have fewer than expected annotations
                 size_t node_num_annotations = num_annotations;
-                if (node_num_annotations > n->clade_annotations.size()) {
-                    node_num_annotations = n->clade_annotations.size();
+                if (node_num_annotations > curr->clade_annotations.size()) {
+                    node_num_annotations = curr->clade_annotations.size();
                 }
-                // need to assign any clade annotations which would belong to that root as well
                 for (size_t k = 0; k < node_num_annotations; k++) {
-                    if (n->clade_annotations[k] != "") {
-                        new_node->clade_annotations[k] = n->clade_annotations[k];
-                    }
-                }
-                std::vector<Node*> root_to_node = tree.rsearch(n->identifier, true);
-                std::reverse(root_to_node.begin(), root_to_node.end());
-                //root_to_node.emplace_back(n);
-
-                for (auto curr: root_to_node) {
-                    for (auto m: curr->mutations) {
-                        new_node->add_mutation(m);
+                    if (curr->clade_annotations[k] != "") {
+                        new_node->clade_annotations[k] = curr->clade_annotations[k];
                     }
                 }
             }
-            // Add to the parent identified
-            else {
-                Node* new_node = subtree.create_node(n->identifier, subtree_parent->identifier, num_annotations);
+        }
+        for (auto curr: par_to_node) {
+            for (auto m: curr->mutations) {
+                new_node->add_mutation(m);
+            }
+        }
+        last_subtree_node.emplace_back(n, new_node);
+    }
 
-                auto par_to_node = tree.rsearch(n->identifier, true);
-                std::reverse(par_to_node.begin(), par_to_node.end());
-                par_to_node.erase(par_to_node.begin(), std::find(par_to_node.begin(), par_to_node.end(), subtree_parent)+1);
+    subtree.curr_internal_node = tree.curr_internal_node;
 
+    return subtree;
+}
 
-                for (auto curr: par_to_node) {
-                    // watch out for nodes that have fewer than expected annotations
-                    size_t node_num_annotations = num_annotations;
-                    if (node_num_annotations > curr->clade_annotations.size()) {
-                        node_num_annotations = curr->clade_annotations.size();
-                    }
-                    for (size_t k = 0; k < node_num_annotations; k++) {
-                        if (curr->clade_annotations[k] != "") {
-                            new_node->clade_annotations[k] = curr->clade_annotations[k];
+// Same as get_subtree_dfs_indexed, but only the ancestors of the samples are indexed,
+// locally instead of with depth_first_expansion, so dfs_idx of a tree shared with
+// other threads is not rewritten. The local index keeps the DFS order and ancestry of
+// those nodes, which is all build_subtree compares.
+Mutation_Annotated_Tree::Tree Mutation_Annotated_Tree::get_subtree (const Mutation_Annotated_Tree::Tree& tree, const std::vector<std::string>& samples, bool keep_clade_annotations) {
+    TIMEIT();
+    std::vector<Node*> sample_nodes;
+    sample_nodes.reserve(samples.size());
+    for (const auto& s: samples) {
+        sample_nodes.push_back(tree.get_node(s));
+    }
+    // Ancestors of the samples, with their children that are also ancestors
+    std::unordered_map<const Node*, std::pair<size_t, size_t>> dfs_ranges;
+    std::unordered_map<const Node*, std::vector<const Node*>> kept_children;
+    for (auto s: sample_nodes) {
+        const Node* child = NULL;
+        for (const Node* n = s; n != NULL; n = n->parent) {
+            if (child != NULL) {
+                kept_children[n].push_back(child);
+            }
+            if (!dfs_ranges.emplace(n, std::make_pair(0, 0)).second) {
+                break;
+            }
+            child = n;
+        }
+    }
+    if (dfs_ranges.size() > 0) {
+        size_t dfs_idx = 0;
+        std::vector<std::pair<const Node*, size_t>> stack;
+        stack.emplace_back(tree.root, 0);
+        dfs_ranges[tree.root].first = dfs_idx++;
+        while (stack.size() > 0) {
+            auto node = stack.back().first;
+            auto next_child = stack.back().second;
+            auto kept = kept_children.find(node);
+            if ((kept != kept_children.end()) && (next_child < kept->second.size())) {
+                // Visit kept children in the order of the tree
+                if ((next_child == 0) && (kept->second.size() > 1)) {
+                    kept->second.clear();
+                    for (auto c: node->children) {
+                        if (dfs_ranges.find(c) != dfs_ranges.end()) {
+                            kept->second.push_back(c);
                         }
                     }
-                    for (auto m: curr->mutations) {
-                        new_node->add_mutation(m);
-                    }
                 }
+                stack.back().second++;
+                auto child = kept->second[next_child];
+                dfs_ranges[child].first = dfs_idx++;
+                stack.emplace_back(child, 0);
+            } else {
+                dfs_ranges[node].second = dfs_idx;
+                stack.pop_back();
             }
-            last_subtree_node.push(n);
         }
     }
+    return build_subtree(tree, sample_nodes, keep_clade_annotations, [&dfs_ranges](const Node* n) {
+        return dfs_ranges.at(n);
+    });
+}
 
-    subtree.curr_internal_node = tree.curr_internal_node;
-
-    return subtree;
+// Same as get_subtree, but dfs_idx and dfs_end_idx of the tree need to be set by
+// depth_first_expansion beforehand. The tree is only read, so many subtrees can be
+// extracted concurrently from the same tree.
+Mutation_Annotated_Tree::Tree Mutation_Annotated_Tree::get_subtree_dfs_indexed (const Mutation_Annotated_Tree::Tree& tree, const std::vector<Node*>& samples, bool keep_clade_annotations) {
+    return build_subtree(tree, samples, keep_clade_annotations, [](const Node* n) {
+        return std::make_pair(n->dfs_idx, n->dfs_end_idx);
+    });
 }
 
 void Mutation_Annotated_Tree::clear_tree(Mutation_Annotated_Tree::Tree& T) {
@@ -1693,7 +1771,25 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
         }
     }
 
-    int num_subtrees = 0;
+    // Index the tree once: leaves and subtrees are contiguous ranges of the
+    // DFS order, so subtree sizes and leaf lists are read off without
+    // traversals while choosing the subtrees
+    auto dfs = T->depth_first_expansion();
+    std::vector<size_t> leaf_prefix(dfs.size()+1, 0);
+    for (size_t k = 0; k < dfs.size(); k++) {
+        leaf_prefix[k+1] = leaf_prefix[k] + (dfs[k]->is_leaf() ? 1 : 0);
+    }
+    auto num_leaves_below = [&](const Node* n) {
+        return leaf_prefix[n->dfs_end_idx] - leaf_prefix[n->dfs_idx];
+    };
+    std::unordered_map<std::string, size_t> sample_idx;
+    for (size_t k = 0; k < samples.size(); k++) {
+        sample_idx.emplace(samples[k], k);
+    }
+
+    // First choose the samples of every subtree, which is inherently serial
+    // since each subtree can cover later samples
+    std::vector<std::vector<Node*>> subtree_leaves;
     for (size_t i = 0; i < samples.size(); i++) {
 
         if (displayed_samples[i]) {
@@ -1701,12 +1797,12 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
         }
 
         Mutation_Annotated_Tree::Node* last_anc = T->get_node(samples[i]);
-        std::vector<std::string> leaves_to_keep;
+        std::vector<Node*> leaves_to_keep;
 
         // Keep moving up the tree till a subtree of required size is
         // found
         for (auto anc: T->rsearch(samples[i], true)) {
-            size_t num_leaves = T->get_num_leaves(anc);
+            size_t num_leaves = num_leaves_below(anc);
             if (num_leaves < subtree_size) {
                 last_anc = anc;
                 continue;
@@ -1727,33 +1823,36 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
                     }
                 };
 
-                for (auto l: T->get_leaves(last_anc->identifier)) {
-                    leaves_to_keep.emplace_back(l->identifier);
+                for (size_t k = last_anc->dfs_idx; k < last_anc->dfs_end_idx; k++) {
+                    if (dfs[k]->is_leaf()) {
+                        leaves_to_keep.emplace_back(dfs[k]);
+                    }
                 }
 
                 std::vector<NodeDist> node_distances;
-                for (auto l: T->get_leaves(anc->identifier)) {
-                    if (T->is_ancestor(last_anc->identifier, l->identifier)) {
+                for (size_t k = anc->dfs_idx; k < anc->dfs_end_idx; k++) {
+                    auto l = dfs[k];
+                    if (!l->is_leaf()) {
+                        continue;
+                    }
+                    if ((k >= last_anc->dfs_idx) && (k < last_anc->dfs_end_idx)) {
                         continue;
                     }
 
                     uint32_t dist = 0;
-                    for (auto a: T->rsearch(l->identifier, true)) {
-                        if (a == anc) {
-                            break;
-                        }
+                    for (auto a = l; a != anc; a = a->parent) {
                         dist += a->mutations.size();
                     }
 
                     node_distances.emplace_back(NodeDist(l, dist));
                 }
 
-                std::sort(node_distances.begin(), node_distances.end());
+                std::stable_sort(node_distances.begin(), node_distances.end());
                 for (auto n: node_distances) {
                     if (leaves_to_keep.size() >= nearest_subtree_size) {
                         break;
                     }
-                    leaves_to_keep.emplace_back(n.node->identifier);
+                    leaves_to_keep.emplace_back(n.node);
                 }
 
                 if ((nearest_subtree_size < subtree_size) && (nearest_subtree_size < node_distances.size())) {
@@ -1764,41 +1863,45 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
                         if (leaves_to_keep.size() == subtree_size) {
                             break;
                         }
-                        leaves_to_keep.emplace_back(n.node->identifier);
+                        leaves_to_keep.emplace_back(n.node);
                     }
                 }
             } else {
-                for (auto l: T->get_leaves(anc->identifier)) {
+                for (size_t k = anc->dfs_idx; k < anc->dfs_end_idx; k++) {
                     if (leaves_to_keep.size() == subtree_size) {
                         break;
                     }
-                    leaves_to_keep.emplace_back(l->identifier);
+                    if (dfs[k]->is_leaf()) {
+                        leaves_to_keep.emplace_back(dfs[k]);
+                    }
                 }
             }
 
-            auto new_T = Mutation_Annotated_Tree::get_subtree(*T, leaves_to_keep);
+            for (auto l: leaves_to_keep) {
+                auto iter = sample_idx.find(l->identifier);
+                if (iter != sample_idx.end()) {
+                    displayed_samples[iter->second] = true;
+                }
+            }
+            subtree_leaves.emplace_back(std::move(leaves_to_keep));
+            break;
+        }
+    }
+
+    // Then extract and write the subtrees in parallel, the tree is only read
+    // from here on
+    tbb::parallel_for (tbb::blocked_range<size_t>(0, subtree_leaves.size()),
+    [&](tbb::blocked_range<size_t> r) {
+        for (size_t i = r.begin(); i < r.end(); i++) {
+            int num_subtrees = i+1;
+            auto new_T = Mutation_Annotated_Tree::get_subtree_dfs_indexed(*T, subtree_leaves[i]);
 
             // Rotate tree for display
             new_T.rotate_for_display();
 
-            tbb::parallel_for (tbb::blocked_range<size_t>(i+1, samples.size(), 100),
-            [&](tbb::blocked_range<size_t> r) {
-                for (size_t j=r.begin(); j<r.end(); ++j) {
-                    if (!displayed_samples[j]) {
-                        if (new_T.get_node(samples[j]) != NULL) {
-                            displayed_samples[j] = true;
-                        }
-                    }
-                }
-            });
-
             // Write subtree to file
-            ++num_subtrees;
             auto subtree_filename = outdir + preid + "subtree-" + std::to_string(num_subtrees) + ".nh";
             fprintf(stderr, "Writing subtree %d to file %s.\n", num_subtrees, subtree_filename.c_str());
-            //FILE* subtree_file = fopen(subtree_filename.c_str(), "w");
-            //fprintf(subtree_file, "%s\n", newick.c_str());
-            //fclose(subtree_file);
             std::ofstream subtree_file(subtree_filename.c_str(), std::ofstream::out);
             std::stringstream newick_ss;
             write_newick_string(newick_ss, new_T, new_T.root, true, true, retain_original_branch_len);
@@ -1830,7 +1933,8 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
             bool has_condensed = false;
             FILE* subtree_expanded_file = NULL;
             for (auto l: new_T.get_leaves()) {
-                if (T->condensed_nodes.find(l->identifier) != T->condensed_nodes.end()) {
+                auto condensed_iter = T->condensed_nodes.find(l->identifier);
+                if (condensed_iter != T->condensed_nodes.end()) {
                     if (!has_condensed) {
                         auto subtree_expanded_filename = outdir + preid +  "subtree-" + std::to_string(num_subtrees) + "-expanded.txt";
                         fprintf(stderr, "Subtree %d has condensed nodes.\nExpanding the condensed nodes for subtree %d in file %s\n", num_subtrees, num_subtrees, subtree_expanded_filename.c_str());
@@ -1838,7 +1942,7 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
                         has_condensed = true;
                     }
                     fprintf(subtree_expanded_file, "%s: ", l->identifier.c_str());
-                    for (auto n: T->condensed_nodes[l->identifier]) {
+                    for (auto n: condensed_iter->second) {
                         fprintf(subtree_expanded_file, "%s ", n.c_str());
                     }
                     fprintf(subtree_expanded_file, "\n");
@@ -1847,9 +1951,9 @@ void Mutation_Annotated_Tree::get_random_sample_subtrees (Mutation_Annotated_Tre
             if (has_condensed) {
                 fclose(subtree_expanded_file);
             }
-            break;
+            clear_tree(new_T);
         }
-    }
+    });
 }
 
 void Mutation_Annotated_Tree::get_sample_mutation_paths (Mutation_Annotated_Tree::Tree* T, std::vector<std::string> samples, std::string mutation_paths_filename) {
@@ -2097,7 +2201,7 @@ void Mutation_Annotated_Tree::read_vcf(Mutation_Annotated_Tree::Tree* T, std::st
                     std::advance(iter, k);
                     if (iter != missing_samples.end()) {
                         Mutation m;
-                        m.chrom = words[0];
+                        m.set_chromosome(words[0]);
                         m.position = std::stoi(words[1]);
                         m.ref_nuc = get_nuc_id(words[3][0]);
                         assert((m.ref_nuc & (m.ref_nuc-1)) == 0); //check if it is power of 2
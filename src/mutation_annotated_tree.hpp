@@ -38,31 +38,33 @@ int8_t get_nt (int8_t nuc_id);
 std::vector<int8_t> get_nuc_vec (char nuc);
 std::vector<int8_t> get_nuc_vec_from_id (int8_t nuc_id);
 
-// WARNING: chrom is currently ignored!
 // position < 0 implies masked mutations i.e. mutations that exist but
 // details are unknown
+// Chromosome names are kept in a table shared by all mutations, so that a
+// mutation packs into 8 bytes. Index 0 is the empty name.
 struct Mutation {
-    std::string chrom;
+    static const size_t max_chromosomes = 128;
+    static tbb::concurrent_unordered_map<std::string, uint8_t> chromosome_map;
+    static std::string chromosomes[max_chromosomes];
+
     int position;
     int8_t ref_nuc;
     int8_t par_nuc;
     int8_t mut_nuc;
-    bool is_missing;
+    uint8_t chrom_idx:7;
+    bool is_missing:1;
     inline bool operator< (const Mutation& m) const {
         return ((*this).position < m.position);
     }
     inline Mutation copy() const {
-        Mutation m;
-        m.chrom = chrom;
-        m.position = position;
-        m.ref_nuc = ref_nuc;
-        m.par_nuc = par_nuc;
-        m.mut_nuc = mut_nuc;
-        m.is_missing = is_missing;
-        return m;
+        return *this;
+    }
+    inline const std::string& get_chromosome() const {
+        return chromosomes[chrom_idx];
     }
+    void set_chromosome(const std::string& chromosome);
     Mutation () {
-        chrom = "";
+        chrom_idx = 0;
         is_missing = false;
     }
     inline bool is_masked() const {
@@ -132,6 +134,10 @@ class Tree {
     Node* create_node (std::string const& identifier, float branch_length = -1.0, size_t num_annotations=0);
     Node* create_node (std::string const& identifier, Node* par, float branch_length = -1.0);
     Node* create_node (std::string const& identifier, std::string const& parent_id, float branch_length = -1.0);
+    void register_nodes (const std::vector<Node*>& nodes);
+    typedef std::unordered_map<std::string, Node*>::node_type Node_Entry;
+    Node_Entry unregister_node (Node* node);
+    void register_node (Node_Entry&& entry);
     Node* get_node (std::string identifier) const;
     bool is_ancestor (std::string anc_id, std::string nid) const;
     std::vector<Node*> rsearch (const std::string& nid, bool include_self = false) const;
@@ -167,6 +173,7 @@ Tree get_tree_copy(const Tree& tree, const std::string& identifier="");
 
 Node* LCA (const Tree& tree, const std::string& node_id1, const std::string& node_id2);
 Tree get_subtree (const Tree& tree, const std::vector<std::string>& samples, bool keep_clade_annotations=false);
+Tree get_subtree_dfs_indexed (const Tree& tree, const std::vector<Node*>& samples, bool keep_clade_annotations=false);
 void get_random_single_subtree (Mutation_Annotated_Tree::Tree* T, std::vector<std::string> samples, std::string outdir, size_t subtree_size, size_t tree_idx = 0, bool use_tree_idx = false, bool retain_original_branch_len = false);
 void get_random_sample_subtrees (Mutation_Annotated_Tree::Tree* T, std::vector<std::string> samples, std::string outdir, size_t subtree_size, size_t tree_idx = 0, bool use_tree_idx = false, bool retain_original_branch_len = false);
 void get_sample_mutation_paths (Mutation_Annotated_Tree::Tree* T, std::vector<std::string> samples, std::string mutation_paths_filename);
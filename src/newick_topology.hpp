@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Newick parsing shared by the legacy and the matOptimize tree loaders
+
+// Topology of a newick string with the nodes in preorder. Internal node
+// labels are ignored and internal nodes are numbered in preorder. Branch
+// lengths are matched to the nodes of each level in order, as in the
+// comma-separated parse this replaces.
+struct Newick_Topology {
+    static const size_t no_parent = SIZE_MAX;
+    std::vector<size_t> parent;
+    std::vector<size_t> depth;
+    std::vector<float> branch_len;
+    std::vector<size_t> num_children;
+    // 1-based preorder number of internal nodes, 0 for leaves
+    std::vector<size_t> internal_id;
+    // span of the leaf name in the newick string
+    std::vector<size_t> name_begin;
+    std::vector<size_t> name_end;
+};
+
+inline void parse_newick_topology (const std::string& newick_string, Newick_Topology& topo) {
+    size_t num_commas = std::count(newick_string.begin(), newick_string.end(), ',');
+    size_t num_open = std::count(newick_string.begin(), newick_string.end(), '(');
+    size_t max_nodes = num_commas + num_open + 1;
+    topo.parent.reserve(max_nodes);
+    topo.depth.reserve(max_nodes);
+    topo.num_children.reserve(max_nodes);
+    topo.internal_id.reserve(max_nodes);
+    topo.name_begin.reserve(max_nodes);
+    topo.name_end.reserve(max_nodes);
+
+    // nodes and branch lengths in the order they are found at each level
+    std::vector<std::vector<size_t>> level_nodes (128);
+    std::vector<std::vector<float>> level_branch_len (128);
+    std::vector<size_t> parent_stack;
+    std::string branch;
+    size_t level = 0;
+    size_t num_internal = 0;
+
+    auto add_node = [&](size_t name_begin, size_t name_end, bool internal) {
+        size_t idx = topo.parent.size();
+        size_t par = Newick_Topology::no_parent;
+        if (parent_stack.size() > 0) {
+            par = parent_stack.back();
+            topo.num_children[par]++;
+        } else if (idx > 0) {
+            fprintf(stderr, "ERROR: incorrect Newick format!\n");
+            exit(1);
+        }
+        topo.parent.push_back(par);
+        topo.depth.push_back(parent_stack.size());
+        topo.num_children.push_back(0);
+        topo.internal_id.push_back(internal ? ++num_internal : 0);
+        topo.name_begin.push_back(name_begin);
+        topo.name_end.push_back(name_end);
+        if (level_nodes.size() <= parent_stack.size()) {
+            level_nodes.resize(parent_stack.size()*2);
+        }
+        level_nodes[parent_stack.size()].push_back(idx);
+        return idx;
+    };
+
+    size_t start_pos = 0;
+    while (start_pos <= newick_string.size()) {
+        size_t end_pos = newick_string.find(',', start_pos);
+        if (end_pos == std::string::npos) {
+            end_pos = newick_string.size();
+            // an empty piece after the last comma is dropped
+            if (end_pos == start_pos) {
+                break;
+            }
+        }
+
+        size_t no = 0;
+        size_t nc = 0;
+        bool stop = false;
+        bool branch_start = false;
+        size_t leaf_begin = end_pos;
+        size_t leaf_end = end_pos;
+        branch.clear();
+        for (size_t i = start_pos; i < end_pos; i++) {
+            char c = newick_string[i];
+            if (c == ':') {
+                stop = true;
+                branch.clear();
+                branch_start = true;
+            } else if (c == '(') {
+                no++;
+                level++;
+                if (level_branch_len.size() <= level) {
+                    level_branch_len.resize(level*2);
+                }
+            } else if (c == ')') {
+                if (level == 0) {
+                    fprintf(stderr, "ERROR: incorrect Newick format!\n");
+                    exit(1);
+                }
+                stop = true;
+                nc++;
+                float len = (branch.size() > 0) ? std::stof(branch) : -1.0;
+                level_branch_len[level].push_back(len);
+                level--;
+                branch_start = false;
+            } else if (!stop) {
+                if (leaf_begin == end_pos) {
+                    leaf_begin = i;
+                }
+                leaf_end = i+1;
+                branch_start = false;
+            } else if (branch_start) {
+                if (isdigit(c)  || c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+') {
+                    branch += c;
+                }
+            }
+        }
+        float len = (branch.size() > 0) ? std::stof(branch) : -1.0;
+        level_branch_len[level].push_back(len);
+
+        for (size_t j=0; j<no; j++) {
+            parent_stack.push_back(add_node(0, 0, true));
+        }
+        add_node(leaf_begin, leaf_end, false);
+        for (size_t j=0; j<nc; j++) {
+            parent_stack.pop_back();
+        }
+
+        start_pos = end_pos+1;
+    }
+
+    if (level != 0) {
+        fprintf(stderr, "ERROR: incorrect Newick format!\n");
+        exit(1);
+    }
+
+    topo.branch_len.resize(topo.parent.size(), -1.0);
+    for (size_t l = 0; l < std::min(level_nodes.size(), level_branch_len.size()); l++) {
+        size_t num_matched = std::min(level_nodes[l].size(), level_branch_len[l].size());
+        for (size_t k = 0; k < num_matched; k++) {
+            topo.branch_len[level_nodes[l][k]] = level_branch_len[l][k];
+        }
+    }
+}
@@ -9,161 +9,10 @@
 #include <boost/filesystem.hpp>
 #include "tbb/concurrent_unordered_set.h"
 #include "../usher_graph.hpp"
-
-
-namespace po = boost::program_options;
+#include "ripples_fast/ripples.hpp"
 
 Timer timer;
 
-po::variables_map check_options(int argc, char** argv) {
-    uint32_t num_cores = tbb::task_scheduler_init::default_num_threads();
-    std::string num_threads_message = "Number of threads to use when possible [DEFAULT uses all available cores, " + std::to_string(num_cores) + " detected on this machine]";
-
-    po::options_description desc("optimize options");
-    desc.add_options()
-    ("input-mat,i", po::value<std::string>()->required(),
-     "Input mutation-annotated tree file to optimize [REQUIRED].")
-    ("branch-length,l", po::value<uint32_t>()->default_value(3), \
-     "Minimum length of the branch to consider to recombination events")
-    ("min-coordinate-range,r", po::value<int>()->default_value(1e3), \
-     "Minimum range of the genomic coordinates of the mutations on the recombinant branch")
-    ("max-coordinate-range,R", po::value<int>()->default_value(1e7), \
-     "Maximum range of the genomic coordinates of the mutations on the recombinant branch")
-    ("outdir,d", po::value<std::string>()->default_value("."),
-     "Output directory to dump output files [DEFAULT uses current directory]")
-    ("samples-filename,s", po::value<std::string>()->default_value(""),
-     "Restrict the search to the ancestors of the samples specified in the input file")
-
-    ("parsimony-improvement,p", po::value<int>()->default_value(3), \
-     "Minimum improvement in parsimony score of the recombinant sequence during the partial placement")
-    ("num-descendants,n", po::value<uint32_t>()->default_value(10), \
-     "Minimum number of leaves that node should have to be considered for recombination.")
-    ("threads,T", po::value<uint32_t>()->default_value(num_cores), num_threads_message.c_str())
-    ("start-index,S", po::value<int>()->default_value(-1), "start index [EXPERIMENTAL]")
-    ("end-index,E", po::value<int>()->default_value(-1), "end index [EXPERIMENTAL]")
-    ("help,h", "Print help messages");
-
-    po::options_description all_options;
-    all_options.add(desc);
-    po::positional_options_description p;
-    po::variables_map vm;
-    try {
-        po::store(po::command_line_parser(argc, argv)
-                  .options(all_options)
-                  .positional(p)
-                  .run(), vm);
-        po::notify(vm);
-    } catch(std::exception &e) {
-        std::cerr << desc << std::endl;
-        // Return with error code 1 unless
-        // the user specifies help
-        if (vm.count("help"))
-            exit(0);
-        else
-            exit(1);
-    }
-    return vm;
-}
-
-struct Pruned_Sample {
-    std::string sample_name;
-    std::vector<MAT::Mutation> sample_mutations;
-    std::unordered_set<uint32_t> positions;
-
-    // Assumes mutations are added in reverse chrono order
-    void add_mutation (MAT::Mutation mut) {
-        // If not reversal to reference allele
-        if ((mut.ref_nuc != mut.mut_nuc) && (positions.find(mut.position) == positions.end())) {
-            auto iter = std::lower_bound(sample_mutations.begin(), sample_mutations.end(), mut);
-            auto m = mut.copy();
-            m.par_nuc = m.ref_nuc;
-            sample_mutations.insert(iter, m);
-        }
-        positions.insert(mut.position);
-    }
-
-    Pruned_Sample (std::string name) {
-        sample_name = name;
-        sample_mutations.clear();
-        positions.clear();
-    }
-};
-
-struct Recomb_Node {
-    std::string name;
-    int node_parsimony;
-    int parsimony;
-    char is_sibling;
-    Recomb_Node() {
-        name = "";
-        node_parsimony = -1;
-        parsimony = -1;
-        is_sibling = false;
-    }
-    Recomb_Node(std::string n, int np, int p, char s) : name(n), node_parsimony(np), parsimony(p), is_sibling(s)
-    {}
-    inline bool operator< (const Recomb_Node& n) const {
-        return (((*this).parsimony < n.parsimony) || (((*this).name <  n.name) && ((*this).parsimony == n.parsimony)));
-    }
-
-};
-
-struct Recomb_Interval {
-    Recomb_Node d;//donor
-    Recomb_Node a;//acceptor
-    int start_range_low;
-    int start_range_high;
-    int end_range_low;
-    int end_range_high;
-    Recomb_Interval(Recomb_Node donor, Recomb_Node acceptor, int sl, int sh, int el, int eh):
-        d(donor), a(acceptor), start_range_low(sl), start_range_high(sh), end_range_low(el), end_range_high(eh)
-    {}
-    bool operator<(const Recomb_Interval& other) const { //compare second interval
-        return end_range_low < other.end_range_low;
-    }
-};
-
-struct Comp_First_Interval {
-    inline bool operator()(const Recomb_Interval& one, const Recomb_Interval& other) {
-        return one.start_range_low < other.start_range_low;
-    }
-};
-
-
-std::vector<Recomb_Interval> combine_intervals(std::vector<Recomb_Interval> pair_list) {
-    //combine second interval
-    std::vector<Recomb_Interval> pairs(pair_list);
-    std::sort(pairs.begin(), pairs.end());//sorts by beginning of second interval
-    for(size_t i = 0; i < pairs.size(); i++) {
-        for(size_t j = i+1; j < pairs.size(); j++) {
-            //check everything except first interval is same and first interval of pairs[i] ends where it starts for pairs[j]
-            if((pairs[i].d.name == pairs[j].d.name) && (pairs[i].a.name == pairs[j].a.name) &&
-                    (pairs[i].start_range_low == pairs[j].start_range_low) && (pairs[i].start_range_high == pairs[j].start_range_high) &&
-                    (pairs[i].end_range_high == pairs[j].end_range_low) && ((pairs[i].d.parsimony+pairs[i].a.parsimony) == (pairs[j].d.parsimony+pairs[j].a.parsimony))) {
-                pairs[i].end_range_high = pairs[j].end_range_high;
-                pairs.erase(pairs.begin()+j);//remove the combined element
-                j--;
-            }
-        }
-    }
-    //combine first interval
-    std::sort(pairs.begin(), pairs.end(), Comp_First_Interval());
-    for(size_t i = 0; i < pairs.size(); i++) {
-        for(size_t j = i + 1; j < pairs.size(); j++) {
-            //check everything except second interval is same and second interval of pairs[i] ends where it starts for pairs[j]
-            if((pairs[i].d.name == pairs[j].d.name) && (pairs[i].a.name == pairs[j].a.name) &&
-                    (pairs[i].end_range_low == pairs[j].end_range_low) && (pairs[i].end_range_high == pairs[j].end_range_high) &&
-                    (pairs[i].start_range_high == pairs[j].start_range_low) && ((pairs[i].d.parsimony+pairs[i].a.parsimony) == (pairs[j].d.parsimony+pairs[j].a.parsimony))) {
-                pairs[i].start_range_high = pairs[j].start_range_high;
-                pairs.erase(pairs.begin()+j);
-                j--;
-            }
-        }
-    }
-    return pairs;
-}
-
-
 int main(int argc, char** argv) {
     po::variables_map vm = check_options(argc, argv);
     std::string input_mat_filename = vm["input-mat"].as<std::string>();
@@ -277,16 +126,9 @@ int main(int argc, char** argv) {
 
     timer.Start();
 
-    std::unordered_map<MAT::Node*, size_t> tree_num_leaves;
-
-    for (int i=int(bfs.size())-1; i>=0; i--) {
-        auto n = bfs[i];
-        size_t desc = 1;
-        for (auto child: n->children) {
-            desc += tree_num_leaves[child];
-        }
-        tree_num_leaves[n] = desc;
-    }
+    auto dfs = T.depth_first_expansion();
+    Ripples_Search_Tree search_tree(T, dfs, num_descendants, num_threads);
+    Pruned_Sample_Cache sample_cache;
 
     size_t s = 0, e = nodes_to_consider.size();
 
@@ -304,396 +146,31 @@ int main(int argc, char** argv) {
         auto nid_to_consider = nodes_to_consider_vec[idx];
         fprintf(stderr, "At node id: %s\n", nid_to_consider.c_str());
 
-        int orig_parsimony = (int) T.get_node(nid_to_consider)->mutations.size();
-
-        Pruned_Sample pruned_sample(nid_to_consider);
-        // Find mutations on the node to prune
-        auto node_to_root = T.rsearch(nid_to_consider, true);
-        for (auto curr: node_to_root) {
-            for (auto m: curr->mutations) {
-                pruned_sample.add_mutation(m);
-            }
-        }
-        size_t num_mutations = pruned_sample.sample_mutations.size();
-
-        size_t total_nodes = bfs.size();
-
-        std::vector<std::vector<MAT::Mutation>> node_excess_mutations(total_nodes);
-        std::vector<std::vector<MAT::Mutation>> imputed_mutations(total_nodes);
-
-        std::vector<int> node_set_difference(total_nodes);
-
-        size_t best_node_num_leaves = 0;
-        int best_set_difference = 1e9;
-
-        std::vector<bool> node_has_unique(total_nodes);
-        size_t best_j = 0;
-        bool best_node_has_unique = false;
-
-        size_t best_distance = 1e9;
-
-        std::vector<size_t> best_j_vec;
-
-        size_t num_best = 1;
-        MAT::Node* best_node = T.root;
-        best_j_vec.emplace_back(0);
-
-        std::vector<size_t> node_distance(total_nodes, 0);
-
-        tbb::parallel_for( tbb::blocked_range<size_t>(0, total_nodes),
-        [&](tbb::blocked_range<size_t> r) {
-            for (size_t k=r.begin(); k<r.end(); ++k) {
-                if (tree_num_leaves[bfs[k]] < num_descendants) {
-                    continue;
-                }
-
-                node_has_unique[k] = false;
-
-                mapper2_input inp;
-                inp.T = &T;
-                inp.node = bfs[k];
-                inp.missing_sample_mutations = &pruned_sample.sample_mutations;
-                inp.excess_mutations = &node_excess_mutations[k];
-                inp.imputed_mutations = &imputed_mutations[k];
-                inp.best_node_num_leaves = &best_node_num_leaves;
-                inp.best_set_difference = &best_set_difference;
-                inp.best_node = &best_node;
-                inp.best_j =  &best_j;
-                inp.num_best = &num_best;
-                inp.j = k;
-                inp.has_unique = &best_node_has_unique;
-
-                inp.set_difference = &node_set_difference[k];
-
-                inp.distance = node_distance[k];
-                inp.best_distance = &best_distance;
+        auto node_to_consider = T.get_node(nid_to_consider);
+        int orig_parsimony = (int) node_to_consider->mutations.size();
 
-                inp.best_j_vec = &best_j_vec;
-                inp.node_has_unique = &(node_has_unique);
-
-                mapper2_body(inp, true);
-
-            }
-        }, ap);
-
-        std::vector<Recomb_Interval> valid_pairs;
-        bool has_recomb = false;
-
-        size_t at = 0;
-        for (size_t i = 0; i<num_mutations; i++) {
-            for (size_t j=i; j<num_mutations; j++) {
-                fprintf(stderr, "\rTrying %zu of %zu breakpoint pairs.", ++at, num_mutations*(1+num_mutations)/2);
-                Pruned_Sample donor("donor");
-                Pruned_Sample acceptor("acceptor");
-
-                donor.sample_mutations.clear();
-                acceptor.sample_mutations.clear();
-
-                for (size_t k=0; k<num_mutations; k++) {
-                    if ((k>=i) && (k<j)) {
-                        donor.add_mutation(pruned_sample.sample_mutations[k]);
-                    } else {
-                        acceptor.add_mutation(pruned_sample.sample_mutations[k]);
-                    }
-                }
-
-                int start_range_high = pruned_sample.sample_mutations[i].position;
-                int start_range_low = (i>=1) ? pruned_sample.sample_mutations[i-1].position : 0;
-
-                //int end_range_high = pruned_sample.sample_mutations[j].position;
-                int end_range_high = 1e9;
-                int end_range_low = (j>=1) ? pruned_sample.sample_mutations[j-1].position : 0;
-
-                //int end_range_low = pruned_sample.sample_mutations[j].position;
-                //int end_range_high = (j+1<num_mutations) ? pruned_sample.sample_mutations[j+1].position : 1e9;
-
-                if ((donor.sample_mutations.size() < branch_len) || (acceptor.sample_mutations.size() < branch_len) ||
-                        (end_range_low-start_range_high < min_range) || (end_range_low-start_range_high > max_range)) {
-                    continue;
-                }
-
-                tbb::concurrent_vector<Recomb_Node> donor_nodes;
-                tbb::concurrent_vector<Recomb_Node> acceptor_nodes;
-
-                donor_nodes.clear();
-                acceptor_nodes.clear();
-                // find acceptor(s)
-                {
-                    tbb::parallel_for( tbb::blocked_range<size_t>(0, total_nodes),
-                    [&](tbb::blocked_range<size_t> r) {
-
-
-                        for (size_t k=r.begin(); k<r.end(); ++k) {
-                            size_t num_mut = 0;
-                            if ((tree_num_leaves[bfs[k]] < num_descendants) || (T.is_ancestor(nid_to_consider,bfs[k]->identifier))) {
-                                continue;
-                            }
-                            // Is placement as sibling
-                            if (bfs[k]->is_leaf() || node_has_unique[k]) {
-                                std::vector<MAT::Mutation> l2_mut;
-
-                                // Compute l2_mut
-                                for (auto m1: node_excess_mutations[k]) {
-                                    bool found = false;
-                                    for (auto m2: bfs[k]->mutations) {
-                                        if (m1.is_masked()) {
-                                            break;
-                                        }
-                                        if (m1.position == m2.position) {
-                                            if (m1.mut_nuc == m2.mut_nuc) {
-                                                found = true;
-                                                break;
-                                            }
-                                        }
-                                    }
-                                    if (!found) {
-                                        if ((m1.position < start_range_high) || (m1.position > end_range_low)) {
-                                            num_mut++;
-                                        }
-                                    }
-                                    if (num_mut + parsimony_improvement > (size_t) orig_parsimony) {
-                                        break;
-                                    }
-                                }
-
-                                if (num_mut + parsimony_improvement <= (size_t) orig_parsimony) {
-                                    acceptor_nodes.emplace_back(Recomb_Node(bfs[k]->identifier, node_set_difference[k], num_mut, 'y'));
-                                }
-                            }
-                            // Else placement as child
-                            else {
-                                for (auto m1: node_excess_mutations[k]) {
-                                    bool found = false;
-                                    for (auto m2: bfs[k]->mutations) {
-                                        if (m1.is_masked()) {
-                                            break;
-                                        }
-                                        if (m1.position == m2.position) {
-                                            if (m1.mut_nuc == m2.mut_nuc) {
-                                                found = true;
-                                                break;
-                                            }
-                                        }
-                                    }
-                                    if (!found) {
-                                        if ((m1.position < start_range_high) || (m1.position > end_range_low)) {
-                                            num_mut++;
-                                        }
-                                    }
-                                    if (num_mut + parsimony_improvement > (size_t) orig_parsimony) {
-                                        break;
-                                    }
-                                }
-
-                                if (num_mut + parsimony_improvement <= (size_t) orig_parsimony) {
-                                    acceptor_nodes.emplace_back(Recomb_Node(bfs[k]->identifier, node_set_difference[k], num_mut, 'n'));
-                                }
-                            }
-                        }
-                    }, ap);
-                }
-
-                if (acceptor_nodes.size() == 0) {
-                    continue;
-                }
-
-                // find donor(s)
-                {
-                    tbb::parallel_for( tbb::blocked_range<size_t>(0, total_nodes),
-                    [&](tbb::blocked_range<size_t> r) {
-                        for (size_t k=r.begin(); k<r.end(); ++k) {
-                            if ((tree_num_leaves[bfs[k]] < num_descendants) || (T.is_ancestor(nid_to_consider,bfs[k]->identifier))) {
-                                continue;
-                            }
-
-                            size_t num_mut = 0;
-
-                            // Is placement as sibling
-                            if (bfs[k]->is_leaf() || node_has_unique[k]) {
-                                std::vector<MAT::Mutation> l2_mut;
-
-                                // Compute l2_mut
-                                for (auto m1: node_excess_mutations[k]) {
-                                    bool found = false;
-                                    for (auto m2: bfs[k]->mutations) {
-                                        if (m1.is_masked()) {
-                                            break;
-                                        }
-                                        if (m1.position == m2.position) {
-                                            if (m1.mut_nuc == m2.mut_nuc) {
-                                                found = true;
-                                                break;
-                                            }
-                                        }
-                                    }
-                                    if (!found) {
-                                        if ((m1.position >= start_range_high) && (m1.position <= end_range_low)) {
-                                            num_mut++;
-                                        }
-                                    }
-
-                                    if (num_mut + parsimony_improvement > (size_t) orig_parsimony) {
-                                        break;
-                                    }
-                                }
-
-                                if (num_mut + parsimony_improvement <= (size_t) orig_parsimony) {
-                                    donor_nodes.emplace_back(Recomb_Node(bfs[k]->identifier, node_set_difference[k], num_mut, 'y'));
-                                }
-                            }
-                            // Else placement as child
-                            else {
-                                for (auto m1: node_excess_mutations[k]) {
-                                    bool found = false;
-                                    for (auto m2: bfs[k]->mutations) {
-                                        if (m1.is_masked()) {
-                                            break;
-                                        }
-                                        if (m1.position == m2.position) {
-                                            if (m1.mut_nuc == m2.mut_nuc) {
-                                                found = true;
-                                                break;
-                                            }
-                                        }
-                                    }
-                                    if (!found) {
-                                        if ((m1.position >= start_range_high) && (m1.position <= end_range_low)) {
-                                            num_mut++;
-                                        }
-                                    }
-                                    if (num_mut + parsimony_improvement > (size_t) orig_parsimony) {
-                                        break;
-                                    }
-                                }
-
-                                if (num_mut + parsimony_improvement <= (size_t) orig_parsimony) {
-                                    donor_nodes.emplace_back(Recomb_Node(bfs[k]->identifier, node_set_difference[k], num_mut, 'n'));
-                                }
-                            }
-                        }
-                    }, ap);
-                }
-
-                tbb::parallel_sort (donor_nodes.begin(), donor_nodes.end());
-                tbb::parallel_sort (acceptor_nodes.begin(), acceptor_nodes.end());
-
-
-                if (donor_nodes.size() > 1000) {
-                    donor_nodes.resize(1000);
-                }
-
-                if (acceptor_nodes.size() > 1000) {
-                    acceptor_nodes.resize(1000);
-                }
-
-
-                // to print any pair of breakpoint interval exactly once for
-                // multiple donor-acceptor pairs
-                bool has_printed = false;
-
-                for (auto d: donor_nodes) {
-                    if (T.is_ancestor(nid_to_consider,d.name)) {
-                        continue;
-                    }
-                    for (auto a:acceptor_nodes) {
-                        if (T.is_ancestor(nid_to_consider,a.name)) {
-                            continue;
-                        }
-                        // Ensure donor and acceptor are not the same and
-                        // neither of them is a descendant of the recombinant
-                        // node total parsimony is less than the maximum allowed
-                        if ((d.name!=a.name) && (d.name!=nid_to_consider) && (a.name!=nid_to_consider) &&
-                                //(!T.is_ancestor(nid_to_consider,d.name)) && (!T.is_ancestor(nid_to_consider,a.name)) &&
-                                (orig_parsimony >= d.parsimony + a.parsimony + parsimony_improvement)) {
-                            Pruned_Sample donor("curr-donor");
-                            donor.sample_mutations.clear();
-                            acceptor.sample_mutations.clear();
-
-                            for (auto anc: T.rsearch(d.name, true)) {
-                                for (auto mut: anc->mutations) {
-                                    donor.add_mutation(mut);
-                                }
-                            }
-
-                            for (auto mut: donor.sample_mutations) {
-                                if ((mut.position > start_range_low) && (mut.position <= start_range_high)) {
-                                    bool in_pruned_sample = false;
-                                    for (auto mut2: pruned_sample.sample_mutations) {
-                                        if (mut.position == mut2.position) {
-                                            in_pruned_sample = true;
-                                        }
-                                    }
-                                    if (!in_pruned_sample) {
-                                        start_range_low = mut.position;
-                                    }
-                                }
-                                if ((mut.position > end_range_low) && (mut.position <= end_range_high)) {
-                                    bool in_pruned_sample = false;
-                                    for (auto mut2: pruned_sample.sample_mutations) {
-                                        if (mut.position == mut2.position) {
-                                            in_pruned_sample = true;
-                                        }
-                                    }
-                                    if (!in_pruned_sample) {
-                                        end_range_high = mut.position;
-                                    }
-                                }
-                            }
-
-                            for (auto mut: pruned_sample.sample_mutations) {
-                                if ((mut.position > start_range_low) && (mut.position <= start_range_high)) {
-                                    bool in_pruned_sample = false;
-                                    for (auto mut2: donor.sample_mutations) {
-                                        if (mut.position == mut2.position) {
-                                            in_pruned_sample = true;
-                                        }
-                                    }
-                                    if (!in_pruned_sample) {
-                                        start_range_low = mut.position;
-                                    }
-                                }
-                                if ((mut.position > end_range_low) && (mut.position <= end_range_high)) {
-                                    bool in_pruned_sample = false;
-                                    for (auto mut2: donor.sample_mutations) {
-                                        if (mut.position == mut2.position) {
-                                            in_pruned_sample = true;
-                                        }
-                                    }
-                                    if (!in_pruned_sample) {
-                                        end_range_high = mut.position;
-                                    }
-                                }
-                            }
-
-                            //tbb_lock.lock();
-                            valid_pairs.push_back(Recomb_Interval(d, a, start_range_low, start_range_high, end_range_low, end_range_high));
-                            //tbb_lock.unlock();
-
-                            has_recomb = true;
-                            has_printed = true;
-                            break;
-                        }
-                    }
-                    if (has_printed) {
-                        break;
-                    }
-                }
-            }
-        }
-        fprintf(stderr, "\n");
+        Ripples_Merger_Stats merger_stats;
+        auto valid_pairs = find_recombination(node_to_consider, T, search_tree, sample_cache,
+                                              parsimony_improvement, num_threads, branch_len,
+                                              min_range, max_range, merger_stats);
+        fprintf(stderr, "Searched %zu breakpoint pairs, pruned %zu by parsimony bounds\n",
+                merger_stats.searched, merger_stats.pruned);
 
-        valid_pairs = combine_intervals(valid_pairs);
         //print combined pairs
         for(auto p: valid_pairs) {
             std::string end_range_high_str = (p.end_range_high == 1e9) ? "GENOME_SIZE" : std::to_string(p.end_range_high);
+            // Parsimony of placing the recombinant at the donor/acceptor,
+            // one more if it would be placed as a child
+            int d_node_parsimony = p.d.node_parsimony + !p.d.is_sibling;
+            int a_node_parsimony = p.a.node_parsimony + !p.a.is_sibling;
             fprintf(recomb_file, "%s\t(%i,%i)\t(%i,%s)\t%s\t%c\t%i\t%s\t%c\t%i\t%i\t%i\t%i\n", nid_to_consider.c_str(), p.start_range_low,
-                    p.start_range_high, p.end_range_low, end_range_high_str.c_str(), p.d.name.c_str(), p.d.is_sibling, p.d.node_parsimony,
-                    p.a.name.c_str(), p.a.is_sibling, p.a.node_parsimony, orig_parsimony,
-                    std::min({orig_parsimony, p.d.node_parsimony, p.a.node_parsimony}), p.d.parsimony+p.a.parsimony);
+                    p.start_range_high, p.end_range_low, end_range_high_str.c_str(), p.d.node->identifier.c_str(), p.d.is_sibling ? 'y' : 'n', d_node_parsimony,
+                    p.a.node->identifier.c_str(), p.a.is_sibling ? 'y' : 'n', a_node_parsimony, orig_parsimony,
+                    std::min({orig_parsimony, d_node_parsimony, a_node_parsimony}), p.d.parsimony+p.a.parsimony);
             fflush(recomb_file);
         }
 
-        if (has_recomb) {
+        if (!valid_pairs.empty()) {
             fprintf(desc_file, "%s\t", nid_to_consider.c_str());
             for (auto l: T.get_leaves(nid_to_consider)) {
                 fprintf(desc_file, "%s,", l->identifier.c_str());
@@ -3,9 +3,15 @@
 #include "tbb/concurrent_unordered_set.h"
 #include <array>
 #include <boost/filesystem.hpp>
+#include <cstdarg>
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <mpi.h>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <time.h>
 #include <vector>
 #define CHECK_MAPPER
@@ -23,27 +29,134 @@ struct idx_eq {
 MAT::Node* get_node_cstr (MAT::Tree& tree,char* name) {
     return tree.get_node(std::string(name));
 }
-struct interval_sorter {
-    bool operator()(Recomb_Interval& a,Recomb_Interval& b) {
-        if (a.start_range_high<b.start_range_high) {
-            return true;
-        } else if(a.start_range_high==b.start_range_high&&a.end_range_low<b.end_range_low) {
-            return true;
-        }
-        return false;
-    }
-};
 struct Ripple_Result_Pack {
     std::vector<Recomb_Interval> intervals;
     MAT::Node* node_to_consider;
     int orig_parsimony;
+    size_t idx;
+};
+// Output lines for one branch, keyed by the index of the branch among the
+// branches to consider so that the output does not depend on how branches
+// are split among processes
+struct Ripple_Output {
+    size_t idx;
+    bool found;
+    std::string recomb_lines;
+    std::string desc_line;
 };
+static const int RIPPLE_OUTPUT_TAG=1;
+static const int RIPPLE_DONE_TAG=2;
+static void append_printf(std::string& out,const char* format,...) {
+    va_list args;
+    va_start(args, format);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len=vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+    size_t old_size=out.size();
+    out.resize(old_size+len+1);
+    vsnprintf(&out[old_size], len+1, format, args);
+    out.resize(old_size+len);
+    va_end(args);
+}
+static void send_output(const Ripple_Output& out) {
+    std::vector<char> buf(sizeof(size_t)*2+1+out.recomb_lines.size()+out.desc_line.size());
+    size_t recomb_size=out.recomb_lines.size();
+    char* ptr=buf.data();
+    memcpy(ptr, &out.idx, sizeof(size_t));
+    ptr+=sizeof(size_t);
+    *ptr=out.found;
+    ptr++;
+    memcpy(ptr, &recomb_size, sizeof(size_t));
+    ptr+=sizeof(size_t);
+    memcpy(ptr, out.recomb_lines.data(), recomb_size);
+    ptr+=recomb_size;
+    memcpy(ptr, out.desc_line.data(), out.desc_line.size());
+    MPI_Send(buf.data(), buf.size(), MPI_CHAR, 0, RIPPLE_OUTPUT_TAG, MPI_COMM_WORLD);
+}
+static Ripple_Output parse_output(const std::vector<char>& buf) {
+    Ripple_Output out;
+    size_t recomb_size;
+    const char* ptr=buf.data();
+    memcpy(&out.idx, ptr, sizeof(size_t));
+    ptr+=sizeof(size_t);
+    out.found=*ptr;
+    ptr++;
+    memcpy(&recomb_size, ptr, sizeof(size_t));
+    ptr+=sizeof(size_t);
+    out.recomb_lines.assign(ptr, recomb_size);
+    ptr+=recomb_size;
+    out.desc_line.assign(ptr, buf.data()+buf.size()-ptr);
+    return out;
+}
+// Writes the output of all processes on rank 0, in the order of the branch
+// indices, as soon as all earlier branches are done
+class Ripple_Output_Writer {
+    FILE *desc_file;
+    FILE *recomb_file;
+    size_t next_idx;
+    size_t num_done;
+    size_t total_size;
+    std::map<size_t,Ripple_Output> pending;
+    std::mutex mutex;
+  public:
+    Ripple_Output_Writer(FILE *desc_file,FILE *recomb_file,size_t start_idx,size_t total_size):
+        desc_file(desc_file),recomb_file(recomb_file),next_idx(start_idx),num_done(0),total_size(total_size) {}
+    void add(Ripple_Output&& out) {
+        std::lock_guard<std::mutex> lk(mutex);
+        auto idx=out.idx;
+        pending.emplace(idx, std::move(out));
+        while (!pending.empty()&&pending.begin()->first==next_idx) {
+            auto& to_write=pending.begin()->second;
+            fputs(to_write.recomb_lines.c_str(), recomb_file);
+            fflush(recomb_file);
+            if (to_write.found) {
+                fputs(to_write.desc_line.c_str(), desc_file);
+                fflush(desc_file);
+                fprintf(stderr, "Done %zu/%zu branches [RECOMBINATION FOUND!]\n\n",
+                        ++num_done, total_size);
+            } else {
+                fprintf(stderr, "Done %zu/%zu branches\n\n", ++num_done,
+                        total_size);
+            }
+            pending.erase(pending.begin());
+            next_idx++;
+        }
+    }
+    size_t get_next_idx() const {
+        return next_idx;
+    }
+};
+// Splits branches s to e among processes, largest estimated cost first, each
+// going to the process with the least total cost so far. Every process
+// computes the same split.
+static std::vector<size_t> assign_branches(size_t s,size_t e,const std::vector<size_t>& costs,int this_rank,int process_count) {
+    std::vector<size_t> order;
+    for (size_t idx=s; idx<e; idx++) {
+        order.push_back(idx);
+    }
+    std::stable_sort(order.begin(), order.end(), [&costs](size_t a,size_t b) {
+        return costs[a]>costs[b];
+    });
+    std::vector<size_t> loads(process_count,0);
+    std::vector<size_t> assigned;
+    for (auto idx:order) {
+        int rank=std::min_element(loads.begin(), loads.end())-loads.begin();
+        loads[rank]+=costs[idx];
+        if (rank==this_rank) {
+            assigned.push_back(idx);
+        }
+    }
+    std::sort(assigned.begin(), assigned.end());
+    return assigned;
+}
 struct next_node {
-    std::vector<MAT::Node*>::const_iterator& iter;
-    std::vector<MAT::Node*>::const_iterator end;
-    MAT::Node* operator()(tbb::flow_control& fc) const {
+    std::vector<size_t>::const_iterator& iter;
+    std::vector<size_t>::const_iterator end;
+    size_t operator()(tbb::flow_control& fc) const {
         if (iter==end) {
             fc.stop();
+            return 0;
         }
         auto to_resturn=*iter;
         iter++;
@@ -51,29 +164,40 @@ struct next_node {
     }
 };
 struct Ripple_Pipeline {
-    const std::vector<MAT::Node*>& nodes_to_seach;
-    const std::vector<bool>& do_parallel;
-    const std::vector<int>& index_map;
+    const std::vector<MAT::Node*>& nodes_to_consider;
+    Pruned_Sample_Cache& sample_cache;
+    const Ripples_Search_Tree& search_tree;
     uint32_t branch_len;
     int min_range;
     int max_range;
     uint32_t num_threads;
     int parsimony_improvement;
     MAT::Tree& T;
-    const std::vector<Mapper_Info> &traversal_track;
-    const unsigned short tree_height;
-    Ripple_Result_Pack* operator()(MAT::Node* node_to_consider) const;
+    Ripple_Result_Pack* operator()(size_t idx) const;
 };
 struct Ripple_Finalizer {
-    FILE *desc_file;
-    FILE *recomb_file;
-    size_t& num_done;
-    size_t total_size;
+    Ripple_Output_Writer* writer;
     MAT::Tree& T;
 
     void operator()(Ripple_Result_Pack*) const;
 };
 int main(int argc, char **argv) {
+    int provided;
+    int this_rank;
+    int process_count;
+    auto init_result=MPI_Init_thread(&argc, &argv,MPI_THREAD_MULTIPLE,&provided);
+    if (init_result!=MPI_SUCCESS) {
+        fprintf(stderr, "MPI init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &this_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    //With more than one process, results are sent from tbb worker threads while rank 0 receives
+    //on another thread. A single process writes its results directly and only calls MPI from here.
+    if (process_count>1&&provided<MPI_THREAD_MULTIPLE) {
+        fprintf(stderr, "MPI library does not support MPI_THREAD_MULTIPLE, needed for more than one process\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
     po::variables_map vm = check_options(argc, argv);
     std::string input_mat_filename = vm["input-mat"].as<std::string>();
     std::string outdir = vm["outdir"].as<std::string>();
@@ -167,64 +291,54 @@ int main(int argc, char **argv) {
     for (auto elem : nodes_to_consider) {
         nodes_to_consider_vec.emplace_back(elem);
     }
-    std::sort(nodes_to_consider_vec.begin(), nodes_to_consider_vec.end());
+    // Order by DFS index, not by address, so that all processes see the
+    // same list of branches
+    std::sort(nodes_to_consider_vec.begin(), nodes_to_consider_vec.end(), [](const MAT::Node* a,const MAT::Node* b) {
+        return a->dfs_idx<b->dfs_idx;
+    });
     std::shuffle(nodes_to_consider_vec.begin(), nodes_to_consider_vec.end(),
                  std::default_random_engine(0));
 
     fprintf(stderr, "Found %zu long branches\n", nodes_to_consider.size());
     fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
 
-    fprintf(stderr, "Creating output files.\n");
-    boost::filesystem::path path(outdir);
-    if (!boost::filesystem::exists(path)) {
-        boost::filesystem::create_directory(path);
-    }
+    // Only rank 0 writes output files
+    FILE *desc_file = NULL;
+    FILE *recomb_file = NULL;
+    if (this_rank == 0) {
+        fprintf(stderr, "Creating output files.\n");
+        boost::filesystem::path path(outdir);
+        if (!boost::filesystem::exists(path)) {
+            boost::filesystem::create_directory(path);
+        }
 
-    path = boost::filesystem::canonical(outdir);
-    outdir = path.generic_string();
+        path = boost::filesystem::canonical(outdir);
+        outdir = path.generic_string();
 
-    auto desc_filename = outdir + "/descendants.tsv";
-    fprintf(stderr,
-            "Creating file %s to write descendants of recombinant nodes\n",
-            desc_filename.c_str());
-    FILE *desc_file = fopen(desc_filename.c_str(), "w");
-    fprintf(desc_file, "#node_id\tdescendants\n");
+        auto desc_filename = outdir + "/descendants.tsv";
+        fprintf(stderr,
+                "Creating file %s to write descendants of recombinant nodes\n",
+                desc_filename.c_str());
+        desc_file = fopen(desc_filename.c_str(), "w");
+        fprintf(desc_file, "#node_id\tdescendants\n");
 
-    auto recomb_filename = outdir + "/recombination.tsv";
-    fprintf(stderr, "Creating file %s to write recombination events\n",
-            recomb_filename.c_str());
-    FILE *recomb_file = fopen(recomb_filename.c_str(), "w");
-    fprintf(
-        recomb_file,
-        "#recomb_node_id\tbreakpoint-1_interval\tbreakpoint-2_interval\tdonor_"
-        "node_id\tdonor_is_sibling\tdonor_parsimony\tacceptor_node_"
-        "id\tacceptor_is_sibling\tacceptor_parsimony\toriginal_parsimony\tmin_"
-        "starting_parsimony\trecomb_parsimony\n");
-    fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
+        auto recomb_filename = outdir + "/recombination.tsv";
+        fprintf(stderr, "Creating file %s to write recombination events\n",
+                recomb_filename.c_str());
+        recomb_file = fopen(recomb_filename.c_str(), "w");
+        fprintf(
+            recomb_file,
+            "#recomb_node_id\tbreakpoint-1_interval\tbreakpoint-2_interval\tdonor_"
+            "node_id\tdonor_is_sibling\tdonor_parsimony\tacceptor_node_"
+            "id\tacceptor_is_sibling\tacceptor_parsimony\toriginal_parsimony\tmin_"
+            "starting_parsimony\trecomb_parsimony\n");
+        fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
+    }
 
     timer.Start();
-    std::vector<MAT::Node*> nodes_to_search;
-    nodes_to_search.reserve(dfs.size());
-    for (auto &node : dfs) {
-        if ((node->dfs_end_idx - node->dfs_idx) >= num_descendants) {
-            nodes_to_search.push_back(node);
-        }
-    }
-    std::vector<bool> do_parallel(dfs.size(),false);
-    std::vector<Mapper_Info> traversal_track;
-    unsigned short tree_height=0;
-    check_parallelizable(T.root,do_parallel,nodes_to_search.size()/num_threads,num_descendants,tree_height,traversal_track,0);
-    std::vector<int> index_map;
-    int node_to_search_idx=0;
-    index_map.reserve(dfs.size());
-    for (int dfs_idx = 0; dfs_idx <(int) dfs.size(); dfs_idx++) {
-        if (node_to_search_idx!=(int)nodes_to_search.size()&&(int)nodes_to_search[node_to_search_idx]->dfs_idx==dfs_idx) {
-            index_map.push_back(node_to_search_idx);
-            node_to_search_idx++;
-        } else {
-            index_map.push_back(-node_to_search_idx);
-        }
-    }
+    Ripples_Search_Tree search_tree(T, dfs, num_descendants, num_threads);
+    const auto& nodes_to_search = search_tree.nodes_to_search;
+    const auto& index_map = search_tree.index_map;
 
     fprintf(stderr, "%zu out of %zu nodes have enough descendant to be donor/acceptor",nodes_to_search.size(),dfs.size());
     size_t s = 0, e = nodes_to_consider.size();
@@ -236,82 +350,123 @@ int main(int argc, char **argv) {
         }
     }
 
+    // The mapper scores the searchable nodes outside the subtree of a
+    // branch against the mutations on the path from the root to the branch,
+    // which is used as the cost of the branch to balance processes
+    std::vector<size_t> costs(nodes_to_consider_vec.size());
+    auto num_search_before = [&](size_t dfs_idx) {
+        return (dfs_idx < index_map.size()) ? (size_t)std::abs(index_map[dfs_idx]) : nodes_to_search.size();
+    };
+    for (size_t idx = s; idx < e; idx++) {
+        auto node = nodes_to_consider_vec[idx];
+        size_t path_mutations = 0;
+        for (auto anc = node; anc != NULL; anc = anc->parent) {
+            path_mutations += anc->mutations.size();
+        }
+        size_t search_in_subtree = num_search_before(node->dfs_end_idx) - num_search_before(node->dfs_idx);
+        costs[idx] = (1 + path_mutations) * (1 + nodes_to_search.size() - search_in_subtree);
+    }
+    auto assigned = assign_branches(s, e, costs, this_rank, process_count);
+
     fprintf(stderr,
             "Running placement individually for %zu branches to identify "
             "potential recombination events.\n",
-            e - s);
+            assigned.size());
+    if (process_count > 1) {
+        fprintf(stderr, "Process %d of %d searches %zu of %zu branches.\n",
+                this_rank, process_count, assigned.size(), e - s);
+    }
+
+    Ripple_Output_Writer* writer = NULL;
+    std::thread receiver;
+    if (this_rank == 0) {
+        writer = new Ripple_Output_Writer(desc_file, recomb_file, s, nodes_to_consider_vec.size());
+    }
+    if (this_rank == 0 && process_count > 1) {
+        // Collect the output of the other processes while searching
+        receiver = std::thread([writer, process_count]() {
+            int num_ranks_done = 0;
+            std::vector<char> buf;
+            while (num_ranks_done < process_count - 1) {
+                MPI_Status status;
+                int count;
+                MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_CHAR, &count);
+                buf.resize(count);
+                MPI_Recv(buf.data(), count, MPI_CHAR, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                if (status.MPI_TAG == RIPPLE_DONE_TAG) {
+                    num_ranks_done++;
+                } else {
+                    writer->add(parse_output(buf));
+                }
+            }
+        });
+    }
 
-    size_t num_done = 0;
     //FILE* before_joining_fh=fopen("before_join_test","w");
-    std::vector<MAT::Node*>::const_iterator cur_iter=nodes_to_consider_vec.begin()+s;
-    std::vector<MAT::Node*>::const_iterator end=nodes_to_consider_vec.begin()+e;
+    Pruned_Sample_Cache sample_cache;
+    std::vector<size_t>::const_iterator cur_iter=assigned.begin();
+    std::vector<size_t>::const_iterator end=assigned.end();
     tbb::parallel_pipeline(
-        4, tbb::make_filter<void, MAT::Node *>(tbb::filter::serial_in_order,
+        4, tbb::make_filter<void, size_t>(tbb::filter::serial_in_order,
                 next_node{cur_iter, end}) &
-        tbb::make_filter<MAT::Node *, Ripple_Result_Pack *>(
+        tbb::make_filter<size_t, Ripple_Result_Pack *>(
             tbb::filter::parallel,
-            Ripple_Pipeline{nodes_to_search, do_parallel, index_map,
+            Ripple_Pipeline{nodes_to_consider_vec, sample_cache, search_tree,
                             branch_len, min_range, max_range,
-                            num_threads, parsimony_improvement, T,traversal_track,tree_height}) &
+                            num_threads, parsimony_improvement, T}) &
         tbb::make_filter<Ripple_Result_Pack *, void>(
             tbb::filter::serial_in_order,
-            Ripple_Finalizer{desc_file, recomb_file, num_done,
-                             nodes_to_consider_vec.size(), T}));
-    fclose(desc_file);
-    fclose(recomb_file);
+            Ripple_Finalizer{writer, T}));
+
+    if (this_rank == 0) {
+        if (receiver.joinable()) {
+            receiver.join();
+        }
+        if (writer->get_next_idx() != e) {
+            fprintf(stderr, "ERROR: results missing for branches from index %zu.\n", writer->get_next_idx());
+        }
+        delete writer;
+        fclose(desc_file);
+        fclose(recomb_file);
+    } else {
+        MPI_Send(NULL, 0, MPI_CHAR, 0, RIPPLE_DONE_TAG, MPI_COMM_WORLD);
+    }
 
     fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
+    MPI_Finalize();
 }
-Ripple_Result_Pack* Ripple_Pipeline::operator()(MAT::Node* node_to_consider) const {
+Ripple_Result_Pack* Ripple_Pipeline::operator()(size_t idx) const {
+    auto node_to_consider = nodes_to_consider[idx];
     fprintf(stderr, "At node id: %s\n",
             node_to_consider->identifier.c_str());
 
     int orig_parsimony = (int)node_to_consider->mutations.size();
 
-    Pruned_Sample pruned_sample(node_to_consider);
-    // Find mutations on the node to prune
-    auto node_to_root = T.rsearch(node_to_consider->identifier, true);
-    for (auto curr : node_to_root) {
-        for (auto m : curr->mutations) {
-            pruned_sample.add_mutation(m);
-        }
-    }
-    //==== new mapper
-    Ripples_Mapper_Output_Interface mapper_out;
-    ripples_mapper(pruned_sample, mapper_out, nodes_to_seach.size(),index_map,do_parallel, traversal_track,tree_height,T.root,node_to_consider);
-    //==== END new mapper
-    tbb::concurrent_vector<Recomb_Interval> valid_pairs_con;
-    ripplrs_merger(pruned_sample, index_map,nodes_to_seach, nodes_to_seach.size(),
-                   orig_parsimony - parsimony_improvement, T,
-                   valid_pairs_con, mapper_out, num_threads, branch_len,
-                   min_range, max_range);
-    std::vector<Recomb_Interval> temp(std::vector<Recomb_Interval>(valid_pairs_con.begin(),valid_pairs_con.end()));
-    std::sort(temp.begin(),temp.end(),interval_sorter());
-    /*       for(auto p: temp) {
-               std::string end_range_high_str = (p.end_range_high == 1e9) ? "GENOME_SIZE" : std::to_string(p.end_range_high);
-                           fprintf(
-                   before_joining_fh,
-                   "%s\t(%i,%i)\t(%i,%s)\t%s\t%s\n",
-                   node_to_consider->identifier.c_str(), p.start_range_low,
-                   p.start_range_high, p.end_range_low, end_range_high_str.c_str(),
-                   p.d.node->identifier.c_str(), p.a.node->identifier.c_str());
-               fflush(before_joining_fh);
-           }*/
-    return (new Ripple_Result_Pack{combine_intervals(temp),node_to_consider,orig_parsimony});
+    Ripples_Merger_Stats merger_stats;
+    auto intervals = find_recombination(node_to_consider, T, search_tree, sample_cache,
+                                        parsimony_improvement, num_threads, branch_len,
+                                        min_range, max_range, merger_stats);
+    fprintf(stderr, "Node %s: searched %zu breakpoint pairs, pruned %zu by parsimony bounds\n",
+            node_to_consider->identifier.c_str(), merger_stats.searched, merger_stats.pruned);
+    return (new Ripple_Result_Pack{intervals,node_to_consider,orig_parsimony,idx});
 }
 void Ripple_Finalizer::operator()(Ripple_Result_Pack* result) const {
     // print combined pairs
     auto & valid_pairs=result->intervals;
     auto node_to_consider=result->node_to_consider;
     auto orig_parsimony=result->orig_parsimony;
+    Ripple_Output out;
+    out.idx=result->idx;
+    out.found=!valid_pairs.empty();
     for (auto p : valid_pairs) {
         std::string end_range_high_str =
             (p.end_range_high == 1e9) ? "GENOME_SIZE"
             : std::to_string(p.end_range_high);
         auto donor_adj_parsimony=p.d.node_parsimony+!p.d.is_sibling;
         auto acceptor_adj_parsimony=p.a.node_parsimony+!p.a.is_sibling;
-        fprintf(
-            recomb_file,
+        append_printf(
+            out.recomb_lines,
             "%s\t(%i,%i)\t(%i,%s)\t%s\t%c\t%i\t%s\t%c\t%i\t%i\t%i\t%i\n",
             node_to_consider->identifier.c_str(), p.start_range_low,
             p.start_range_high, p.end_range_low, end_range_high_str.c_str(),
@@ -321,21 +476,20 @@ void Ripple_Finalizer::operator()(Ripple_Result_Pack* result) const {
             std::min(
         {orig_parsimony, donor_adj_parsimony, acceptor_adj_parsimony}),
         p.d.parsimony + p.a.parsimony);
-        fflush(recomb_file);
     }
 
-    if (!valid_pairs.empty()) {
-        fprintf(desc_file, "%s\t", node_to_consider->identifier.c_str());
+    if (out.found) {
+        out.desc_line=node_to_consider->identifier+"\t";
         for (auto l : T.get_leaves(node_to_consider->identifier)) {
-            fprintf(desc_file, "%s,", l->identifier.c_str());
+            out.desc_line+=l->identifier+",";
         }
-        fprintf(desc_file, "\n");
-        fflush(desc_file);
-        fprintf(stderr, "Done %zu/%zu branches [RECOMBINATION FOUND!]\n\n",
-                ++num_done, total_size);
-    } else {
-        fprintf(stderr, "Done %zu/%zu branches\n\n", ++num_done,
-                total_size);
+        out.desc_line+="\n";
     }
     delete result;
-}
\ No newline at end of file
+    // Rank 0 writes its own output, other processes send it to rank 0
+    if (writer) {
+        writer->add(std::move(out));
+    } else {
+        send_output(out);
+    }
+}
@@ -20,6 +20,76 @@ Pruned_Sample::Pruned_Sample(MAT::Node* name) {
     positions.clear();
 }
 
+// Mutations of node relative to the reference given the mutations of its
+// ancestor stop (NULL for the root), keeping the mutation closest to node at
+// each position, in the same form as Pruned_Sample::add_mutation
+static std::vector<MAT::Mutation> apply_path(const MAT::Node* node, const MAT::Node* stop,
+        const std::vector<MAT::Mutation>& stop_mutations) {
+    std::vector<MAT::Mutation> path_mutations;
+    for (auto curr = node; curr != stop; curr = curr->parent) {
+        path_mutations.insert(path_mutations.end(), curr->mutations.begin(), curr->mutations.end());
+    }
+    // Stable sort keeps the mutation closest to node first at each position
+    std::stable_sort(path_mutations.begin(), path_mutations.end());
+    path_mutations.erase(std::unique(path_mutations.begin(), path_mutations.end(),
+    [](const MAT::Mutation& a, const MAT::Mutation& b) {
+        return a.position == b.position;
+    }), path_mutations.end());
+
+    std::vector<MAT::Mutation> result;
+    result.reserve(stop_mutations.size() + path_mutations.size());
+    auto stop_iter = stop_mutations.begin();
+    for (auto mut : path_mutations) {
+        while (stop_iter != stop_mutations.end() && stop_iter->position < mut.position) {
+            result.push_back(*stop_iter);
+            stop_iter++;
+        }
+        if (stop_iter != stop_mutations.end() && stop_iter->position == mut.position) {
+            stop_iter++;
+        }
+        // If not reversal to reference allele
+        if (mut.ref_nuc != mut.mut_nuc) {
+            mut.par_nuc = mut.ref_nuc;
+            result.push_back(mut);
+        }
+    }
+    result.insert(result.end(), stop_iter, stop_mutations.end());
+    return result;
+}
+
+const MAT::Node* Pruned_Sample_Cache::closest_checkpoint_above(const MAT::Node* node) {
+    auto anc = node->parent;
+    while (anc != NULL && !is_checkpoint(anc)) {
+        anc = anc->parent;
+    }
+    return anc;
+}
+
+Pruned_Sample_Cache::State Pruned_Sample_Cache::get_state(const MAT::Node* checkpoint) {
+    auto iter = checkpoints.find(checkpoint);
+    if (iter != checkpoints.end()) {
+        return iter->second;
+    }
+    auto anc = closest_checkpoint_above(checkpoint);
+    State state;
+    if (anc == NULL) {
+        state = std::make_shared<const std::vector<MAT::Mutation>>(apply_path(checkpoint, NULL, std::vector<MAT::Mutation>()));
+    } else {
+        state = std::make_shared<const std::vector<MAT::Mutation>>(apply_path(checkpoint, anc, *get_state(anc)));
+    }
+    // Another thread may have computed the same state, keep the first one
+    return checkpoints.insert(std::make_pair(checkpoint, state)).first->second;
+}
+
+void Pruned_Sample_Cache::fill(Pruned_Sample& sample) {
+    auto anc = closest_checkpoint_above(sample.sample_name);
+    if (anc == NULL) {
+        sample.sample_mutations = apply_path(sample.sample_name, NULL, std::vector<MAT::Mutation>());
+    } else {
+        sample.sample_mutations = apply_path(sample.sample_name, anc, *get_state(anc));
+    }
+}
+
 std::vector<Recomb_Interval>
 combine_intervals(std::vector<Recomb_Interval> pair_list) {
     // combine second interval
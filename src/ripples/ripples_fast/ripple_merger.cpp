@@ -1,7 +1,9 @@
 #include "ripples.hpp"
 #include "src/mutation_annotated_tree.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <climits>
 #include <stdio.h>
 #include <emmintrin.h>
 #include <vector>
@@ -211,8 +213,16 @@ static void find_pairs(
     int parsimony_threshold,
     const MAT::Tree &T, tbb::concurrent_vector<Recomb_Interval> &valid_pairs) {
     bool has_printed = false;
+    if (acceptor_nodes.empty()) {
+        return;
+    }
 
     for (auto d : donor_nodes) {
+        // Donors are sorted by parsimony, no later donor can pair with even
+        // the best acceptor
+        if (parsimony_threshold < d.parsimony + acceptor_nodes[0].parsimony) {
+            break;
+        }
         /*if (T.is_ancestor(nid_to_consider, d.name)) {
             //raise(SIGTRAP);
             continue;
@@ -324,6 +334,38 @@ static void find_pairs(
         }
     }
 }
+// Donor parsimony of a node can only grow with j and shrink with i, and the
+// reverse for acceptor parsimony. So once no node is a good enough donor at
+// (i,j), no pair with the same i and a larger j can be valid, and once no node
+// is a good enough acceptor, no pair with the same j and a larger i can be.
+// The smallest such j for each i and i for each j found so far are kept here.
+struct Merger_Bounds {
+    std::vector<std::atomic<int>> donor_cutoff_j;
+    std::vector<std::atomic<int>> acceptor_cutoff_i;
+    std::atomic<size_t> searched;
+    std::atomic<size_t> pruned;
+    Merger_Bounds(size_t num_mutations)
+        : donor_cutoff_j(num_mutations + 1), acceptor_cutoff_i(num_mutations + 1),
+          searched(0), pruned(0) {
+        for (auto &cutoff : donor_cutoff_j) {
+            cutoff.store(INT_MAX, std::memory_order_relaxed);
+        }
+        for (auto &cutoff : acceptor_cutoff_i) {
+            cutoff.store(INT_MAX, std::memory_order_relaxed);
+        }
+    }
+    bool is_pruned(int i, int j) const {
+        return j >= donor_cutoff_j[i].load(std::memory_order_relaxed) ||
+               i >= acceptor_cutoff_i[j].load(std::memory_order_relaxed);
+    }
+    static void lower_cutoff(std::atomic<int> &cutoff, int new_cutoff) {
+        int old_cutoff = cutoff.load(std::memory_order_relaxed);
+        while (new_cutoff < old_cutoff &&
+                !cutoff.compare_exchange_weak(old_cutoff, new_cutoff,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+};
 struct check_breakpoint {
     const Ripples_Mapper_Output_Interface &out_ifc;
     const std::vector<MAT::Mutation> &pruned_sample_mutations;
@@ -334,12 +376,20 @@ struct check_breakpoint {
     const std::vector<MAT::Node *> &nodes_to_search;
     const MAT::Tree &T;
     tbb::concurrent_vector<Recomb_Interval> &valid_pairs;
+    Merger_Bounds &bounds;
     void operator()(std::pair<int,int> in) const {
         int i=in.first;
         int j=in.second;
         if (i==2&&j==14) {
             //raise(SIGTRAP);
         }
+        // The bound may have been set by a pair checked after this one
+        // was generated
+        if (bounds.is_pruned(i, j)) {
+            bounds.pruned++;
+            return;
+        }
+        bounds.searched++;
 
         size_t num_mutations = pruned_sample_mutations.size();
         std::vector<int> donor_filtered_idx;
@@ -361,6 +411,12 @@ struct check_breakpoint {
                               acceptor_filtered_par_score, pasimony_threshold);
         auto donor_min = std::min(min_first.first, min_second.first);
         auto acceptor_min=std::min(min_first.second,min_second.second);
+        if (donor_min>pasimony_threshold) {
+            Merger_Bounds::lower_cutoff(bounds.donor_cutoff_j[i], j);
+        }
+        if (acceptor_min>pasimony_threshold) {
+            Merger_Bounds::lower_cutoff(bounds.acceptor_cutoff_i[j], i);
+        }
         if (acceptor_min+donor_min>pasimony_threshold) {
             return;
         }
@@ -391,18 +447,29 @@ struct search_position {
     int min_range;
     int max_range;
     int last_i;
+    Merger_Bounds &bounds;
     bool is_j_end_of_range(int start_range_high, int total_size) const {
         return j >= total_size || total_size - (j - i) < branch_len ||
                pruned_sample_mutations[j-1].position - start_range_high >
                max_range;
     }
     std::pair<int, int> operator()(tbb::flow_control &fc) const {
+        while (advance()) {
+            if (!bounds.is_pruned(i, j)) {
+                return std::make_pair(i, j);
+            }
+            bounds.pruned++;
+        }
+        fc.stop();
+        return std::make_pair(0, 0);
+    }
+    // Move to the next breakpoint pair, false if there is none left
+    bool advance() const {
         int start_range_high=0;// = pruned_sample_mutations[i].position;
         int total_size = pruned_sample_mutations.size();
         // i end
         if (i > last_i) {
-            fc.stop();
-            return std::make_pair(0, 0);
+            return false;
         }
         j++;
         // j end
@@ -413,8 +480,7 @@ struct search_position {
         while (i==-1||is_j_end_of_range(start_range_high, total_size)) {
             i++;
             if (i > last_i) {
-                fc.stop();
-                return std::make_pair(0, 0);
+                return false;
             }
             start_range_high = pruned_sample_mutations[i].position;
             j = i + branch_len;
@@ -423,11 +489,11 @@ struct search_position {
                 j++;
             }
         }
-        return std::make_pair(i, j);
+        return true;
     }
 };
 
-void ripplrs_merger(const Pruned_Sample &pruned_sample,
+Ripples_Merger_Stats ripplrs_merger(const Pruned_Sample &pruned_sample,
                     const std::vector<int> & idx_map,
                     const std::vector<MAT::Node *> &nodes_to_search,
                     size_t node_size, int pasimony_threshold,
@@ -449,21 +515,22 @@ void ripplrs_merger(const Pruned_Sample &pruned_sample,
     while (last_i > 0 && sample_mutations[last_i].position > last_pos) {
         last_i--;
     }
+    Merger_Bounds bounds(sample_mutations.size());
 
     tbb::parallel_pipeline(
         nthreads + 1,
         tbb::make_filter<void, std::pair<int, int>>(
             tbb::filter::serial_in_order,
             search_position{sample_mutations, i, j, branch_len, min_range,
-                            max_range, last_i}) &
+                            max_range, last_i, bounds}) &
         tbb::make_filter<std::pair<int, int>, void>(
             tbb::filter::parallel,
             check_breakpoint{out_ifc, sample_mutations,
                              skip_start_idx,skip_end_idx,
                              node_size, pasimony_threshold,
-                             nodes_to_search, T, valid_pairs})
+                             nodes_to_search, T, valid_pairs, bounds})
 
     );
-
+    return Ripples_Merger_Stats{bounds.searched.load(), bounds.pruned.load()};
 
 }
\ No newline at end of file
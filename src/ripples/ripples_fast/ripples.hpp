@@ -2,6 +2,8 @@
 #include <src/mutation_annotated_tree.hpp>
 #include <signal.h>
 #include <iostream>
+#include <memory>
+#include <tbb/concurrent_unordered_map.h>
 
 namespace po = boost::program_options;
 namespace MAT = Mutation_Annotated_Tree;
@@ -76,6 +78,24 @@ struct Pruned_Sample {
     Pruned_Sample(MAT::Node* name);
 };
 
+// Fills the mutations of a pruned sample without walking the whole path to
+// the root. The mutations of ancestors every CHECKPOINT_INTERVAL levels are
+// computed once and shared, so each branch only walks up to its closest such
+// ancestor and merges the mutations on the way. Does not fill positions.
+class Pruned_Sample_Cache {
+    static const size_t CHECKPOINT_INTERVAL = 8;
+    typedef std::shared_ptr<const std::vector<MAT::Mutation>> State;
+    tbb::concurrent_unordered_map<const MAT::Node*, State> checkpoints;
+
+    static bool is_checkpoint(const MAT::Node* node) {
+        return (node->parent == NULL) || (node->level % CHECKPOINT_INTERVAL == 0);
+    }
+    static const MAT::Node* closest_checkpoint_above(const MAT::Node* node);
+    State get_state(const MAT::Node* checkpoint);
+  public:
+    void fill(Pruned_Sample& sample);
+};
+
 struct Recomb_Node {
     const MAT::Node* node;
     int node_parsimony;
@@ -130,7 +150,13 @@ void ripples_mapper(const Pruned_Sample &sample,
                     const unsigned short tree_height,
                     const MAT::Node *root,
                     const MAT::Node *skip_node) ;
-void ripplrs_merger(const Pruned_Sample &pruned_sample,
+struct Ripples_Merger_Stats {
+    // breakpoint pairs whose donors and acceptors were scanned
+    size_t searched;
+    // breakpoint pairs skipped by parsimony bounds
+    size_t pruned;
+};
+Ripples_Merger_Stats ripplrs_merger(const Pruned_Sample &pruned_sample,
                     const std::vector<int> & idx_map,
                     const std::vector<MAT::Node *> &nodes_to_search,
                     size_t node_size, int pasimony_threshold,
@@ -144,4 +170,28 @@ size_t check_parallelizable(const MAT::Node *root,
                             size_t parallel_threshold,
                             size_t check_threshold,
                             unsigned short& tree_height,
-                            std::vector<Mapper_Info>& traversal_track,unsigned short level);
\ No newline at end of file
+                            std::vector<Mapper_Info>& traversal_track,unsigned short level);
+// Nodes with enough descendants to be donor or acceptor, and how the mapper
+// traverses them. Built once per tree and shared by all branches.
+struct Ripples_Search_Tree {
+    std::vector<MAT::Node*> nodes_to_search;
+    // index of each node (by dfs_idx) in nodes_to_search, or minus the number
+    // of searched nodes before it if it is not searched
+    std::vector<int> index_map;
+    std::vector<bool> do_parallel;
+    std::vector<Mapper_Info> traversal_track;
+    unsigned short tree_height;
+
+    Ripples_Search_Tree(const MAT::Tree& T, const std::vector<MAT::Node*>& dfs,
+                        uint32_t num_descendants, uint32_t num_threads);
+};
+
+// Searches for donor/acceptor pairs for node_to_consider as the recombinant
+// and returns the combined breakpoint intervals, sorted by breakpoint
+std::vector<Recomb_Interval> find_recombination(MAT::Node* node_to_consider,
+        const MAT::Tree& T,
+        const Ripples_Search_Tree& search_tree,
+        Pruned_Sample_Cache& sample_cache,
+        int parsimony_improvement, int num_threads,
+        int branch_len, int min_range, int max_range,
+        Ripples_Merger_Stats& stats);
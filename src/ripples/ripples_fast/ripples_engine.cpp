@@ -0,0 +1,64 @@
+#include "ripples.hpp"
+#include <algorithm>
+#include <tbb/concurrent_vector.h>
+
+struct interval_sorter {
+    bool operator()(Recomb_Interval& a,Recomb_Interval& b) {
+        if (a.start_range_high<b.start_range_high) {
+            return true;
+        } else if(a.start_range_high==b.start_range_high&&a.end_range_low<b.end_range_low) {
+            return true;
+        }
+        return false;
+    }
+};
+
+Ripples_Search_Tree::Ripples_Search_Tree(const MAT::Tree& T, const std::vector<MAT::Node*>& dfs,
+        uint32_t num_descendants, uint32_t num_threads)
+    : do_parallel(dfs.size(), false), tree_height(0) {
+    nodes_to_search.reserve(dfs.size());
+    for (auto &node : dfs) {
+        if ((node->dfs_end_idx - node->dfs_idx) >= num_descendants) {
+            nodes_to_search.push_back(node);
+        }
+    }
+    check_parallelizable(T.root,do_parallel,nodes_to_search.size()/num_threads,num_descendants,tree_height,traversal_track,0);
+    int node_to_search_idx=0;
+    index_map.reserve(dfs.size());
+    for (int dfs_idx = 0; dfs_idx <(int) dfs.size(); dfs_idx++) {
+        if (node_to_search_idx!=(int)nodes_to_search.size()&&(int)nodes_to_search[node_to_search_idx]->dfs_idx==dfs_idx) {
+            index_map.push_back(node_to_search_idx);
+            node_to_search_idx++;
+        } else {
+            index_map.push_back(-node_to_search_idx);
+        }
+    }
+}
+
+std::vector<Recomb_Interval> find_recombination(MAT::Node* node_to_consider,
+        const MAT::Tree& T,
+        const Ripples_Search_Tree& search_tree,
+        Pruned_Sample_Cache& sample_cache,
+        int parsimony_improvement, int num_threads,
+        int branch_len, int min_range, int max_range,
+        Ripples_Merger_Stats& stats) {
+    int orig_parsimony = (int)node_to_consider->mutations.size();
+    const auto& nodes_to_search = search_tree.nodes_to_search;
+
+    Pruned_Sample pruned_sample(node_to_consider);
+    // Find mutations on the node to prune
+    sample_cache.fill(pruned_sample);
+    //==== new mapper
+    Ripples_Mapper_Output_Interface mapper_out;
+    ripples_mapper(pruned_sample, mapper_out, nodes_to_search.size(),search_tree.index_map,search_tree.do_parallel,
+                   search_tree.traversal_track,search_tree.tree_height,T.root,node_to_consider);
+    //==== END new mapper
+    tbb::concurrent_vector<Recomb_Interval> valid_pairs_con;
+    stats = ripplrs_merger(pruned_sample, search_tree.index_map,nodes_to_search, nodes_to_search.size(),
+                           orig_parsimony - parsimony_improvement, T,
+                           valid_pairs_con, mapper_out, num_threads, branch_len,
+                           min_range, max_range);
+    std::vector<Recomb_Interval> temp(valid_pairs_con.begin(),valid_pairs_con.end());
+    std::sort(temp.begin(),temp.end(),interval_sorter());
+    return combine_intervals(temp);
+}
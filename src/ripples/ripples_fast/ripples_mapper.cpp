@@ -190,6 +190,10 @@ serial_mapper(const std::vector<Ripples_Mapper_Mut> &parent_muts,
                   traversal_track[start_idx].end,
                   traversal_track[start_idx].is_leaf,
                   stack.size()==1 ? parent_muts : stack[stack.size()-2], cfg);
+    if (start_idx==0) {
+        //root mutations are not counted, its children map against the sample itself, as in Mapper_Op
+        stack.back()=parent_muts;
+    }
 
     for (auto cur_idx=start_idx+1; cur_idx<end_idx; cur_idx++) {
         if (cur_idx==cfg.skip_idx) {
@@ -51,9 +51,12 @@ static void clean_tree_for_placement(MAT::Tree& tree){
         }
     }
 }
+//Nodes not searched when the optimization time of last batch ran out are in pending_nodes (as node id),
+//they are searched first in this batch, and nodes not searched this time are left in it for next batch
 void leader_thread_optimization(MAT::Tree& tree,std::vector<mutated_t>& position_wise_out,
-                                std::atomic_size_t& curr_idx,int& optimization_radius, size_t start_idx,FILE* ignored_file,float desired_optimization_msec,bool is_last) {
-    size_t last_parsimony_score=SIZE_MAX;
+                                std::atomic_size_t& curr_idx,int& optimization_radius, size_t start_idx,FILE* ignored_file,float desired_optimization_msec,bool is_last,
+                                std::vector<size_t>& pending_nodes) {
+    size_t parsimony_score=0;
     std::default_random_engine g;
     auto optimiation_start=std::chrono::steady_clock::now();
     auto optimization_end=optimiation_start+std::chrono::milliseconds((long)desired_optimization_msec);
@@ -79,11 +82,15 @@ void leader_thread_optimization(MAT::Tree& tree,std::vector<mutated_t>& position
                 tree.MPI_send_tree();
             }
         }
+        if (is_first) {
+            //kept up to date with score change of moves applied afterwards
+            parsimony_score=tree.get_parsimony_score();
+        }
         is_first=false;
         if (is_last) {
             optimization_radius=-optimization_radius;
         }
-        fprintf(stderr, "Main parsimony score %zu",tree.get_parsimony_score());
+        fprintf(stderr, "Main parsimony score %zu",parsimony_score);
         fprintf(stderr, "Main sent optimization prep done\n");
         std::vector<size_t> node_to_search_idx;
         find_moved_node_neighbors(optimization_radius,
@@ -91,17 +98,46 @@ void leader_thread_optimization(MAT::Tree& tree,std::vector<mutated_t>& position
                                   curr_idx.load(), node_to_search_idx);
         fprintf(stderr, "Main found nodes to move\n");
         std::shuffle(node_to_search_idx.begin(),node_to_search_idx.end(),g);
+        if (!pending_nodes.empty()) {
+            //resume nodes left from last batch, dfs index are assigned by find_moved_node_neighbors
+            std::vector<bool> queued(tree.get_size_upper(),false);
+            for (auto idx : node_to_search_idx) {
+                queued[idx]=true;
+            }
+            std::vector<size_t> resumed_idx;
+            for (auto node_id : pending_nodes) {
+                auto node=tree.get_node(node_id);
+                if (node&&!queued[node->dfs_index]) {
+                    queued[node->dfs_index]=true;
+                    resumed_idx.push_back(node->dfs_index);
+                }
+            }
+            fprintf(stderr, "Resuming %zu nodes not searched in last batch\n",resumed_idx.size());
+            node_to_search_idx.insert(node_to_search_idx.begin(),resumed_idx.begin(),resumed_idx.end());
+            pending_nodes.clear();
+        }
 
         while (!node_to_search_idx.empty()) {
             std::vector<size_t> deferred_nodes_out;
             adjust_all(tree);
             fprintf(stderr, "Main sent tree_optimizing\n");
-            optimize_tree_main_thread(
-                node_to_search_idx, tree, optimization_radius, ignored_file,
-                false, 1, deferred_nodes_out, distributed, optimization_end, true,
-                true, true);
+            //searchers stop at optimization_end, and nodes they have not searched are deferred
+            auto score_change=optimize_tree_main_thread(
+                                  node_to_search_idx, tree, optimization_radius, ignored_file,
+                                  false, 1, deferred_nodes_out, distributed, optimization_end, true,
+                                  true, true);
+            parsimony_score+=score_change;
+            fprintf(stderr, "Last parsimony score %zu\n",parsimony_score);
+            distributed = false;
+            if(score_change>=0
+                    || std::chrono::steady_clock::now()>optimization_end) {
+                timeout=true;
+                pending_nodes=std::move(deferred_nodes_out);
+                break;
+            }
             node_to_search_idx.clear();
-            auto dfs = tree.depth_first_expansion();
+            //dfs index of deferred nodes after the moves
+            tree.get_dfs_order();
             node_to_search_idx.reserve(deferred_nodes_out.size());
             for (auto idx : deferred_nodes_out) {
                 auto node=tree.get_node(idx);
@@ -109,15 +145,6 @@ void leader_thread_optimization(MAT::Tree& tree,std::vector<mutated_t>& position
                     node_to_search_idx.push_back(node->dfs_index);
                 }
             }
-            distributed = false;
-            auto new_parsimony_score=tree.get_parsimony_score();
-            fprintf(stderr, "Last parsimony score %lu\n",new_parsimony_score);
-            if(new_parsimony_score>=last_parsimony_score
-                    || std::chrono::steady_clock::now()>optimization_end) {
-                timeout=true;
-                break;
-            }
-            last_parsimony_score=new_parsimony_score;
         }
         if (is_last) {
             optimization_radius=-2*optimization_radius;
@@ -258,6 +285,7 @@ static int leader_thread(
         idx_map_ptr=&idx_map;
     }
     std::atomic_size_t curr_idx(0);
+    std::vector<size_t> pending_optimization_nodes;
     FILE* ignored_file=fopen("/dev/null", "w");
     use_bound=true;
     //samples_to_place.resize(1000);
@@ -292,7 +320,8 @@ static int leader_thread(
         }
         if (options.initial_optimization_radius > 0) {
             leader_thread_optimization(tree, position_wise_out, curr_idx, optimization_radius,
-                                       sample_start_idx, ignored_file,is_last?60000*options.last_optimization_minutes:options.desired_optimization_msec,is_last);
+                                       sample_start_idx, ignored_file,is_last?60000*options.last_optimization_minutes:options.desired_optimization_msec,is_last,
+                                       pending_optimization_nodes);
             tree.check_leaves();
         }
         if (curr_idx<samples_to_place.size()) {
@@ -85,12 +85,12 @@ static void n_skiped_sibling(
     auto concensus_mut=mut.get_mut_one_hot()&mut.get_par_one_hot();
     if (!concensus_mut) {
         concensus_mut=1<<__builtin_ctz(mut.get_mut_one_hot());
-        assert(shared_mutations.empty()||shared_mutations.back().get_position()<mut.get_position());
+        assert(shared_mutations.empty()||shared_mutations.back().get_sort_key()<mut.get_sort_key());
         shared_mutations.push_back(MAT::Mutation(mut.get_chromIdx(),mut.get_position(),mut.get_par_one_hot(),concensus_mut));
         shared_mutations.back().set_descendant_mut(mut.get_descendant_mut());
         assert(shared_mutations.back().get_descendant_mut()&shared_mutations.back().get_mut_one_hot());
     }
-    assert(splitted_mutations.empty()||splitted_mutations.back().get_position()<mut.get_position());
+    assert(splitted_mutations.empty()||splitted_mutations.back().get_sort_key()<mut.get_sort_key());
     splitted_mutations.push_back(mut);
     splitted_mutations.back().set_par_one_hot(concensus_mut);
 }
@@ -98,12 +98,12 @@ static void sample_check_mutation(
     const std::vector<To_Place_Sample_Mutation> &sample_mutations,
     const MAT::Mutations_Collection &splitted_mutations,
     const MAT::Mutations_Collection &shared_mutations,
-    int position
+    uint64_t key
 ) {
 #ifdef DETAILED_MERGER_CHECK
-    assert(shared_mutations.empty()||shared_mutations.mutations.back().get_position()<position);
-    assert(splitted_mutations.empty()||splitted_mutations.mutations.back().get_position()<position);
-    assert(sample_mutations.empty()||sample_mutations.back().position<position);
+    assert(shared_mutations.empty()||shared_mutations.mutations.back().get_sort_key()<key);
+    assert(splitted_mutations.empty()||splitted_mutations.mutations.back().get_sort_key()<key);
+    assert(sample_mutations.empty()||sample_mutations.back().get_sort_key()<key);
 #endif
 }
 static void sample_mut_check_mutation(
@@ -113,9 +113,9 @@ static void sample_mut_check_mutation(
     const To_Place_Sample_Mutation& mut
 ) {
 #ifdef DETAILED_MERGER_CHECK
-    assert(shared_mutations.empty()||shared_mutations.mutations.back().get_position()<=mut.get_end_range());
-    assert(splitted_mutations.empty()||splitted_mutations.mutations.back().get_position()<=mut.get_end_range());
-    assert(sample_mutations.empty()||sample_mutations.back().position<mut.position);
+    assert(shared_mutations.empty()||shared_mutations.mutations.back().get_sort_key()<=mut.get_end_range_key());
+    assert(splitted_mutations.empty()||splitted_mutations.mutations.back().get_sort_key()<=mut.get_end_range_key());
+    assert(sample_mutations.empty()||sample_mutations.back().get_sort_key()<mut.get_sort_key());
 #endif
 }
 struct Down_Sibling_Hook {
@@ -149,12 +149,12 @@ struct Down_Sibling_Hook {
         }
     }
     void target_node_only(const MAT::Mutation &mut) {
-        sample_check_mutation(sample_mutations, splitted_mutations, shared_mutations, mut.get_position());
+        sample_check_mutation(sample_mutations, splitted_mutations, shared_mutations, mut.get_sort_key());
         assert(mut.get_mut_one_hot() != mut.get_par_one_hot());
         splitted_mutations.push_back(mut);
     }
     void target_N_skiped(const MAT::Mutation &mut) {
-        sample_check_mutation(sample_mutations, splitted_mutations, shared_mutations, mut.get_position());
+        sample_check_mutation(sample_mutations, splitted_mutations, shared_mutations, mut.get_sort_key());
         n_skiped_sibling(splitted_mutations, shared_mutations, mut);
     }
     void both(const To_Place_Sample_Mutation &sample_mut,
@@ -163,8 +163,8 @@ struct Down_Sibling_Hook {
             fputc('a', stderr);
         }*/
         assert(sample_mut.position!=0xf);
-        assert(sample_mut.position==target_mut.get_position());
-        sample_check_mutation(sample_mutations, splitted_mutations, shared_mutations, sample_mut.position);
+        assert(sample_mut.get_sort_key()==target_mut.get_sort_key());
+        sample_check_mutation(sample_mutations, splitted_mutations, shared_mutations, sample_mut.get_sort_key());
         if (sample_mut.mut_nuc != target_mut.get_mut_one_hot()) {
             if (sample_mut.mut_nuc & target_mut.get_mut_one_hot()) {
                 if (target_mut.get_par_one_hot()&target_mut.get_mut_one_hot()) {
@@ -220,7 +220,7 @@ struct Down_Decendant_Hook {
     }
     void sample_mut_only(const To_Place_Sample_Mutation &mut) {
         assert(mut.mut_nuc==0xf||mut.mut_nuc != mut.par_nuc);
-        assert(muts.empty()||muts.back().position<mut.position);
+        assert(muts.empty()||muts.back().get_sort_key()<mut.get_sort_key());
         muts.push_back(mut);
         if (mut.mut_nuc!=0xf) {
             if (!(mut.descendent_possible_nuc&mut.mut_nuc)) {
@@ -233,7 +233,7 @@ struct Down_Decendant_Hook {
     }
     void target_node_only(const MAT::Mutation &mut) {
         assert(!(mut.get_mut_one_hot() & mut.get_par_one_hot()));
-        assert(muts.empty()||muts.back().position<mut.get_position());
+        assert(muts.empty()||muts.back().get_sort_key()<mut.get_sort_key());
         muts.push_back(To_Place_Sample_Mutation(mut.get_position(),mut.get_chromIdx(),mut.get_par_one_hot(),mut.get_mut_one_hot(),mut.get_descendant_mut()));
         if (!(muts.back().mut_nuc&muts.back().descendent_possible_nuc)) {
             assert(!(muts.back().mut_nuc&muts.back().par_nuc));
@@ -246,8 +246,8 @@ struct Down_Decendant_Hook {
             fputc('a', stderr);
         }*/
         assert(sample_mut.mut_nuc!=0xf);
-        assert(sample_mut.position==target_mut.get_position());
-        assert(muts.empty()||muts.back().position<sample_mut.position);
+        assert(sample_mut.get_sort_key()==target_mut.get_sort_key());
+        assert(muts.empty()||muts.back().get_sort_key()<sample_mut.get_sort_key());
         if (sample_mut.mut_nuc != target_mut.get_mut_one_hot()) {
             muts.push_back(sample_mut);
             auto &last_mut = muts.back();
@@ -269,15 +269,15 @@ static void generic_merge(const MAT::Node *node,
     hook.reserve(par_mutations.size(), node->mutations.size());
     auto par_iter = par_mutations.begin();
     for (const auto &mut : node->mutations) {
-        while (par_iter->get_end_range() < mut.get_position()) {
+        while (par_iter->get_end_range_key() < mut.get_sort_key()) {
             hook.sample_mut_only(*par_iter);
             par_iter++;
         }
-        if (par_iter->mut_nuc==0xf&&par_iter->position<=mut.get_position()) {
+        if (par_iter->mut_nuc==0xf&&par_iter->get_sort_key()<=mut.get_sort_key()) {
             hook.target_N_skiped(mut);
             continue;
         }
-        if (par_iter->position == mut.get_position()) {
+        if (par_iter->get_sort_key() == mut.get_sort_key()) {
             hook.both(*par_iter, mut);
             par_iter++;
         } else {
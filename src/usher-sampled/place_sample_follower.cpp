@@ -56,23 +56,26 @@ serialize_move(move_type *in, MAT::Tree& tree) {
 
 
 void check_order_node(MAT::Node* node) {
-    int prev_pos=-1;
+    bool first=true;
+    uint64_t prev_key=0;
     for (const auto& mut : node->mutations) {
         if (mut.get_position()>=(int)MAT::Mutation::refs.size()) {
             fprintf(stderr, "%zu: placement_check strange size\n",node->node_id);
             raise(SIGTRAP);
         }
-        if (mut.get_position()<=prev_pos) {
+        if (!first&&mut.get_sort_key()<=prev_key) {
             fprintf(stderr, "%zu:placement out of order\n",node->node_id);
             raise(SIGTRAP);
         }
-        prev_pos=mut.get_position();
+        first=false;
+        prev_key=mut.get_sort_key();
     }
 }
 void check_order(MAT::Mutations_Collection& in) {
-    int prev_pos=-1;
+    bool first=true;
+    uint64_t prev_key=0;
     for (const auto& mut : in) {
-        if (mut.get_position()<=prev_pos) {
+        if (!first&&mut.get_sort_key()<=prev_key) {
             if (mut.get_position()>=(int)MAT::Mutation::refs.size()) {
                 fprintf(stderr, "placement_check strange size\n");
                 raise(SIGTRAP);
@@ -80,7 +83,8 @@ void check_order(MAT::Mutations_Collection& in) {
             fprintf(stderr, "placement out of order\n");
             raise(SIGTRAP);
         }
-        prev_pos=mut.get_position();
+        first=false;
+        prev_key=mut.get_sort_key();
     }
 }
 static void check_parent_match(MAT::Node* node,MAT::Tree& tree,char* name) {
@@ -37,6 +37,12 @@ union fixed_tree_search_mutation {
             return position;
         }
     }
+    uint64_t get_sort_key() const {
+        return MAT::mutation_sort_key(chrom, position);
+    }
+    uint64_t get_end_range_key() const {
+        return MAT::mutation_sort_key(chrom, get_end_range());
+    }
 };
 int update_idx(int& idx, int dfs_idx,int dfs_end_idx, const std::vector<index_ele>& dfs_elem) {
     if (idx==INDEX_END_POSITION) {
@@ -245,16 +251,16 @@ static int merge_mutations(std::vector<fixed_tree_search_mutation>& parent,const
     auto end=parent.end();
     for (size_t idx=0; idx<node_mut_count; idx++) {
         const auto& this_mut=node_mut[idx];
-        while (iter->get_end_range()<this_mut.get_position()) {
+        while (iter->get_end_range_key()<this_mut.get_sort_key()) {
             if (!(iter->mut_nuc==0xf||(iter->mut_nuc&iter->par_nuc))) {
                 parsimony_score++;
             }
             lower_bound+=add_existing_mut(iter, descendant_output, dfs_idx, dfs_end_idx, in, iter->par_nuc,sibling_out);
         }
-        if (iter->position<=this_mut.get_position()&&iter->mut_nuc==0xf) {
+        if (iter->get_sort_key()<=this_mut.get_sort_key()&&iter->mut_nuc==0xf) {
             continue;
         }
-        if (iter->position==this_mut.get_position()) {
+        if (iter->get_sort_key()==this_mut.get_sort_key()) {
             /*if (iter->mut_nuc==0xf) {
                 raise(SIGTRAP);
             }*/
@@ -394,6 +400,8 @@ move_type* place_sample_fixed_idx(const Traversal_Info &in,
     }
     fixed_tree_search_mutation mut_out;
     mut_out.position=INT_MAX;
+    //sorts after every real chromosome
+    mut_out.chrom=UINT8_MAX;
     mut_out.range=0;
     mut_out.mut_nuc=0xf;
     base_stack.push_back(mut_out);
@@ -58,6 +58,13 @@ struct To_Place_Sample_Mutation {
             return position;
         }
     }
+    uint64_t get_sort_key() const {
+        return MAT::mutation_sort_key(chrom_idx, position);
+    }
+    //key of the last position covered, N ranges do not span chromosomes
+    uint64_t get_end_range_key() const {
+        return MAT::mutation_sort_key(chrom_idx, get_end_range());
+    }
 };
 struct Sample_Muts {
     size_t sample_idx;
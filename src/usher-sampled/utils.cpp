@@ -91,7 +91,7 @@ static void add_neighbor(MAT::Node* center,MAT::Node* exclude, int radius_left,
     }
 }
 void find_moved_node_neighbors(int radius,size_t start_idx, MAT::Tree& tree, size_t cur_idx,std::vector<size_t>& node_to_search_idx) {
-    tree.depth_first_expansion();
+    tree.get_dfs_order();
     tbb::concurrent_unordered_map<size_t,int> to_search_node_idx_dict;
     to_search_node_idx_dict.rehash(tree.get_size_upper());
     tbb::parallel_for(tbb::blocked_range<size_t>(0,cur_idx),[&](tbb::blocked_range<size_t> r) {
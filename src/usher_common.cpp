@@ -3,6 +3,245 @@
 namespace po = boost::program_options;
 namespace MAT = Mutation_Annotated_Tree;
 
+// Per-node vectors filled by mapper2_body, indexed by the position of the node
+// in the BFS order. They are kept across samples so that the storage is not
+// reallocated for every node of the tree per sample; only the entries filled
+// for a sample are emptied afterwards.
+struct Placement_Buffers {
+    std::vector<std::vector<MAT::Mutation>> node_excess_mutations;
+    std::vector<std::vector<MAT::Mutation>> node_imputed_mutations;
+    std::vector<bool> node_has_unique;
+
+    void prepare (size_t total_nodes) {
+        if (node_excess_mutations.size() < total_nodes) {
+            node_excess_mutations.resize(total_nodes);
+            node_imputed_mutations.resize(total_nodes);
+        }
+        node_has_unique.assign(total_nodes, false);
+    }
+
+    void release (const std::vector<size_t>& filled) {
+        for (auto j: filled) {
+            node_excess_mutations[j].clear();
+            node_imputed_mutations[j].clear();
+        }
+    }
+
+    void release_all () {
+        for (size_t j = 0; j < node_excess_mutations.size(); j++) {
+            node_excess_mutations[j].clear();
+            node_imputed_mutations[j].clear();
+        }
+    }
+};
+
+// Inserts a leaf that was just added as the last child of bfs[j] into the BFS
+// order of the tree. Children of bfs[0..j] occupy positions 1 to the total
+// number of their children, in order, so the new leaf goes at that total.
+static void insert_child_in_bfs (std::vector<MAT::Node*>& bfs, size_t j, MAT::Node* leaf) {
+    size_t pos = 0;
+    for (size_t i = 0; i <= j; i++) {
+        pos += bfs[i]->children.size();
+    }
+    bfs.insert(bfs.begin()+pos, leaf);
+}
+
+static void update_levels (MAT::Node* node) {
+    node->level = node->parent->level + 1;
+    if (node->is_leaf()) {
+        return;
+    }
+    std::queue<MAT::Node*> remaining_nodes;
+    remaining_nodes.push(node);
+    while (remaining_nodes.size() > 0) {
+        MAT::Node* curr_node = remaining_nodes.front();
+        remaining_nodes.pop();
+        curr_node->level = curr_node->parent->level + 1;
+        for (auto c: curr_node->children) {
+            remaining_nodes.push(c);
+        }
+    }
+}
+
+// Trees created for multiple parsimony-optimal placements (-M). Instead of
+// copying the whole tree for every placement, all trees share a single working
+// tree. Each tree is a chain of placements applied to the input tree, and the
+// chains of trees that were split off for the same sample share all placements
+// made before it, so the placements form a tree of their own. Attaching a tree
+// undoes the placements of the working tree back to the last one it has in
+// common with that tree, then redoes the placements of that tree from there.
+// Nodes not touched by a placement are shared by all trees, and nodes added by
+// a placement are kept while detached so that it can be redone.
+class Placement_Forest {
+    // Placement of sample as a child of parent, or as a sibling of moved, in
+    // which case moved is moved from parent under the new node internal and
+    // its mutations are replaced. moved_mutations holds the mutations of moved
+    // that are not in the working tree, which are swapped in and out.
+    struct Placement {
+        size_t prev;
+        size_t depth;
+        MAT::Node* parent;
+        MAT::Node* sample;
+        MAT::Node* internal;
+        MAT::Node* moved;
+        size_t moved_idx;
+        float moved_branch_length;
+        std::vector<MAT::Mutation> moved_mutations;
+        size_t internal_nodes_before;
+        size_t internal_nodes_after;
+        // Index entries of sample and internal while they are detached
+        MAT::Tree::Node_Entry sample_entry;
+        MAT::Tree::Node_Entry internal_entry;
+    };
+
+    MAT::Tree& tree;
+    // placements[0] stands for the input tree
+    std::vector<Placement> placements;
+    // Last placement of each tree
+    std::vector<size_t> heads;
+    // Last placement applied to the working tree
+    size_t current;
+
+    void undo (Placement& p) {
+        auto& children = p.parent->children;
+        if (p.internal == NULL) {
+            assert (children.back() == p.sample);
+            children.pop_back();
+        } else {
+            assert (children.back() == p.internal);
+            children.pop_back();
+            children.insert(children.begin()+p.moved_idx, p.moved);
+            p.moved->parent = p.parent;
+            p.moved->branch_length = p.moved_branch_length;
+            std::swap(p.moved->mutations, p.moved_mutations);
+            update_levels(p.moved);
+            p.internal_entry = tree.unregister_node(p.internal);
+        }
+        p.sample_entry = tree.unregister_node(p.sample);
+        tree.curr_internal_node = p.internal_nodes_before;
+    }
+
+    void redo (Placement& p) {
+        auto& children = p.parent->children;
+        if (p.internal == NULL) {
+            children.push_back(p.sample);
+            p.sample->level = p.parent->level + 1;
+        } else {
+            assert (children[p.moved_idx] == p.moved);
+            children.erase(children.begin()+p.moved_idx);
+            children.push_back(p.internal);
+            p.internal->level = p.parent->level + 1;
+            p.sample->level = p.internal->level + 1;
+            p.moved->parent = p.internal;
+            p.moved->branch_length = -1.0;
+            std::swap(p.moved->mutations, p.moved_mutations);
+            update_levels(p.moved);
+            tree.register_node(std::move(p.internal_entry));
+        }
+        tree.register_node(std::move(p.sample_entry));
+        tree.curr_internal_node = p.internal_nodes_after;
+    }
+
+    void record (size_t t_idx, Placement&& p) {
+        assert (current == heads[t_idx]);
+        p.prev = current;
+        p.depth = placements[current].depth + 1;
+        p.internal_nodes_after = tree.curr_internal_node;
+        current = placements.size();
+        heads[t_idx] = current;
+        placements.emplace_back(std::move(p));
+    }
+
+  public:
+    Placement_Forest (MAT::Tree& working_tree): tree(working_tree), current(0) {
+        placements.emplace_back();
+        placements[0].prev = 0;
+        placements[0].depth = 0;
+        heads.emplace_back(0);
+    }
+
+    // Nodes added by placements that are not in the working tree are only
+    // referenced here
+    ~Placement_Forest () {
+        std::vector<bool> attached(placements.size(), false);
+        for (size_t p = current; p != 0; p = placements[p].prev) {
+            attached[p] = true;
+        }
+        for (size_t p = 1; p < placements.size(); p++) {
+            if (!attached[p]) {
+                delete placements[p].sample;
+                delete placements[p].internal;
+            }
+        }
+    }
+
+    size_t size() const {
+        return heads.size();
+    }
+
+    // Identifies the state of the working tree
+    size_t state() const {
+        return current;
+    }
+
+    // Adds a tree equal to the working tree in the given state
+    size_t add_tree (size_t state) {
+        heads.emplace_back(state);
+        return heads.size()-1;
+    }
+
+    // Makes the working tree equal to tree t_idx
+    void attach (size_t t_idx) {
+        size_t from = current;
+        size_t to = heads[t_idx];
+        std::vector<size_t> to_redo;
+        while (placements[from].depth > placements[to].depth) {
+            undo(placements[from]);
+            from = placements[from].prev;
+        }
+        while (placements[to].depth > placements[from].depth) {
+            to_redo.emplace_back(to);
+            to = placements[to].prev;
+        }
+        while (from != to) {
+            undo(placements[from]);
+            from = placements[from].prev;
+            to_redo.emplace_back(to);
+            to = placements[to].prev;
+        }
+        for (auto it = to_redo.rbegin(); it != to_redo.rend(); it++) {
+            redo(placements[*it]);
+        }
+        current = heads[t_idx];
+    }
+
+    // Records placements just made on the working tree, attached to tree t_idx
+    void record_child (size_t t_idx, MAT::Node* sample, size_t internal_nodes_before) {
+        Placement p;
+        p.parent = sample->parent;
+        p.sample = sample;
+        p.internal = NULL;
+        p.moved = NULL;
+        p.internal_nodes_before = internal_nodes_before;
+        record(t_idx, std::move(p));
+    }
+
+    void record_sibling (size_t t_idx, MAT::Node* sample, MAT::Node* moved, size_t moved_idx,
+                         float moved_branch_length, std::vector<MAT::Mutation>&& moved_old_mutations,
+                         size_t internal_nodes_before) {
+        Placement p;
+        p.internal = sample->parent;
+        p.parent = p.internal->parent;
+        p.sample = sample;
+        p.moved = moved;
+        p.moved_idx = moved_idx;
+        p.moved_branch_length = moved_branch_length;
+        p.moved_mutations = std::move(moved_old_mutations);
+        p.internal_nodes_before = internal_nodes_before;
+        record(t_idx, std::move(p));
+    }
+};
+
 //returns exit code
 int usher_common(std::string dout_filename, std::string outdir, uint32_t max_trees,
                  uint32_t max_uncertainty, uint32_t max_parsimony, bool sort_before_placement_1, bool sort_before_placement_2, bool sort_before_placement_3,
@@ -94,20 +333,18 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
     Instrumentor::Get().BeginSession("test-main", "p1.json");
 #endif
 
-    // Vector to store multiple trees, each corresponding to a different
-    // possibility of a  parsimony-optimal placement, when --multiple-placements
-    // is used. Otherwise, this vector maintains a single tree througout the
-    // execution in which a tie-breaking strategy defined in usher_mapper is
-    // used for multiple parsimony-optimal placements.
-    std::vector<MAT::Tree> optimal_trees;
-
-
-
-    // Tree pointer to point to some element in optimal_trees that would be
-    // updated several times during the execution
-
-    optimal_trees.emplace_back(std::move(*loaded_MAT));
-    MAT::Tree* T = &optimal_trees[0];
+    // Multiple trees, each corresponding to a different possibility of a
+    // parsimony-optimal placement, when --multiple-placements is used. They
+    // share working_tree, which is made equal to one of them at a time.
+    // Otherwise, this maintains a single tree througout the execution in
+    // which a tie-breaking strategy defined in usher_mapper is used for
+    // multiple parsimony-optimal placements.
+    MAT::Tree working_tree = std::move(*loaded_MAT);
+    Placement_Forest optimal_trees(working_tree);
+
+    // Tree pointer to point to the tree that would be updated several times
+    // during the execution
+    MAT::Tree* T = &working_tree;
     // Since --multiple-placements can result in trees with different parsimony
     // scores, the vector below will be used to maintain the final parsimony
     // score of each tree
@@ -197,37 +434,18 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                 std::vector<int> best_parsimony_scores;
                 std::vector<size_t> num_best_placements;
 
+                // The tree is not modified while sorting, so a single BFS
+                // order serves all samples. Only the scores are needed here,
+                // so the mapper does not fill excess or imputed mutations.
+                auto bfs = T->breadth_first_expansion();
+                size_t total_nodes = bfs.size();
+                std::vector<bool> node_has_unique;
+
                 for (size_t s=0; s<missing_samples.size(); s++) {
 
                     //Sort the missing sample mutations by position
                     std::sort(missing_samples[s].mutations.begin(), missing_samples[s].mutations.end());
 
-                    auto bfs = T->breadth_first_expansion();
-                    size_t total_nodes = bfs.size();
-
-                    // Stores the excess mutations to place the sample at each
-                    // node of the tree in DFS order. When placement is as a
-                    // child, it only contains parsimony-increasing mutations in
-                    // the sample. When placement is as a sibling, it contains
-                    // parsimony-increasing mutations as well as the mutations
-                    // on the placed node in common with the new sample. Note
-                    // guaranteed to be corrrect only for optimal nodes since
-                    // the mapper can terminate the search early for non-optimal
-                    // nodes
-                    std::vector<std::vector<MAT::Mutation>> node_excess_mutations(total_nodes);
-                    // Stores the imputed mutations for ambiguous bases in the
-                    // sampled in order to place the sample at each node of the
-                    // tree in DFS order. Again, guaranteed to be corrrect only
-                    // for pasrimony-optimal nodes
-                    std::vector<std::vector<MAT::Mutation>> node_imputed_mutations(total_nodes);
-
-                    // Stores the parsimony score to place the sample at each
-                    // node of the tree in DFS order.
-                    std::vector<int> node_set_difference;
-                    if (print_parsimony_scores) {
-                        node_set_difference.resize(total_nodes);
-                    }
-
                     size_t best_node_num_leaves = 0;
                     // The maximum number of mutations is bound by the number
                     // of mutations in the missing sample (place at root)
@@ -242,7 +460,7 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                     bool best_node_has_unique = false;
                     MAT::Node* best_node = T->root;
 
-                    std::vector<bool> node_has_unique(total_nodes, false);
+                    node_has_unique.assign(total_nodes, false);
                     std::vector<size_t> best_j_vec;
                     best_j_vec.emplace_back(0);
 
@@ -256,8 +474,8 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                             inp.T = T;
                             inp.node = bfs[k];
                             inp.missing_sample_mutations = &missing_samples[s].mutations;
-                            inp.excess_mutations = &node_excess_mutations[k];
-                            inp.imputed_mutations = &node_imputed_mutations[k];
+                            inp.excess_mutations = NULL;
+                            inp.imputed_mutations = NULL;
                             inp.best_node_num_leaves = &best_node_num_leaves;
                             inp.best_set_difference = &best_set_difference;
                             inp.best_node = &best_node;
@@ -268,7 +486,7 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                             inp.best_j_vec = &best_j_vec;
                             inp.node_has_unique = &(node_has_unique);
 
-                            mapper2_body(inp, false);
+                            mapper2_body(inp, false, false);
                         }
                     }, ap);
 
@@ -306,6 +524,28 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
         std::string placement_stats_filename = outdir + "/placement_stats.tsv";
         FILE *placement_stats_file = fopen(placement_stats_filename.c_str(), "w");
 
+        // BFS order of the working tree in state cached_bfs_state of
+        // optimal_trees, kept up to date as samples are placed rather than
+        // recomputed for every sample. Empty if the order needs to be
+        // recomputed.
+        std::vector<MAT::Node*> cached_bfs;
+        size_t cached_bfs_state = 0;
+
+        // Stores the excess mutations to place the sample at each node of
+        // the tree in BFS order. When placement is as a child, it only
+        // contains parsimony-increasing mutations in the sample. When
+        // placement is as a sibling, it contains parsimony-increasing
+        // mutations as well as the mutations on the placed node in common
+        // with the new sample. Note guaranteed to be corrrect only for optimal
+        // nodes since the mapper can terminate the search early for
+        // non-optimal nodes. Also stores the imputed mutations for ambiguous
+        // bases in the sample in order to place the sample at each node,
+        // again guaranteed to be correct only for pasrimony-optimal nodes.
+        Placement_Buffers buffers;
+        auto& node_excess_mutations = buffers.node_excess_mutations;
+        auto& node_imputed_mutations = buffers.node_imputed_mutations;
+        auto& node_has_unique = buffers.node_has_unique;
+
         // Traverse in sorted sample order
         for (size_t idx=0; idx<indexes.size(); idx++) {
 
@@ -314,7 +554,7 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
             for (size_t t_idx=0; t_idx < num_trees; t_idx++) {
                 timer.Start();
 
-                T = &optimal_trees[t_idx];
+                optimal_trees.attach(t_idx);
 
                 if (num_trees > 1) {
                     fprintf(stderr, "==Tree %zu=== \n", t_idx+1);
@@ -339,24 +579,16 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                     }
                 }
 
-                auto bfs = T->breadth_first_expansion();
+                std::vector<MAT::Node*> bfs;
+                if (cached_bfs_state == optimal_trees.state()) {
+                    std::swap(bfs, cached_bfs);
+                }
+                cached_bfs.clear();
+                if (bfs.empty()) {
+                    bfs = T->breadth_first_expansion();
+                }
                 size_t total_nodes = bfs.size();
-
-                // Stores the excess mutations to place the sample at each
-                // node of the tree in DFS order. When placement is as a
-                // child, it only contains parsimony-increasing mutations in
-                // the sample. When placement is as a sibling, it contains
-                // parsimony-increasing mutations as well as the mutations
-                // on the placed node in common with the new sample. Note
-                // guaranteed to be corrrect only for optimal nodes since
-                // the mapper can terminate the search early for non-optimal
-                // nodes
-                std::vector<std::vector<MAT::Mutation>> node_excess_mutations(total_nodes);
-                // Stores the imputed mutations for ambiguous bases in the
-                // sampled in order to place the sample at each node of the
-                // tree in DFS order. Again, guaranteed to be corrrect only
-                // for pasrimony-optimal nodes
-                std::vector<std::vector<MAT::Mutation>> node_imputed_mutations(total_nodes);
+                buffers.prepare(total_nodes);
 
                 std::vector<int> node_set_difference;
 
@@ -376,9 +608,10 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                 size_t best_j = 0;
                 bool best_node_has_unique = false;
 
-                std::vector<bool> node_has_unique(total_nodes, false);
                 std::vector<size_t> best_j_vec;
                 best_j_vec.emplace_back(0);
+                // Entries of the buffers filled for this sample
+                std::vector<size_t> filled_j_vec;
 
                 size_t num_best = 1;
                 MAT::Node* best_node = T->root;
@@ -417,6 +650,7 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                     best_set_difference += 1;
 
                     auto tmp_vec = std::vector<size_t>(best_j_vec.begin(), best_j_vec.end());
+                    filled_j_vec = tmp_vec;
 
                     num_best = 0;
                     best_j_vec.clear();
@@ -546,14 +780,6 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
 
 #endif
 
-                // If number of parsimony-optimal trees is more than 1 and if
-                // the number of trees has not already exceeded the maximum
-                // limit, create a copy of the current tree in curr_tree
-                MAT::Tree curr_tree;
-                if ((max_trees > 1) && (num_best > 1) && (num_trees < max_trees)) {
-                    curr_tree = MAT::get_tree_copy(*T);
-                }
-
                 if (print_parsimony_scores) {
                     for (size_t k = 0; k < total_nodes; k++) {
                         char is_optimal = (node_set_difference[k] == best_set_difference) ? 'y' : 'n';
@@ -620,6 +846,10 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
 
                     // Iterate over the number of parsimony-optimal placements
                     // for which a new tree will be created
+                    // Additional trees start from the state of the working
+                    // tree before the placement
+                    size_t curr_t_idx = t_idx;
+                    size_t before_placement = optimal_trees.state();
                     for (size_t k = 0; k < num_best; k++) {
 
                         // best_j is updated using best_j_vec if multiple
@@ -632,14 +862,14 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                                 fprintf (stderr, "Creating %zu additional tree(s) for %zu parsimony-optimal placements.\n", num_best-1, num_best);
                             }
                             // If at second placement or higher, a new tree needs to
-                            // be added to optimal_trees and T needs to point to its
-                            // last element. If not, T is already pointing to the
-                            // last element of optimal_trees on which placement will
-                            // be carried out
+                            // be added to optimal_trees and the working tree needs
+                            // to be attached to it, which undoes the previous
+                            // placement of this sample. If not, the working tree
+                            // is already attached to the tree on which placement
+                            // will be carried out.
                             if (k > 0) {
-                                auto tmp_T = MAT::get_tree_copy(curr_tree);
-                                optimal_trees.emplace_back(std::move(tmp_T));
-                                T = &optimal_trees[optimal_trees.size()-1];
+                                curr_t_idx = optimal_trees.add_tree(before_placement);
+                                optimal_trees.attach(curr_t_idx);
                                 bfs = T->breadth_first_expansion();
                             }
 
@@ -652,6 +882,13 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                         if (!no_add && T->get_node(sample) == NULL) {
                             // Is placement as sibling
                             if (best_node->is_leaf() || best_node_has_unique) {
+                                // best node and its descendants move down a
+                                // level, recompute BFS order for the next sample
+                                bfs.clear();
+                                size_t internal_nodes = T->curr_internal_node;
+                                auto& best_node_siblings = best_node->parent->children;
+                                size_t best_node_idx = std::find(best_node_siblings.begin(), best_node_siblings.end(), best_node) - best_node_siblings.begin();
+                                float best_node_branch_length = best_node->branch_length;
                                 std::string nid = T->new_internal_node_id();
                                 T->create_node(nid, best_node->parent->identifier);
                                 T->create_node(sample, nid);
@@ -726,6 +963,12 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                                 for (auto m: l2_mut) {
                                     T->get_node(sample)->add_mutation(m);
                                 }
+                                // Placements only need to be undone when
+                                // there can be more than one tree
+                                if (max_trees > 1) {
+                                    optimal_trees.record_sibling(curr_t_idx, T->get_node(sample), best_node, best_node_idx,
+                                                                 best_node_branch_length, std::move(curr_l1_mut), internal_nodes);
+                                }
                             }
                             // Else placement as child
                             else {
@@ -761,8 +1004,15 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                                 for (auto m: node_mut) {
                                     node->add_mutation(m);
                                 }
+                                insert_child_in_bfs(bfs, best_j, node);
+                                if (max_trees > 1) {
+                                    optimal_trees.record_child(curr_t_idx, node, T->curr_internal_node);
+                                }
                             }
                         }
+                        cached_bfs = std::move(bfs);
+                        cached_bfs_state = optimal_trees.state();
+                        bfs.clear();
 
                         if (node_imputed_mutations[best_j].size() > 0) {
                             fprintf (stderr, "Imputed mutations:\t");
@@ -787,6 +1037,17 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                 }
                 fputc('\n', placement_stats_file);
 
+                // Tree was not modified, keep its BFS order
+                if (!bfs.empty()) {
+                    cached_bfs = std::move(bfs);
+                    cached_bfs_state = optimal_trees.state();
+                }
+                if (print_parsimony_scores) {
+                    buffers.release_all();
+                } else {
+                    buffers.release(filled_j_vec);
+                }
+
                 fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
             }
         }
@@ -804,15 +1065,26 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
         return 0;
     }
 
-    // Collapse the output tree
-    if (collapse_output_tree) {
-        timer.Start();
+    // Trees are written one at a time. All but the last tree are written from
+    // a copy of the working tree attached to it, since writing collapses and
+    // uncondenses the tree, and the last one from the working tree itself.
+    // The copy of the first tree is kept for saving the mutation-annotated
+    // tree object.
+    MAT::Tree first_tree;
+    for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
+        MAT::Tree tree_copy;
+        optimal_trees.attach(t_idx);
+        if (t_idx+1 < num_trees) {
+            tree_copy = MAT::get_tree_copy(working_tree);
+            T = &tree_copy;
+        } else {
+            T = &working_tree;
+        }
 
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
+        // Collapse the output tree
+        if (collapse_output_tree) {
             timer.Start();
 
-            T = &optimal_trees[t_idx];
-
             if (num_trees > 1) {
                 fprintf(stderr, "Collapsing output tree %lu.\n", t_idx+1);
             } else {
@@ -823,16 +1095,12 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
 
             fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
         }
-    }
 
-    // If user need uncondensed tree output, write uncondensed tree(s) to
-    // file(s)
-    if (print_uncondensed_tree) {
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
+        // If user need uncondensed tree output, write uncondensed tree(s) to
+        // file(s)
+        if (print_uncondensed_tree) {
             timer.Start();
 
-            T = &optimal_trees[t_idx];
-
             auto uncondensed_final_tree_filename = outdir + "/uncondensed-final-tree.nh";
             if (num_trees > 1) {
                 uncondensed_final_tree_filename = outdir + "/uncondensed-final-tree-" + std::to_string(t_idx+1) + ".nh";
@@ -850,14 +1118,10 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
             uncondensed_final_tree_file.close();
 
             fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
-        }
-    } else {
-        // Write final tree(s) to file(s)
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
+        } else {
+            // Write final tree(s) to file(s)
             timer.Start();
 
-            T = &optimal_trees[t_idx];
-
             auto final_tree_filename = outdir + "/final-tree.nh";
             if (num_trees > 1) {
                 final_tree_filename = outdir + "/final-tree-" + std::to_string(t_idx+1) + ".nh";
@@ -878,23 +1142,21 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
 
             fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
         }
-    }
 
-    if (missing_samples.size() > 0) {
-        // For each final tree write the path of mutations from tree root to the
-        // sample for each newly placed sample
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
+        bool use_tree_idx = false;
+        if (num_trees > 1) {
+            use_tree_idx = true;
+        }
+        std::vector<std::string> targets;
+        for (auto s: missing_samples) {
+            targets.emplace_back(s.name);
+        }
+
+        if (missing_samples.size() > 0) {
+            // For each final tree write the path of mutations from tree root to the
+            // sample for each newly placed sample
             timer.Start();
 
-            T = &optimal_trees[t_idx];
-            bool use_tree_idx = false;
-            if (num_trees > 1) {
-                use_tree_idx = true;
-            }
-            std::vector<std::string> targets;
-            for (auto s: missing_samples) {
-                targets.emplace_back(s.name);
-            }
             auto mutation_paths_filename = outdir + "/mutation-paths.txt";
             if (use_tree_idx) {
                 mutation_paths_filename = outdir + "/mutation-paths-" + std::to_string(t_idx+1) + ".txt";
@@ -904,11 +1166,8 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
             }
             MAT::get_sample_mutation_paths(T, targets, mutation_paths_filename);
             fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
-        }
-        // For each final tree write the annotations for each sample
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
-            T = &optimal_trees[t_idx];
 
+            // For each final tree write the annotations for each sample
             size_t num_annotations = T->get_num_annotations();
 
             if (num_annotations > 0) {
@@ -968,47 +1227,33 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
                 fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
             }
         }
-    }
 
-    if ((print_subtrees_single > 1) && (missing_samples.size() > 0)) {
-        fprintf(stderr, "Computing the single subtree for added samples with %zu random leaves. \n\n", print_subtrees_single);
-        timer.Start();
-        // For each final tree, write a subtree of user-specified size around
-        // each newly placed sample in newick format
-        std::vector<std::string> targets;
-        for (auto m: missing_samples) {
-            targets.emplace_back(m.name);
-        }
-        bool use_tree_idx = false;
-        if (num_trees > 1) {
-            use_tree_idx = true;
-        }
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
-            optimal_trees[t_idx].uncondense_leaves();
-            MAT::get_random_single_subtree(&optimal_trees[t_idx], targets, outdir, print_subtrees_single, t_idx, use_tree_idx, retain_original_branch_len);
+        if ((print_subtrees_single > 1) && (missing_samples.size() > 0)) {
+            fprintf(stderr, "Computing the single subtree for added samples with %zu random leaves. \n\n", print_subtrees_single);
+            timer.Start();
+            // For each final tree, write a subtree of user-specified size around
+            // each newly placed sample in newick format
+            T->uncondense_leaves();
+            MAT::get_random_single_subtree(T, targets, outdir, print_subtrees_single, t_idx, use_tree_idx, retain_original_branch_len);
+            fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
         }
-        fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
-    }
 
-    if ((print_subtrees_size > 1) && (missing_samples.size() > 0)) {
-        fprintf(stderr, "Computing subtrees for added samples. \n\n");
+        if ((print_subtrees_size > 1) && (missing_samples.size() > 0)) {
+            fprintf(stderr, "Computing subtrees for added samples. \n\n");
 
-        // For each final tree, write a subtree of user-specified size around
-        // each newly placed sample in newick format
-        timer.Start();
-        std::vector<std::string> targets;
-        for (auto m: missing_samples) {
-            targets.emplace_back(m.name);
-        }
-        bool use_tree_idx = false;
-        if (num_trees > 1) {
-            use_tree_idx = true;
+            // For each final tree, write a subtree of user-specified size around
+            // each newly placed sample in newick format
+            timer.Start();
+            T->uncondense_leaves();
+            MAT::get_random_sample_subtrees(T, targets, outdir, print_subtrees_size, t_idx, use_tree_idx, retain_original_branch_len);
+            fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
         }
-        for (size_t t_idx = 0; t_idx < num_trees; t_idx++) {
-            optimal_trees[t_idx].uncondense_leaves();
-            MAT::get_random_sample_subtrees(&optimal_trees[t_idx], targets, outdir, print_subtrees_size, t_idx, use_tree_idx, retain_original_branch_len);
+
+        if ((t_idx == 0) && (T == &tree_copy) && (dout_filename != "")) {
+            first_tree = std::move(tree_copy);
+        } else if (T == &tree_copy) {
+            MAT::clear_tree(tree_copy);
         }
-        fprintf(stderr, "Completed in %ld msec \n\n", timer.Stop());
     }
 
     // Print warning message with a list of all samples placed with low
@@ -1032,7 +1277,7 @@ int usher_common(std::string dout_filename, std::string outdir, uint32_t max_tre
 
         Parsimony::data data;
 
-        T = &optimal_trees[0];
+        T = (num_trees > 1) ? &first_tree : &working_tree;
         // Recondense tree with new samples
         if (T->condensed_nodes.size() > 0) {
             T->uncondense_leaves();
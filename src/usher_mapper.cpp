@@ -65,7 +65,7 @@ int mapper_body::operator()(mapper_input input) {
             else {
                 //auto mutations_iter = input.missing_sample_mutations->begin() + (iter - input.missing_samples->begin());
                 MAT::Mutation m;
-                m.chrom = input.chrom;
+                m.set_chromosome(input.chrom);
                 m.position = input.variant_pos;
                 m.ref_nuc = input.ref_nuc;
                 if (nuc == 15) {
@@ -143,7 +143,7 @@ int mapper_body::operator()(mapper_input input) {
 
             if (state != par_state) {
                 MAT::Mutation m;
-                m.chrom = input.chrom;
+                m.set_chromosome(input.chrom);
                 m.position = input.variant_pos;
                 m.ref_nuc = input.ref_nuc;
                 m.par_nuc = (1 << par_state);
@@ -213,7 +213,7 @@ void mapper2_body(mapper2_input& input, bool compute_parsimony_scores, bool comp
                         auto nuc = m2.mut_nuc;
                         if ((nuc & anc_nuc) != 0) {
                             MAT::Mutation m;
-                            m.chrom = m1.chrom;
+                            m.chrom_idx = m1.chrom_idx;
                             m.position = m1.position;
                             m.ref_nuc = m1.ref_nuc;
                             m.par_nuc = m1.par_nuc;
@@ -244,7 +244,7 @@ void mapper2_body(mapper2_input& input, bool compute_parsimony_scores, bool comp
                 if (!found_pos && (anc_nuc == m1.ref_nuc)) {
                     MAT::Mutation m;
                     m.position = m1.position;
-                    m.chrom = m1.chrom;
+                    m.chrom_idx = m1.chrom_idx;
                     m.ref_nuc = m1.ref_nuc;
                     m.par_nuc = m1.par_nuc;
                     m.mut_nuc = anc_nuc;
@@ -325,7 +325,7 @@ void mapper2_body(mapper2_input& input, bool compute_parsimony_scores, bool comp
             // add it to imputed_mutations
             if (compute_vecs && ((m1.mut_nuc & (m1.mut_nuc - 1)) != 0)) {
                 MAT::Mutation m;
-                m.chrom = m1.chrom;
+                m.chrom_idx = m1.chrom_idx;
                 m.position = m1.position;
                 m.ref_nuc = m1.ref_nuc;
                 m.par_nuc = anc_nuc;
@@ -341,7 +341,7 @@ void mapper2_body(mapper2_input& input, bool compute_parsimony_scores, bool comp
         else if (!found_pos && has_ref) {
             if (compute_vecs && ((m1.mut_nuc & (m1.mut_nuc - 1)) != 0)) {
                 MAT::Mutation m;
-                m.chrom = m1.chrom;
+                m.chrom_idx = m1.chrom_idx;
                 m.position = m1.position;
                 m.ref_nuc = m1.ref_nuc;
                 m.par_nuc = anc_nuc;
@@ -355,7 +355,7 @@ void mapper2_body(mapper2_input& input, bool compute_parsimony_scores, bool comp
         // imputed_mutations, if base was originally ambiguous
         else {
             MAT::Mutation m;
-            m.chrom = m1.chrom;
+            m.chrom_idx = m1.chrom_idx;
             m.position = m1.position;
             m.ref_nuc = m1.ref_nuc;
             m.par_nuc = anc_nuc;
@@ -426,7 +426,7 @@ void mapper2_body(mapper2_input& input, bool compute_parsimony_scores, bool comp
         } else if (found_pos && !found) {
         } else {
             MAT::Mutation m;
-            m.chrom = m1.chrom;
+            m.chrom_idx = m1.chrom_idx;
             m.position = m1.position;
             m.ref_nuc = m1.ref_nuc;
             m.par_nuc = anc_nuc;
@@ -428,7 +428,7 @@ int main(int argc, char** argv) {
                             std::advance(iter, k);
                             if (iter != missing_samples.end()) {
                                 MAT::Mutation m;
-                                m.chrom = words[0];
+                                m.set_chromosome(words[0]);
                                 m.position = std::stoi(words[1]);
                                 m.ref_nuc = MAT::get_nuc_id(words[3][0]);
                                 assert((m.ref_nuc & (m.ref_nuc-1)) == 0); //check if it is power of 2